@@ -0,0 +1,633 @@
+/* LiquidRescaling Library BENCHMARK program
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* This program times lqr_carver_resize on a fixed set of synthetic
+ * images and resizing cases, and writes the results in CSV or JSON
+ * format. All the images are generated from a fixed seed, so that
+ * two runs always process exactly the same data: the hash column
+ * is a checksum of the output image and can be used to check that
+ * an optimization didn't change the results. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <lqr.h>
+
+/*** synthetic images ***/
+
+enum _BenchImageKind {
+    BENCH_IMAGE_NOISE,                  /* uniform random noise */
+    BENCH_IMAGE_GRADIENT,               /* smooth gradients (lots of ties) */
+    BENCH_IMAGE_TEXT,                   /* text-like strokes on a flat background */
+    BENCH_IMAGE_N_KINDS
+};
+
+typedef enum _BenchImageKind BenchImageKind;
+
+static const gchar *image_names[] = { "noise", "gradient", "text" };
+
+struct _BenchSize {
+    gint width;
+    gint height;
+};
+
+typedef struct _BenchSize BenchSize;
+
+static const BenchSize sizes[] = {
+    {128, 96},
+    {320, 240},
+    {640, 480},
+    {1280, 960},                        /* only with --large */
+};
+
+#define N_SIZES ((gint) (sizeof(sizes) / sizeof(sizes[0])))
+
+struct _BenchFormat {
+    gint channels;
+    LqrColDepth col_depth;
+};
+
+typedef struct _BenchFormat BenchFormat;
+
+static const BenchFormat formats[] = {
+    {3, LQR_COLDEPTH_8I},               /* the default format, used by all cases */
+    {1, LQR_COLDEPTH_8I},
+    {4, LQR_COLDEPTH_8I},
+    {3, LQR_COLDEPTH_16I},
+    {3, LQR_COLDEPTH_32F},
+};
+
+#define N_FORMATS ((gint) (sizeof(formats) / sizeof(formats[0])))
+
+static const gchar *depth_names[] = { "8i", "16i", "32f", "64f" };
+
+/*** resizing cases ***/
+
+#define BENCH_ENERGY_CUSTOM (-1)
+
+struct _BenchCase {
+    const gchar *name;
+    gdouble width_factor;               /* new width, relative to the original */
+    gdouble height_factor;              /* new height, relative to the original */
+    gint delta_x;
+    gfloat rigidity;
+    gboolean use_cache;
+    gint energy;                        /* a LqrEnergyFuncBuiltinType, or BENCH_ENERGY_CUSTOM */
+    gboolean all_formats;               /* whether to run it on all formats or just the default one */
+};
+
+typedef struct _BenchCase BenchCase;
+
+static const BenchCase cases[] = {
+    {"shrink", 0.75, 1.0, 1, 0, TRUE, LQR_EF_GRAD_XABS, TRUE},
+    {"enlarge", 1.5, 1.0, 1, 0, TRUE, LQR_EF_GRAD_XABS, TRUE},
+    {"two-axis", 0.8, 1.2, 1, 0, TRUE, LQR_EF_GRAD_XABS, TRUE},
+    {"shrink-rig", 0.75, 1.0, 1, 0.5, TRUE, LQR_EF_GRAD_XABS, FALSE},
+    {"enlarge-rig", 1.5, 1.0, 1, 0.5, TRUE, LQR_EF_GRAD_XABS, FALSE},
+    {"shrink-dx2", 0.75, 1.0, 2, 0, TRUE, LQR_EF_GRAD_XABS, FALSE},
+    {"shrink-dx3", 0.75, 1.0, 3, 0, TRUE, LQR_EF_GRAD_XABS, FALSE},
+    {"shrink-dx3-rig", 0.75, 1.0, 3, 0.5, TRUE, LQR_EF_GRAD_XABS, FALSE},
+    {"shrink-nocache", 0.75, 1.0, 1, 0, FALSE, LQR_EF_GRAD_XABS, FALSE},
+    {"enlarge-nocache", 1.5, 1.0, 1, 0, FALSE, LQR_EF_GRAD_XABS, FALSE},
+    {"shrink-norm", 0.75, 1.0, 1, 0, TRUE, LQR_EF_GRAD_NORM, FALSE},
+    {"shrink-luma", 0.75, 1.0, 1, 0, TRUE, LQR_EF_LUMA_GRAD_SUMABS, FALSE},
+    {"shrink-custom", 0.75, 1.0, 1, 0, TRUE, BENCH_ENERGY_CUSTOM, FALSE},
+    {"shrink-custom-nocache", 0.75, 1.0, 1, 0, FALSE, BENCH_ENERGY_CUSTOM, FALSE},
+};
+
+#define N_CASES ((gint) (sizeof(cases) / sizeof(cases[0])))
+
+/*** command line options ***/
+
+static gboolean output_json = FALSE;
+static gchar *output_file = NULL;
+static gint n_repeat = 3;
+static gchar *case_filter = NULL;
+static gboolean quick = FALSE;
+static gboolean large = FALSE;
+
+/*** random numbers (fixed sequence, independent of the C library) ***/
+
+static guint32 rng_state;
+
+static void
+rng_seed(guint32 seed)
+{
+    rng_state = seed ? seed : 1;
+}
+
+static gdouble
+rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state >> 8) / (gdouble) (1 << 24);
+}
+
+/*** image generation ***/
+
+/* fill a plane of values in [0,1] (alpha channels are kept opaque) */
+static void
+image_fill(gdouble *v, BenchImageKind kind, gint w, gint h, gint channels)
+{
+    gint x, y, k, x0, y0, s, i;
+    gint n_colour = (channels == 2 || channels == 4) ? channels - 1 : channels;
+    gdouble ink;
+
+    rng_seed(1 + kind * 7919 + w * 31 + h);
+
+    switch (kind) {
+        case BENCH_IMAGE_NOISE:
+            for (i = 0; i < w * h * channels; i++) {
+                v[i] = rng_next();
+            }
+            break;
+        case BENCH_IMAGE_GRADIENT:
+            for (y = 0; y < h; y++) {
+                for (x = 0; x < w; x++) {
+                    for (k = 0; k < channels; k++) {
+                        v[(y * w + x) * channels + k] =
+                            ((gdouble) x * (k + 1) / w + (gdouble) y / h) / (k + 2);
+                    }
+                }
+            }
+            break;
+        case BENCH_IMAGE_TEXT:
+            for (i = 0; i < w * h * channels; i++) {
+                v[i] = 0.9;
+            }
+            /* lines of 8x12 glyphs, each one made of a few random strokes */
+            for (y0 = 4; y0 + 12 < h; y0 += 18) {
+                for (x0 = 4; x0 + 8 < w; x0 += 10) {
+                    if (rng_next() < 0.15) {
+                        continue;
+                    }
+                    ink = 0.1 * rng_next();
+                    for (s = 0; s < 3; s++) {
+                        gint stroke = (gint) (rng_next() * 6);
+                        for (i = 0; i < 12; i++) {
+                            switch (stroke) {
+                                case 0:        /* left bar */
+                                    x = x0;
+                                    y = y0 + i;
+                                    break;
+                                case 1:        /* right bar */
+                                    x = x0 + 7;
+                                    y = y0 + i;
+                                    break;
+                                case 2:        /* top bar */
+                                    x = x0 + i * 8 / 12;
+                                    y = y0;
+                                    break;
+                                case 3:        /* middle bar */
+                                    x = x0 + i * 8 / 12;
+                                    y = y0 + 6;
+                                    break;
+                                case 4:        /* bottom bar */
+                                    x = x0 + i * 8 / 12;
+                                    y = y0 + 11;
+                                    break;
+                                default:       /* diagonal */
+                                    x = x0 + i * 8 / 12;
+                                    y = y0 + i;
+                                    break;
+                            }
+                            for (k = 0; k < n_colour; k++) {
+                                v[(y * w + x) * channels + k] = ink;
+                            }
+                        }
+                    }
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (n_colour < channels) {
+        for (i = 0; i < w * h; i++) {
+            v[i * channels + n_colour] = 1;
+        }
+    }
+}
+
+/* convert a plane of values in [0,1] to the given colour depth */
+static void *
+image_convert(const gdouble *v, gint n, LqrColDepth col_depth)
+{
+    gint i;
+    guchar *b8;
+    guint16 *b16;
+    gfloat *b32;
+    gdouble *b64;
+
+    switch (col_depth) {
+        case LQR_COLDEPTH_8I:
+            b8 = g_new(guchar, n);
+            for (i = 0; i < n; i++) {
+                b8[i] = (guchar) (v[i] * 255 + 0.5);
+            }
+            return b8;
+        case LQR_COLDEPTH_16I:
+            b16 = g_new(guint16, n);
+            for (i = 0; i < n; i++) {
+                b16[i] = (guint16) (v[i] * 65535 + 0.5);
+            }
+            return b16;
+        case LQR_COLDEPTH_32F:
+            b32 = g_new(gfloat, n);
+            for (i = 0; i < n; i++) {
+                b32[i] = (gfloat) v[i];
+            }
+            return b32;
+        case LQR_COLDEPTH_64F:
+            b64 = g_new(gdouble, n);
+            memcpy(b64, v, n * sizeof(gdouble));
+            return b64;
+        default:
+            return NULL;
+    }
+}
+
+static gint
+depth_size(LqrColDepth col_depth)
+{
+    switch (col_depth) {
+        case LQR_COLDEPTH_8I:
+            return 1;
+        case LQR_COLDEPTH_16I:
+            return 2;
+        case LQR_COLDEPTH_32F:
+            return 4;
+        case LQR_COLDEPTH_64F:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+/*** custom energy function ***/
+
+/* sum of the absolute x and y derivatives of the colour channels
+ * (uses the RGBA reader, unlike the builtin functions) */
+static gfloat
+energy_custom(gint x, gint y, gint img_width, gint img_height, LqrReadingWindow *rwindow, gpointer extra_data)
+{
+    gint k;
+    gint xl = (x > 0) ? -1 : 0;
+    gint xr = (x < img_width - 1) ? 1 : 0;
+    gint yl = (y > 0) ? -1 : 0;
+    gint yr = (y < img_height - 1) ? 1 : 0;
+    gdouble e = 0;
+
+    for (k = 0; k < 3; k++) {
+        e += fabs(lqr_rwindow_read(rwindow, xr, 0, k) - lqr_rwindow_read(rwindow, xl, 0, k));
+        e += fabs(lqr_rwindow_read(rwindow, 0, yr, k) - lqr_rwindow_read(rwindow, 0, yl, k));
+    }
+
+    return (gfloat) e;
+}
+
+/*** benchmark ***/
+
+struct _BenchResult {
+    gdouble min;
+    gdouble median;
+    gdouble mean;
+    gsize peak_map_bytes;
+    guint32 hash;
+    LqrRetVal ret_val;
+};
+
+typedef struct _BenchResult BenchResult;
+
+/* FNV-1a checksum of the output image */
+static guint32
+output_hash(LqrCarver *r, gint sample_size)
+{
+    guint32 h = 2166136261u;
+    gint x, y, i;
+    guchar *rgb;
+    gint n = lqr_carver_get_channels(r) * sample_size;
+
+    lqr_carver_scan_reset(r);
+    while (lqr_carver_scan_ext(r, &x, &y, (void **) &rgb)) {
+        for (i = 0; i < n; i++) {
+            h = (h ^ rgb[i]) * 16777619u;
+        }
+    }
+    return h;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    gdouble da = *(const gdouble *) a;
+    gdouble db = *(const gdouble *) b;
+    return (da > db) - (da < db);
+}
+
+static BenchResult
+bench_run(const BenchCase *bc, const void *image, gint w, gint h, const BenchFormat *fmt)
+{
+    BenchResult res;
+    gdouble *times = g_new(gdouble, n_repeat);
+    gsize image_bytes = (gsize) w * h * fmt->channels * depth_size(fmt->col_depth);
+    GTimer *timer = g_timer_new();
+    LqrCarverStats stats;
+    gint i;
+
+    memset(&res, 0, sizeof(res));
+
+    for (i = 0; i < n_repeat; i++) {
+        void *buffer = g_malloc(image_bytes);
+        LqrCarver *r;
+
+        memcpy(buffer, image, image_bytes);
+        r = lqr_carver_new_ext(buffer, w, h, fmt->channels, fmt->col_depth);
+        if (r == NULL) {
+            g_free(buffer);
+            res.ret_val = LQR_NOMEM;
+            break;
+        }
+        /* (the carver owns the buffer from here on) */
+        res.ret_val = lqr_carver_init(r, bc->delta_x, bc->rigidity);
+        if (res.ret_val != LQR_OK) {
+            lqr_carver_destroy(r);
+            break;
+        }
+        lqr_carver_set_use_cache(r, bc->use_cache);
+        if (bc->energy == BENCH_ENERGY_CUSTOM) {
+            lqr_carver_set_energy_function(r, energy_custom, 1, LQR_ER_RGBA, NULL);
+        } else {
+            lqr_carver_set_energy_function_builtin(r, bc->energy);
+        }
+        lqr_carver_set_collect_stats(r, TRUE);
+
+        g_timer_start(timer);
+        res.ret_val = lqr_carver_resize(r, (gint) (w * bc->width_factor), (gint) (h * bc->height_factor));
+        g_timer_stop(timer);
+
+        times[i] = g_timer_elapsed(timer, NULL);
+        res.mean += times[i] / n_repeat;
+
+        if (i == 0) {
+            lqr_carver_get_stats(r, &stats);
+            res.peak_map_bytes = stats.peak_map_bytes;
+            res.hash = output_hash(r, depth_size(fmt->col_depth));
+        }
+
+        lqr_carver_destroy(r);
+    }
+
+    if (i < n_repeat) {
+        /* setup failed: report an error row without timings */
+        res.min = res.median = res.mean = 0;
+        res.peak_map_bytes = 0;
+        res.hash = 0;
+    } else {
+        qsort(times, n_repeat, sizeof(gdouble), compare_doubles);
+        res.min = times[0];
+        res.median = (n_repeat % 2) ? times[n_repeat / 2] : (times[n_repeat / 2 - 1] + times[n_repeat / 2]) / 2;
+    }
+
+    g_timer_destroy(timer);
+    g_free(times);
+    return res;
+}
+
+static const gchar *
+energy_name(gint energy)
+{
+    switch (energy) {
+        case LQR_EF_GRAD_NORM:
+            return "norm";
+        case LQR_EF_GRAD_SUMABS:
+            return "sumabs";
+        case LQR_EF_GRAD_XABS:
+            return "xabs";
+        case LQR_EF_LUMA_GRAD_NORM:
+            return "luma-norm";
+        case LQR_EF_LUMA_GRAD_SUMABS:
+            return "luma-sumabs";
+        case LQR_EF_LUMA_GRAD_XABS:
+            return "luma-xabs";
+        case LQR_EF_NULL:
+            return "null";
+        case BENCH_ENERGY_CUSTOM:
+            return "custom";
+        default:
+            return "unknown";
+    }
+}
+
+static const gchar *
+ret_val_name(LqrRetVal ret_val)
+{
+    switch (ret_val) {
+        case LQR_OK:
+            return "";
+        case LQR_NOMEM:
+            return "nomem";
+        case LQR_USRCANCEL:
+            return "cancelled";
+        default:
+            return "error";
+    }
+}
+
+static void
+print_result(FILE *out, gboolean first, const BenchCase *bc, BenchImageKind kind, gint w, gint h,
+             const BenchFormat *fmt, const BenchResult *res)
+{
+    gint w1 = (gint) (w * bc->width_factor);
+    gint h1 = (gint) (h * bc->height_factor);
+
+    if (output_json) {
+        fprintf(out, "%s\n    {\"case\": \"%s\", \"image\": \"%s\", \"width\": %i, \"height\": %i, "
+                "\"channels\": %i, \"depth\": \"%s\", \"new_width\": %i, \"new_height\": %i, "
+                "\"delta_x\": %i, \"rigidity\": %g, \"rcache\": %s, \"energy\": \"%s\", \"repeat\": %i, "
+                "\"min_s\": %.6f, \"median_s\": %.6f, \"mean_s\": %.6f, \"peak_map_bytes\": %lu, "
+                "\"hash\": \"%08x\", \"ok\": %s, \"error\": \"%s\"}",
+                first ? "" : ",", bc->name, image_names[kind], w, h, fmt->channels, depth_names[fmt->col_depth],
+                w1, h1, bc->delta_x, bc->rigidity, bc->use_cache ? "true" : "false", energy_name(bc->energy),
+                n_repeat, res->min, res->median, res->mean, (unsigned long) res->peak_map_bytes, res->hash,
+                res->ret_val == LQR_OK ? "true" : "false", ret_val_name(res->ret_val));
+    } else {
+        fprintf(out, "%s,%s,%i,%i,%i,%s,%i,%i,%i,%g,%i,%s,%i,%.6f,%.6f,%.6f,%lu,%08x,%i,%s\n",
+                bc->name, image_names[kind], w, h, fmt->channels, depth_names[fmt->col_depth], w1, h1,
+                bc->delta_x, bc->rigidity, bc->use_cache ? 1 : 0, energy_name(bc->energy), n_repeat,
+                res->min, res->median, res->mean, (unsigned long) res->peak_map_bytes, res->hash,
+                res->ret_val == LQR_OK ? 1 : 0, ret_val_name(res->ret_val));
+    }
+    fflush(out);
+}
+
+/*** command line parsing ***/
+
+static void
+help(const gchar *name)
+{
+    printf("Usage: %s [ options ]\n", name);
+    printf("  Times lqr_carver_resize on a fixed set of synthetic images.\n");
+    printf("  Options:\n");
+    printf("    -f <fmt> or --format <fmt>\n");
+    printf("        Output format: csv (default) or json.\n");
+    printf("    -o <file> or --output <file>\n");
+    printf("        Write the results to <file> instead of the standard output.\n");
+    printf("    -r <n> or --repeat <n>\n");
+    printf("        Number of timed runs for each case (default 3).\n");
+    printf("    -c <name> or --case <name>\n");
+    printf("        Only run the cases whose name contains <name>.\n");
+    printf("    -q or --quick\n");
+    printf("        Only use the smallest image size.\n");
+    printf("    -l or --large\n");
+    printf("        Also use a %ix%i image size.\n", sizes[N_SIZES - 1].width, sizes[N_SIZES - 1].height);
+    printf("    -h or --help\n");
+    printf("        This help screen.\n");
+}
+
+static gboolean
+parse_command_line(int argc, char **argv)
+{
+    int c;
+    struct option lopts[] = {
+        {"format", 1, 0, 'f'},
+        {"output", 1, 0, 'o'},
+        {"repeat", 1, 0, 'r'},
+        {"case", 1, 0, 'c'},
+        {"quick", 0, 0, 'q'},
+        {"large", 0, 0, 'l'},
+        {"help", 0, 0, 'h'},
+        {NULL, 0, 0, 0}
+    };
+
+    while ((c = getopt_long(argc, argv, "f:o:r:c:qlh", lopts, NULL)) != EOF) {
+        switch (c) {
+            case 'f':
+                if (strcmp(optarg, "json") == 0) {
+                    output_json = TRUE;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    output_json = FALSE;
+                } else {
+                    fprintf(stderr, "Unknown output format: %s\n", optarg);
+                    return FALSE;
+                }
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
+            case 'r':
+                n_repeat = atoi(optarg);
+                if (n_repeat < 1) {
+                    fprintf(stderr, "The number of runs should be positive\n");
+                    return FALSE;
+                }
+                break;
+            case 'c':
+                case_filter = optarg;
+                break;
+            case 'q':
+                quick = TRUE;
+                break;
+            case 'l':
+                large = TRUE;
+                break;
+            case 'h':
+                help(argv[0]);
+                exit(0);
+            default:
+                help(argv[0]);
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*** MAIN ***/
+
+int
+main(int argc, char **argv)
+{
+    FILE *out = stdout;
+    gint s, n_sizes, kind, f, c;
+    gboolean first = TRUE;
+
+    if (!parse_command_line(argc, argv)) {
+        return 1;
+    }
+
+    if (output_file != NULL) {
+        out = fopen(output_file, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Can't open %s for writing\n", output_file);
+            return 1;
+        }
+    }
+
+    n_sizes = quick ? 1 : (large ? N_SIZES : N_SIZES - 1);
+
+    if (output_json) {
+        fprintf(out, "{\"results\": [");
+    } else {
+        fprintf(out, "case,image,width,height,channels,depth,new_width,new_height,delta_x,rigidity,"
+                "rcache,energy,repeat,min_s,median_s,mean_s,peak_map_bytes,hash,ok,error\n");
+    }
+
+    for (s = 0; s < n_sizes; s++) {
+        gint w = sizes[s].width;
+        gint h = sizes[s].height;
+        for (kind = 0; kind < BENCH_IMAGE_N_KINDS; kind++) {
+            for (f = 0; f < N_FORMATS; f++) {
+                gdouble *plane = g_new(gdouble, w * h * formats[f].channels);
+                void *image;
+
+                image_fill(plane, kind, w, h, formats[f].channels);
+                image = image_convert(plane, w * h * formats[f].channels, formats[f].col_depth);
+                g_free(plane);
+
+                for (c = 0; c < N_CASES; c++) {
+                    BenchResult res;
+                    if ((f > 0) && !cases[c].all_formats) {
+                        continue;
+                    }
+                    if ((case_filter != NULL) && (strstr(cases[c].name, case_filter) == NULL)) {
+                        continue;
+                    }
+                    res = bench_run(&cases[c], image, w, h, &formats[f]);
+                    print_result(out, first, &cases[c], kind, w, h, &formats[f], &res);
+                    first = FALSE;
+                }
+
+                g_free(image);
+            }
+        }
+    }
+
+    if (output_json) {
+        fprintf(out, "\n]}\n");
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    return 0;
+}
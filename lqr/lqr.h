@@ -38,7 +38,13 @@ G_BEGIN_DECLS
 #include <lqr/lqr_carver_list_pub.h>
 #include <lqr/lqr_carver_bias_pub.h>
 #include <lqr/lqr_carver_rigmask_pub.h>
+#include <lqr/lqr_carver_scratch_pub.h>
+#include <lqr/lqr_carver_stats_pub.h>
+#include <lqr/lqr_trace_pub.h>
 #include <lqr/lqr_carver_pub.h>
+#include <lqr/lqr_layer_pub.h>
+#include <lqr/lqr_strip_carver_pub.h>
+#include <lqr/lqr_batch_pub.h>
 
 G_END_DECLS
 
@@ -38,7 +38,13 @@ G_BEGIN_DECLS
 #include <lqr/lqr_carver_list.h>
 #include <lqr/lqr_carver_bias.h>
 #include <lqr/lqr_carver_rigmask.h>
+#include <lqr/lqr_carver_scratch.h>
+#include <lqr/lqr_carver_stats.h>
+#include <lqr/lqr_trace.h>
 #include <lqr/lqr_carver.h>
+#include <lqr/lqr_layer.h>
+#include <lqr/lqr_strip_carver.h>
+#include <lqr/lqr_batch.h>
 
 G_END_DECLS
 
@@ -126,6 +126,23 @@ enum _LqrResizeOrder {
 
 typedef enum _LqrResizeOrder LqrResizeOrder;
 
+/**** RESIZE STRATEGY ****/
+enum _LqrResizeStrategy {
+    LQR_RES_STRATEGY_SEAMS,     /* all the seams were carved */
+    LQR_RES_STRATEGY_UNIFORM    /* the deadline was hit: the rest was scaled uniformly */
+};
+
+typedef enum _LqrResizeStrategy LqrResizeStrategy;
+
+/**** INSERTION KERNEL ****/
+enum _LqrInsKernel {
+    LQR_INS_KERNEL_AVERAGE,     /* average of the two neighbors */
+    LQR_INS_KERNEL_CUBIC,       /* four-tap cubic along the row */
+    LQR_INS_KERNEL_ENERGY       /* neighbors weighted by their local energy */
+};
+
+typedef enum _LqrInsKernel LqrInsKernel;
+
 /**** IMAGE TYPE ****/
 enum _LqrImageType {
     LQR_RGB_IMAGE,
@@ -146,4 +163,8 @@ struct _LqrCarver;
 
 typedef struct _LqrCarver LqrCarver;
 
+struct _LqrLayer;
+
+typedef struct _LqrLayer LqrLayer;
+
 #endif /* __LQR_BASE_H__ */
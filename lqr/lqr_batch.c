@@ -0,0 +1,223 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <glib.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif /* _OPENMP */
+
+#include <lqr/lqr_all.h>
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_BATCH CLASS FUNCTIONS ****/
+
+/*** constructor & destructor ***/
+
+/* constructor */
+/* LQR_PUBLIC */
+LqrBatch *
+lqr_batch_new(void)
+{
+    LqrBatch *b;
+
+    LQR_TRY_N_N(b = g_try_new(LqrBatch, 1));
+
+    b->n_jobs = 0;
+    b->room = LQR_BATCH_DEFAULT_ROOM;
+    b->done_func = NULL;
+    b->done_data = NULL;
+
+    if ((b->jobs = g_try_new(LqrBatchJob, b->room)) == NULL) {
+        g_free(b);
+        return NULL;
+    }
+
+    return b;
+}
+
+/* destructor (the queued carvers are not destroyed) */
+/* LQR_PUBLIC */
+void
+lqr_batch_destroy(LqrBatch *b)
+{
+    g_free(b->jobs);
+    g_free(b);
+}
+
+/*** set hooks ***/
+
+/* the function is called after each resize, with the carver and
+ * the outcome of the resize; calls are serialized, so the function
+ * needs no locking of its own, but it may be called from any of
+ * the worker threads */
+/* LQR_PUBLIC */
+void
+lqr_batch_set_done_func(LqrBatch *b, LqrBatchDoneFunc done_func, gpointer data)
+{
+    b->done_func = done_func;
+    b->done_data = data;
+}
+
+/*** queue & run ***/
+
+/* queue a carver to be resized to the given size
+ * (the carvers must be independent of each other: attached
+ * carvers and carvers which are already queued are refused) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_batch_add(LqrBatch *b, LqrCarver *r, gint width, gint height)
+{
+    LqrBatchJob *new_jobs;
+    gint i;
+
+    LQR_CATCH_F(r != NULL);
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_F((width >= 1) && (height >= 1));
+    for (i = 0; i < b->n_jobs; i++) {
+        LQR_CATCH_F(b->jobs[i].carver != r);
+    }
+
+    if (b->n_jobs == b->room) {
+        LQR_CATCH_MEM(new_jobs = g_try_renew(LqrBatchJob, b->jobs, 2 * b->room));
+        b->jobs = new_jobs;
+        b->room *= 2;
+    }
+
+    b->jobs[b->n_jobs].carver = r;
+    b->jobs[b->n_jobs].w1 = width;
+    b->jobs[b->n_jobs].h1 = height;
+    b->jobs[b->n_jobs].order = b->n_jobs;
+    b->jobs[b->n_jobs].ret_val = LQR_OK;
+    b->n_jobs++;
+
+    return LQR_OK;
+}
+
+gint
+lqr_batch_job_size(LqrBatchJob *job)
+{
+    return job->carver->w0 * job->carver->h0;
+}
+
+/* larger jobs first, then queue order */
+gint
+lqr_batch_job_compare(gconstpointer a, gconstpointer b)
+{
+    LqrBatchJob *job_a = (LqrBatchJob *) a;
+    LqrBatchJob *job_b = (LqrBatchJob *) b;
+    gint size_a = lqr_batch_job_size(job_a);
+    gint size_b = lqr_batch_job_size(job_b);
+
+    if (size_a != size_b) {
+        return (size_a > size_b) ? -1 : 1;
+    }
+    return job_a->order - job_b->order;
+}
+
+/* resize the carver of the job, with n_threads threads
+ * for its parallel phases */
+void
+lqr_batch_run_job(LqrBatch *b, LqrBatchJob *job, gint n_threads)
+{
+    gint prev_threads = job->carver->n_threads;
+
+    job->carver->n_threads = n_threads;
+    job->ret_val = lqr_carver_resize(job->carver, job->w1, job->h1);
+    job->carver->n_threads = prev_threads;
+
+    if (b->done_func != NULL) {
+#ifdef _OPENMP
+#pragma omp critical (lqr_batch_done)
+#endif /* _OPENMP */
+        b->done_func(job->carver, job->ret_val, b->done_data);
+    }
+}
+
+/* resize all the queued carvers, then empty the queue;
+ * large images are processed one at a time, splitting their
+ * parallel phases (energy map and inflation rows, attached
+ * carvers, etc.) over all the threads, while the remaining
+ * ones are handed out one per thread, largest first, to
+ * whichever thread is free. Hence the energy functions are
+ * called concurrently and must be reentrant.
+ * n_threads = 0 means the OpenMP default number of threads;
+ * the process-wide OpenMP setting is left untouched.
+ * Without OpenMP support the carvers are resized one after
+ * the other in the calling thread, whatever n_threads.
+ * The return value is the outcome of the first queued
+ * carver which failed (LQR_OK if none did) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_batch_run(LqrBatch *b, gint n_threads)
+{
+    gint i, n_large;
+    gint first_failed;
+    LqrRetVal ret_val = LQR_OK;
+
+    LQR_CATCH_F(n_threads >= 0);
+
+#ifdef _OPENMP
+    if (n_threads == 0) {
+        n_threads = omp_get_max_threads();
+    }
+#else
+    n_threads = 1;
+#endif /* _OPENMP */
+
+    qsort(b->jobs, b->n_jobs, sizeof(LqrBatchJob), lqr_batch_job_compare);
+
+    for (n_large = 0; (n_large < b->n_jobs) && (lqr_batch_job_size(&b->jobs[n_large]) >= LQR_BATCH_LARGE_SIZE);
+         n_large++) {
+    }
+
+    for (i = 0; i < n_large; i++) {
+        lqr_batch_run_job(b, &b->jobs[i], n_threads);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+#endif /* _OPENMP */
+    for (i = n_large; i < b->n_jobs; i++) {
+        lqr_batch_run_job(b, &b->jobs[i], 1);
+    }
+
+    first_failed = b->n_jobs;
+    for (i = 0; i < b->n_jobs; i++) {
+        if ((b->jobs[i].ret_val != LQR_OK) && (b->jobs[i].order < first_failed)) {
+            first_failed = b->jobs[i].order;
+            ret_val = b->jobs[i].ret_val;
+        }
+    }
+
+    b->n_jobs = 0;
+
+    return ret_val;
+}
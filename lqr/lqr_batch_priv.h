@@ -0,0 +1,64 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_BATCH_PRIV_H__
+#define __LQR_BATCH_PRIV_H__
+
+#ifndef __LQR_CARVER_H__
+#error "lqr_carver.h must be included prior to lqr_batch_priv.h"
+#endif /* __LQR_CARVER_H__ */
+
+/* images with at least this many points are carved one at
+ * a time, each one using all the threads in its parallel
+ * phases; smaller images are carved one per thread */
+#define LQR_BATCH_LARGE_SIZE (1 << 20)
+
+/* initial room in the job queue */
+#define LQR_BATCH_DEFAULT_ROOM (16)
+
+/*** LQR_BATCH CLASS DEFINITION ***/
+
+struct _LqrBatchJob {
+    LqrCarver *carver;                  /* carver to be resized */
+    gint w1, h1;                        /* target size */
+    gint order;                         /* position in the queue */
+    LqrRetVal ret_val;                  /* outcome of the resize */
+};
+
+typedef struct _LqrBatchJob LqrBatchJob;
+
+struct _LqrBatch {
+    LqrBatchJob *jobs;                  /* queued jobs */
+    gint n_jobs;                        /* number of queued jobs */
+    gint room;                          /* allocated size of the queue */
+
+    LqrBatchDoneFunc done_func;         /* called after each job */
+    gpointer done_data;
+};
+
+/* LQR_BATCH CLASS PRIVATE FUNCTIONS */
+
+gint lqr_batch_job_size(LqrBatchJob *job);
+gint lqr_batch_job_compare(gconstpointer a, gconstpointer b);
+void lqr_batch_run_job(LqrBatch *b, LqrBatchJob *job, gint n_threads);
+
+#endif /* __LQR_BATCH_PRIV_H__ */
@@ -25,6 +25,11 @@
 #endif
 
 #include <math.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif /* _OPENMP */
 
 #include <lqr/lqr_all.h>
 
@@ -47,9 +52,14 @@ lqr_carver_new_common(gint width, gint height, gint channels)
 {
     LqrCarver *r;
 
+    if (!LQR_POINTS_FIT(width, height)) {
+        return NULL;
+    }
+
     LQR_TRY_N_N(r = g_try_new(LqrCarver, 1));
 
     g_atomic_int_set(&r->state, LQR_CARVER_STATE_STD);
+    r->state_p = &r->state;
     g_atomic_int_set(&r->state_lock, 0);
     g_atomic_int_set(&r->state_lock_queue, 0);
 
@@ -63,18 +73,51 @@ lqr_carver_new_common(gint width, gint height, gint channels)
     r->resize_aux_layers = FALSE;
     r->dump_vmaps = FALSE;
     r->resize_order = LQR_RES_ORDER_HOR;
+    r->deadline = 0;
+    r->deadline_timer = NULL;
+    r->deadline_cost[LQR_DEADLINE_MAPS] = LQR_DEADLINE_COST_MAPS;
+    r->deadline_cost[LQR_DEADLINE_SEAM] = LQR_DEADLINE_COST_SEAM;
+    r->deadline_cost[LQR_DEADLINE_UNIFORM] = LQR_DEADLINE_COST_UNIFORM;
+    r->deadline_cost[LQR_DEADLINE_INFLATE] = LQR_DEADLINE_COST_INFLATE;
+    r->deadline_cost[LQR_DEADLINE_FLATTEN] = LQR_DEADLINE_COST_FLATTEN;
+    r->deadline_cost[LQR_DEADLINE_TRANSPOSE] = LQR_DEADLINE_COST_TRANSPOSE;
+    r->deadline_stop = 0;
+    r->deadline_next = 0;
+    r->deadline_watch = FALSE;
+    r->deadline_hit = FALSE;
+    r->deadline_flatten = FALSE;
+    r->res_strategy = LQR_RES_STRATEGY_SEAMS;
+    r->canc_rows = 1;
     r->attached_list = NULL;
+    r->layers = NULL;
     r->flushed_vs = NULL;
     r->preserve_in_buffer = FALSE;
+    r->scratch_dir = NULL;
+    r->scratch_threshold = LQR_SCRATCH_DEFAULT_THRESHOLD;
+    r->scratch_chunks = NULL;
+    r->map_bytes = 0;
+    r->collect_stats = FALSE;
+    r->stats_timer = NULL;
+    lqr_carver_reset_stats(r);
+    r->trace = NULL;
+    r->trace_depth = 0;
     LQR_TRY_N_N(r->progress = lqr_progress_new());
     r->session_update_step = 1;
     r->session_rescale_total = 0;
     r->session_rescale_current = 0;
+    r->session_update_countdown = 0;
+    r->session_timer = NULL;
 
     r->en = NULL;
     r->bias = NULL;
+    r->nrg_buffer = NULL;
+    r->nrg_func_weight = 1;
     r->m = NULL;
     r->least = NULL;
+    r->least_alt = NULL;
+    r->least_compact = TRUE;
+    r->min_queue = NULL;
+    r->min_queue_size = 0;
     r->_raw = NULL;
     r->raw = NULL;
     r->vpath = NULL;
@@ -95,6 +138,20 @@ lqr_carver_new_common(gint width, gint height, gint channels)
     r->rcache = NULL;
     r->use_rcache = TRUE;
 
+    r->incremental_edits = FALSE;
+    r->base_en = NULL;
+    r->base_m = NULL;
+    r->base_least = NULL;
+    r->base_leftright = 0;
+    r->base_nrg_quant_scale = 0;
+    r->base_nrg_quant_max = 0;
+    r->mmap_uptodate = FALSE;
+
+    r->nrg_quant = FALSE;
+    r->nrg_quant_scale = 0;
+    r->nrg_quant_max = 0;
+    lqr_carver_edit_clear(r);
+
     r->rwindow = NULL;
     lqr_carver_set_energy_function_builtin(r, LQR_EF_GRAD_XABS);
     r->nrg_xmin = NULL;
@@ -103,10 +160,14 @@ lqr_carver_new_common(gint width, gint height, gint channels)
 
     r->leftright = 0;
     r->lr_switch_frequency = 0;
+    r->n_slices = 0;
+    r->n_threads = 0;
 
     r->enl_step = 2.0;
+    r->ins_kernel = LQR_INS_KERNEL_AVERAGE;
 
-    LQR_TRY_N_N(r->vs = g_try_new0(gint, r->w * r->h));
+    r->vs_compact = VS_USE_COMPACT(r->w);
+    LQR_TRY_N_N(r->vs = VS_TRY_NEW0(r, r->vs_compact, (gsize) r->w * r->h));
 
     /* initialize cursor */
 
@@ -166,17 +227,22 @@ void
 lqr_carver_destroy(LqrCarver *r)
 {
     if (!r->preserve_in_buffer) {
-        g_free(r->rgb);
+        lqr_carver_scratch_free(r, r->rgb);
     }
     if (r->root == NULL) {
-        g_free(r->vs);
+        lqr_carver_scratch_free(r, r->vs);
     }
     g_free(r->rgb_ro_buffer);
-    g_free(r->en);
-    g_free(r->bias);
-    g_free(r->m);
-    g_free(r->rcache);
-    g_free(r->least);
+    lqr_carver_scratch_free(r, r->en);
+    lqr_carver_scratch_free(r, r->bias);
+    lqr_carver_scratch_free(r, r->nrg_buffer);
+    lqr_carver_base_maps_free(r);
+    lqr_carver_scratch_free(r, r->m);
+    lqr_carver_scratch_free(r, r->rcache);
+    lqr_carver_scratch_free(r, r->least);
+    lqr_carver_scratch_free(r, r->least_alt);
+    r->least_alt = NULL;
+    g_free(r->min_queue);
     lqr_cursor_destroy(r->c);
     g_free(r->vpath);
     g_free(r->vpath_x);
@@ -184,18 +250,218 @@ lqr_carver_destroy(LqrCarver *r)
         r->rigidity_map -= r->delta_x;
         g_free(r->rigidity_map);
     }
-    g_free(r->rigidity_mask);
+    lqr_carver_scratch_free(r, r->rigidity_mask);
     lqr_rwindow_destroy(r->rwindow);
     g_free(r->nrg_xmin);
     g_free(r->nrg_xmax);
     lqr_vmap_list_destroy(r->flushed_vs);
     lqr_carver_list_destroy(r->attached_list);
+    lqr_layer_list_destroy(r->layers);
     g_free(r->progress);
-    g_free(r->_raw);
+    lqr_carver_scratch_free(r, r->_raw);
     g_free(r->raw);
+    lqr_carver_scratch_destroy(r);
+    if (r->stats_timer != NULL) {
+        g_timer_destroy(r->stats_timer);
+    }
+    if (r->session_timer != NULL) {
+        g_timer_destroy(r->session_timer);
+    }
+    if (r->deadline_timer != NULL) {
+        g_timer_destroy(r->deadline_timer);
+    }
     g_free(r);
 }
 
+/* re-arm the carver with a new image
+ * (the configuration is kept, and the internal maps
+ * are reused whenever they are large enough).
+ * All the new maps are allocated before anything is
+ * changed, so that on failure the carver is left as it was.
+ * As with lqr_carver_new(), the carver takes ownership of
+ * the new buffer: lqr_carver_set_preserve_input_image()
+ * has to be called again after the reset to keep it
+ * (the flag only refers to the buffer it was set for) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_reset_image(LqrCarver *r, void *buffer, gint width, gint height)
+{
+    gint x, y;
+    gsize size;
+    gboolean grow_vs, grow_maps, grow_rows, grow_raw, grow_raw_rows;
+    gboolean ok = TRUE;
+    gpointer new_vs = NULL;
+    gfloat *new_en = NULL;
+    gfloat *new_m = NULL;
+    void *new_least = NULL;
+    void *new_rgb_ro_buffer = NULL;
+    gint *new_vpath = NULL;
+    gint *new_vpath_x = NULL;
+    gint *new_nrg_xmin = NULL;
+    gint *new_nrg_xmax = NULL;
+    gint *new__raw = NULL;
+    gint **new_raw = NULL;
+
+    LQR_CATCH_F(buffer != NULL);
+    LQR_CATCH_F((width >= 1) && (height >= 1));
+    LQR_CATCH_F(LQR_POINTS_FIT(width, height));
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_F(r->attached_list == NULL);
+    LQR_CATCH_F(r->layers == NULL);
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(g_atomic_int_get(&r->state) == LQR_CARVER_STATE_STD);
+
+    size = (gsize) width * height;
+
+    /* all the current maps have (at least) size w0 * h0,
+     * except for the raw array which has size w_start * h_start */
+    grow_vs = (size > (gsize) r->w0 * r->h0) || (VS_USE_COMPACT(width) != r->vs_compact);
+    grow_maps = size > (gsize) r->w0 * r->h0;
+    grow_rows = r->active && (height > r->h0);
+    grow_raw = r->nrg_active && (size > (gsize) r->w_start * r->h_start);
+    grow_raw_rows = r->nrg_active && (height > r->h_start);
+
+    /* allocate the new maps */
+    if (grow_vs) {
+        ok = (new_vs = VS_TRY_NEW0(r, VS_USE_COMPACT(width), size)) != NULL;
+    }
+    if (ok && grow_maps && r->nrg_active) {
+        ok = (new_en = LQR_SCRATCH_TRY_NEW(r, gfloat, size)) != NULL;
+    }
+    if (ok && grow_maps && r->active) {
+        ok = ((new_m = LQR_SCRATCH_TRY_NEW(r, gfloat, size)) != NULL) &&
+            ((new_least = LEAST_TRY_NEW(r, size)) != NULL);
+    }
+    if (ok && (width > r->w0)) {
+        ok = (new_rgb_ro_buffer = g_try_malloc0(width * LQR_SAMPLE_SIZE(r->col_depth) * r->channels)) != NULL;
+    }
+    if (ok && grow_rows) {
+        ok = ((new_vpath = g_try_new(gint, height)) != NULL) &&
+            ((new_vpath_x = g_try_new(gint, height)) != NULL) &&
+            ((new_nrg_xmin = g_try_new(gint, height)) != NULL) &&
+            ((new_nrg_xmax = g_try_new(gint, height)) != NULL);
+    }
+    if (ok && grow_raw) {
+        ok = (new__raw = LQR_SCRATCH_TRY_NEW(r, gint, size)) != NULL;
+    }
+    if (ok && grow_raw_rows) {
+        ok = (new_raw = g_try_new(gint *, height)) != NULL;
+    }
+
+    if (!ok) {
+        lqr_carver_scratch_free(r, new_vs);
+        lqr_carver_scratch_free(r, new_en);
+        lqr_carver_scratch_free(r, new_m);
+        lqr_carver_scratch_free(r, new_least);
+        g_free(new_rgb_ro_buffer);
+        g_free(new_vpath);
+        g_free(new_vpath_x);
+        g_free(new_nrg_xmin);
+        g_free(new_nrg_xmax);
+        lqr_carver_scratch_free(r, new__raw);
+        g_free(new_raw);
+        return LQR_NOMEM;
+    }
+
+    /* substitute the image */
+    if (!r->preserve_in_buffer) {
+        lqr_carver_scratch_free(r, r->rgb);
+    }
+    r->rgb = buffer;
+    r->preserve_in_buffer = FALSE;
+
+    /* substitute the maps */
+    if (grow_vs) {
+        lqr_carver_scratch_free(r, r->vs);
+        r->vs = new_vs;
+        r->vs_compact = VS_USE_COMPACT(width);
+    } else {
+        memset(r->vs, 0, size * VS_SIZEOF(r->vs_compact));
+    }
+    if (grow_maps && r->nrg_active) {
+        lqr_carver_scratch_free(r, r->en);
+        r->en = new_en;
+    }
+    if (grow_maps && r->active) {
+        lqr_carver_scratch_free(r, r->m);
+        r->m = new_m;
+        lqr_carver_scratch_free(r, r->least);
+        r->least = new_least;
+        lqr_carver_scratch_free(r, r->least_alt);
+        r->least_alt = NULL;
+    }
+    if (new_rgb_ro_buffer != NULL) {
+        g_free(r->rgb_ro_buffer);
+        r->rgb_ro_buffer = new_rgb_ro_buffer;
+    }
+    if (grow_rows) {
+        g_free(r->vpath);
+        r->vpath = new_vpath;
+        g_free(r->vpath_x);
+        r->vpath_x = new_vpath_x;
+        g_free(r->nrg_xmin);
+        r->nrg_xmin = new_nrg_xmin;
+        g_free(r->nrg_xmax);
+        r->nrg_xmax = new_nrg_xmax;
+    }
+
+    if (r->nrg_active) {
+        if (grow_raw) {
+            lqr_carver_scratch_free(r, r->_raw);
+            r->_raw = new__raw;
+        }
+        if (grow_raw_rows) {
+            g_free(r->raw);
+            r->raw = new_raw;
+        }
+        for (y = 0; y < height; y++) {
+            r->raw[y] = r->_raw + y * width;
+            for (x = 0; x < width; x++) {
+                r->raw[y][x] = y * width + x;
+            }
+        }
+    }
+
+    /* masks and caches refer to the old image */
+    lqr_carver_scratch_free(r, r->bias);
+    r->bias = NULL;
+    lqr_carver_scratch_free(r, r->nrg_buffer);
+    r->nrg_buffer = NULL;
+    lqr_carver_base_maps_free(r);
+    lqr_carver_scratch_free(r, r->rigidity_mask);
+    r->rigidity_mask = NULL;
+    lqr_carver_scratch_free(r, r->rcache);
+    r->rcache = NULL;
+    r->nrg_uptodate = FALSE;
+
+    lqr_vmap_list_destroy(r->flushed_vs);
+    r->flushed_vs = NULL;
+
+    /* reset sizes, levels & orientation */
+    r->w = r->w0 = r->w_start = width;
+    r->h = r->h0 = r->h_start = height;
+    r->level = 1;
+    r->max_level = 1;
+    r->transposed = 0;
+    r->leftright = 0;
+
+    r->session_update_step = 1;
+    r->session_rescale_total = 0;
+    r->session_rescale_current = 0;
+    r->session_update_countdown = 0;
+
+    /* rigidity depends on the image height */
+    if (r->active) {
+        for (x = -r->delta_x; x <= r->delta_x; x++) {
+            r->rigidity_map[x] = r->rigidity * powf(fabsf(x), 1.5) / r->h;
+        }
+    }
+
+    lqr_cursor_reset(r->c);
+
+    return LQR_OK;
+}
+
 /*** initialization ***/
 
 LqrRetVal
@@ -206,8 +472,8 @@ lqr_carver_init_energy_related(LqrCarver *r)
     LQR_CATCH_F(r->active == FALSE);
     LQR_CATCH_F(r->nrg_active == FALSE);
 
-    LQR_CATCH_MEM(r->en = g_try_new(gfloat, r->w * r->h));
-    LQR_CATCH_MEM(r->_raw = g_try_new(gint, r->h_start * r->w_start));
+    LQR_CATCH_MEM(r->en = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) r->w * r->h));
+    LQR_CATCH_MEM(r->_raw = LQR_SCRATCH_TRY_NEW(r, gint, (gsize) r->h_start * r->w_start));
     LQR_CATCH_MEM(r->raw = g_try_new(gint *, r->h_start));
 
     for (y = 0; y < r->h; y++) {
@@ -237,8 +503,10 @@ lqr_carver_init(LqrCarver *r, gint delta_x, gfloat rigidity)
     }
 
     /* LQR_CATCH_MEM (r->bias = g_try_new0 (gfloat, r->w * r->h)); */
-    LQR_CATCH_MEM(r->m = g_try_new(gfloat, r->w * r->h));
-    LQR_CATCH_MEM(r->least = g_try_new(gint, r->w * r->h));
+    LQR_CATCH_MEM(r->m = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) r->w * r->h));
+    /* the minpath offsets fit in a gint8 unless delta_x is large */
+    r->least_compact = (delta_x <= LEAST_MAX_DELTA_X);
+    LQR_CATCH_MEM(r->least = LEAST_TRY_NEW(r, (gsize) r->w * r->h));
 
     LQR_CATCH_MEM(r->vpath = g_try_new(gint, r->h));
     LQR_CATCH_MEM(r->vpath_x = g_try_new(gint, r->h));
@@ -322,9 +590,10 @@ lqr_carver_set_image_type(LqrCarver *r, LqrImageType image_type)
     }
     r->image_type = image_type;
 
-    g_free(r->rcache);
+    lqr_carver_scratch_free(r, r->rcache);
     r->rcache = NULL;
     r->nrg_uptodate = FALSE;
+    lqr_carver_base_maps_free(r);
 
     return LQR_OK;
 }
@@ -361,9 +630,10 @@ lqr_carver_set_alpha_channel(LqrCarver *r, gint channel_index)
     }
 
     if (changed) {
-        g_free(r->rcache);
+        lqr_carver_scratch_free(r, r->rcache);
         r->rcache = NULL;
         r->nrg_uptodate = FALSE;
+        lqr_carver_base_maps_free(r);
     }
 
     return LQR_OK;
@@ -401,9 +671,10 @@ lqr_carver_set_black_channel(LqrCarver *r, gint channel_index)
     }
 
     if (changed) {
-        g_free(r->rcache);
+        lqr_carver_scratch_free(r, r->rcache);
         r->rcache = NULL;
         r->nrg_uptodate = FALSE;
+        lqr_carver_base_maps_free(r);
     }
 
     return LQR_OK;
@@ -449,9 +720,15 @@ lqr_carver_attach(LqrCarver *r, LqrCarver *aux)
     LQR_CATCH_F(r->h0 == aux->h0);
     LQR_CATCH_F(g_atomic_int_get(&r->state) == LQR_CARVER_STATE_STD);
     LQR_CATCH_F(g_atomic_int_get(&aux->state) == LQR_CARVER_STATE_STD);
+    /* the maps of the attached carver go where the root ones go */
+    if (aux->scratch_dir == NULL) {
+        LQR_CATCH(lqr_carver_scratch_set_dir(aux, r->scratch_dir));
+        aux->scratch_threshold = r->scratch_threshold;
+    }
     LQR_CATCH_MEM(r->attached_list = lqr_carver_list_append(r->attached_list, aux));
-    g_free(aux->vs);
+    lqr_carver_scratch_free(aux, aux->vs);
     aux->vs = r->vs;
+    aux->vs_compact = r->vs_compact;
     aux->root = r;
 
     return LQR_OK;
@@ -489,6 +766,70 @@ lqr_carver_set_side_switch_frequency(LqrCarver *r, guint switch_frequency)
     r->lr_switch_frequency = switch_frequency;
 }
 
+/* set a time budget (in microseconds) for each resize: the carving
+ * stops early enough for the work which has to be done anyway (the
+ * uniform scaling which then completes the size change, see
+ * lqr_carver_get_resize_strategy(), the enlargement and the
+ * transpositions) to fit in, and the time left is shared between the
+ * two directions. With a deadline, a reduction is flattened at its new
+ * size rather than inflated, so the carver does not keep the multisize
+ * image (resizing back to a larger size enlarges the reduced image).
+ * The costs of the phases are estimated from the timings of the
+ * previous resizes (rough defaults are used at first), so the budget
+ * may be exceeded by a margin of the order of the estimation errors.
+ * The work done anyway sets a floor below which a resize cannot go,
+ * whatever the budget: in each direction which changes, one pass over
+ * the image for the uniform scaling, one for the flattening (or the
+ * enlargement) and one for the transposition, i.e. some tens of
+ * nanoseconds per pixel in all. The energy and minpath maps are not
+ * started when they cannot be completed in time, and abandoned if the
+ * time runs out while they are computed; the parallel slices are not
+ * used. 0 means no deadline */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_deadline(LqrCarver *r, gulong deadline)
+{
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    if (deadline && (r->deadline_timer == NULL)) {
+        LQR_CATCH_MEM(r->deadline_timer = g_timer_new());
+    }
+    r->deadline = deadline;
+    return LQR_OK;
+}
+
+/* only check for cancellation every rows rows in the loops
+ * over the image (readout cache generation and parallel slices
+ * included, each slice checking the state of its carver); after
+ * lqr_carver_cancel() the carver may still process up to rows
+ * rows per thread (and finish the current seam) before giving
+ * up. Attached carvers check every row */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_cancel_interval(LqrCarver *r, gint rows)
+{
+    LQR_CATCH_F(rows > 0);
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    r->canc_rows = rows;
+    return LQR_OK;
+}
+
+/* carve the image in n_slices vertical slices at once,
+ * concurrently when OpenMP is available (see
+ * lqr_carver_build_vsmap_slices(): the result is approximate);
+ * the energy function must be reentrant. 0 or 1 turn it off */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_parallel_slices(LqrCarver *r, gint n_slices)
+{
+    LQR_CATCH_F(n_slices >= 0);
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    r->n_slices = n_slices;
+    return LQR_OK;
+}
+
 /* set enlargement step */
 /* LQR_PUBLIC */
 LqrRetVal
@@ -500,18 +841,77 @@ lqr_carver_set_enl_step(LqrCarver *r, gfloat enl_step)
     return LQR_OK;
 }
 
+/* set the interpolation used for inserted seams */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_insertion_kernel(LqrCarver *r, LqrInsKernel ins_kernel)
+{
+    LQR_CATCH_F((ins_kernel >= LQR_INS_KERNEL_AVERAGE) && (ins_kernel <= LQR_INS_KERNEL_ENERGY));
+    LQR_CATCH_CANC(r);
+    r->ins_kernel = ins_kernel;
+    return LQR_OK;
+}
+
 /* LQR_PUBLIC */
 void
 lqr_carver_set_use_cache(LqrCarver *r, gboolean use_cache)
 {
     if (!use_cache) {
-        g_free(r->rcache);
+        lqr_carver_scratch_free(r, r->rcache);
         r->rcache = NULL;
     }
     r->use_rcache = use_cache;
     r->rwindow->use_rcache = use_cache;
 }
 
+/* keep a copy of the energy and minpath maps of the base image (the one
+ * the multisize maps are built on) so that bias and rigidity mask edits
+ * can go back to it instead of flattening the current image; only the
+ * edited region and the part of the minpath map below it are then
+ * recomputed at the next resize. Edit coordinates refer to the base
+ * image, and the carver is brought back to the base size by the edit
+ * (as with flattening, a transposition makes the current image the new
+ * base) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_incremental_edits(LqrCarver *r, gboolean incremental_edits)
+{
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+
+    r->incremental_edits = incremental_edits;
+    if (!incremental_edits) {
+        lqr_carver_base_maps_free(r);
+    }
+
+    return LQR_OK;
+}
+
+/* round the energy to integer levels (at most 65536 of them, fewer
+ * for very tall images), so that the minpath values are exact integers:
+ * unless rigidity is used, they are then independent of the order in
+ * which they are summed up, and the updates of the minpath map stop
+ * as soon as there is no difference at all rather than none above a
+ * tolerance. The levels are set by the largest energy found when the
+ * energy map is built: higher energies computed afterwards, while
+ * carving, are clamped */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_energy_quantization(LqrCarver *r, gboolean quantize)
+{
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+
+    if (r->nrg_quant != quantize) {
+        r->nrg_quant = quantize;
+        r->nrg_quant_scale = 0;
+        r->nrg_uptodate = FALSE;
+        lqr_carver_base_maps_free(r);
+    }
+
+    return LQR_OK;
+}
+
 /* set progress reprot */
 /* LQR_PUBLIC */
 void
@@ -521,6 +921,70 @@ lqr_carver_set_progress(LqrCarver *r, LqrProgress * p)
     r->progress = p;
 }
 
+/* start a progress report session */
+void
+lqr_carver_progress_init(LqrCarver *r, const gchar *message)
+{
+    /* the first update is given right away */
+    r->session_update_countdown = 0;
+    r->session_last_update = 0;
+    r->session_seam_time = 0;
+
+    if (lqr_progress_needs_timer(r->progress)) {
+        if (r->session_timer == NULL) {
+            r->session_timer = g_timer_new();
+        }
+        r->session_last_time = g_timer_elapsed(r->session_timer, NULL);
+    }
+
+    lqr_progress_init(r->progress, r, message);
+}
+
+/* report progress after done seams, and schedule the next
+ * report: the countdown is either the update step, or, with
+ * the time-based throttle, the number of seams which are
+ * expected to fit into the update interval (this way no
+ * timing is needed between updates) */
+void
+lqr_carver_progress_update(LqrCarver *r, gint done)
+{
+    gdouble now, seam_time;
+    gdouble eta = -1;
+    gdouble interval = r->progress->update_interval;
+
+    if (r->session_timer != NULL) {
+        now = g_timer_elapsed(r->session_timer, NULL);
+        if (done > r->session_last_update) {
+            seam_time = (now - r->session_last_time) / (done - r->session_last_update);
+            /* smooth the estimate over the last updates */
+            if (r->session_seam_time > 0) {
+                r->session_seam_time = (r->session_seam_time + seam_time) / 2;
+            } else {
+                r->session_seam_time = seam_time;
+            }
+        }
+        r->session_last_time = now;
+        r->session_last_update = done;
+        if (r->session_seam_time > 0) {
+            eta = (r->session_rescale_total - done) * r->session_seam_time;
+        }
+    }
+
+    lqr_progress_update(r->progress, r, (gdouble) done / (gdouble) (r->session_rescale_total), eta);
+
+    if (interval > 0) {
+        if (r->session_seam_time > 0) {
+            r->session_update_countdown = (gint) MIN(interval / r->session_seam_time, r->session_rescale_total);
+            r->session_update_countdown = MAX(r->session_update_countdown, 1);
+        } else {
+            /* (no estimate yet) */
+            r->session_update_countdown = 1;
+        }
+    } else {
+        r->session_update_countdown = r->session_update_step;
+    }
+}
+
 /* flag the input buffer to avoid destruction */
 /* LQR_PUBLIC */
 void
@@ -536,6 +1000,8 @@ lqr_carver_set_preserve_input_image(LqrCarver *r)
 LqrRetVal
 lqr_carver_build_maps(LqrCarver *r, gint depth)
 {
+    gdouble t0;
+
 #ifdef __LQR_DEBUG__
     assert(depth <= r->w_start);
     assert(depth >= 1);
@@ -551,11 +1017,45 @@ lqr_carver_build_maps(LqrCarver *r, gint depth)
         /* set to minimum width reached so far */
         lqr_carver_set_width(r, r->w_start - r->max_level + 1);
 
-        /* compute energy & minpath maps */
-        LQR_CATCH(lqr_carver_build_emap(r));
-        LQR_CATCH(lqr_carver_build_mmap(r));
+        /* compute energy & minpath maps (after an incremental edit
+         * only the dirty region of the base maps is recomputed;
+         * with a deadline, they are skipped if they cannot be done
+         * before the carving has to stop, and abandoned if it has
+         * to stop while they are built: no seams are carved then) */
+        lqr_carver_scratch_advise(r, TRUE);
+        if (r->deadline && !r->deadline_hit &&
+            !lqr_carver_deadline_fits(r, LQR_DEADLINE_MAPS, (gdouble) r->w * r->h)) {
+            r->deadline_hit = TRUE;
+        }
+        if (!r->deadline_hit) {
+            t0 = lqr_carver_deadline_start(r);
+            if (r->nrg_uptodate && r->mmap_uptodate) {
+                LQR_CATCH(lqr_carver_update_dirty(r));
+            } else {
+                r->deadline_watch = (r->deadline != 0);
+                LQR_CATCH(lqr_carver_build_emap(r));
+                if (!r->deadline_hit) {
+                    LQR_CATCH(lqr_carver_build_mmap(r));
+                }
+                r->deadline_watch = FALSE;
+            }
+            if (!r->deadline_hit) {
+                lqr_carver_deadline_stop(r, LQR_DEADLINE_MAPS, t0, (gdouble) r->w * r->h);
+                if (r->incremental_edits && r->max_level == 1) {
+                    LQR_CATCH(lqr_carver_base_maps_save(r));
+                }
+            }
+        }
+        if (r->deadline_hit) {
+            r->nrg_uptodate = FALSE;
+            lqr_carver_base_maps_free(r);
+        }
+        r->mmap_uptodate = FALSE;
+        lqr_carver_edit_clear(r);
 
-        /* compute visibility map */
+        /* compute visibility map
+         * (seam updates only touch the maps around the seams) */
+        lqr_carver_scratch_advise(r, FALSE);
         LQR_CATCH(lqr_carver_build_vsmap(r, depth));
     }
     return LQR_OK;
@@ -565,7 +1065,10 @@ lqr_carver_build_maps(LqrCarver *r, gint depth)
 LqrRetVal
 lqr_carver_build_emap(LqrCarver *r)
 {
-    gint x, y;
+    gdouble t0;
+    gint stop = 0;
+    gint deadline_reached = 0;
+    LqrRetVal ret_val = LQR_OK;
 
     LQR_CATCH_CANC(r);
 
@@ -573,97 +1076,382 @@ lqr_carver_build_emap(LqrCarver *r)
         return LQR_OK;
     }
 
-    if (r->use_rcache && r->rcache == NULL) {
-        LQR_CATCH_MEM(r->rcache = lqr_carver_generate_rcache(r));
-    }
+    /* the readout cache is a phase of its own,
+     * hence it is built before the timing starts */
+    LQR_CATCH(lqr_carver_build_rcache(r));
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "build_emap", -1);
+
+    /* the quantization levels are chosen once the
+     * whole map is known */
+    r->nrg_quant_scale = 0;
+
+    /* rows are independent (see LQR_EMAP_PARALLEL); each thread but
+     * the first has its own reading window, and the first error,
+     * cancellation or deadline stops all the threads at their next row */
+#ifdef _OPENMP
+#pragma omp parallel num_threads(lqr_carver_n_threads(r)) if (LQR_EMAP_PARALLEL(r))
+#endif /* _OPENMP */
+    {
+        LqrReadingWindow *rwindow = r->rwindow;
+        LqrRetVal row_ret_val = LQR_OK;
+        gint x, y;
+
+#ifdef _OPENMP
+        if (omp_get_thread_num() > 0 && (rwindow = lqr_carver_rwindow_new(r)) == NULL) {
+            row_ret_val = LQR_NOMEM;
+            g_atomic_int_set(&stop, 1);
+        }
+#pragma omp for schedule(static)
+#endif /* _OPENMP */
+        for (y = 0; y < r->h; y++) {
+            if (g_atomic_int_get(&stop) || LQR_CANC_ROW(r, y)) {
+                g_atomic_int_set(&stop, 1);
+                continue;
+            }
+            if (LQR_DEADLINE_ROW(r, y)) {
+                g_atomic_int_set(&deadline_reached, 1);
+                g_atomic_int_set(&stop, 1);
+                continue;
+            }
+            /* r->nrg_xmin[y] = 0; */
+            /* r->nrg_xmax[y] = r->w - 1; */
+            for (x = 0; x < r->w && row_ret_val == LQR_OK; x++) {
+                row_ret_val = lqr_carver_compute_e_window(r, rwindow, x, y);
+            }
+            if (row_ret_val != LQR_OK) {
+                g_atomic_int_set(&stop, 1);
+            }
+        }
 
-    for (y = 0; y < r->h; y++) {
-        LQR_CATCH_CANC(r);
-        /* r->nrg_xmin[y] = 0; */
-        /* r->nrg_xmax[y] = r->w - 1; */
-        for (x = 0; x < r->w; x++) {
-            LQR_CATCH(lqr_carver_compute_e(r, x, y));
+        if (rwindow != r->rwindow) {
+            lqr_rwindow_destroy(rwindow);
         }
+        if (row_ret_val != LQR_OK) {
+#ifdef _OPENMP
+#pragma omp critical (lqr_build_emap)
+#endif /* _OPENMP */
+            ret_val = row_ret_val;
+        }
+    }
+
+    if (ret_val != LQR_OK) {
+        lqr_carver_trace_unwind(r);
+        return ret_val;
+    }
+    LQR_TRACE_CATCH_CANC(r);
+    if (deadline_reached) {
+        r->deadline_hit = TRUE;
+        lqr_carver_trace_end(r, "build_emap", -1);
+        return LQR_OK;
+    }
+
+    if (r->nrg_quant) {
+        lqr_carver_quantize_emap(r);
     }
 
     r->nrg_uptodate = TRUE;
 
+    lqr_carver_trace_end(r, "build_emap", -1);
+    lqr_carver_stats_stop(r, &r->stats.build_emap, t0, (guint64) r->w * r->h);
+
+    return LQR_OK;
+}
+
+/* generate the reading cache, if needed */
+LqrRetVal
+lqr_carver_build_rcache(LqrCarver *r)
+{
+    gdouble t0;
+
+    if (r->use_rcache && r->rcache == NULL && !LQR_NRG_IS_STATIC(r)) {
+        t0 = lqr_carver_stats_start(r);
+        lqr_carver_trace_begin(r, "rcache", -1);
+        if ((r->rcache = lqr_carver_generate_rcache(r)) == NULL) {
+            LQR_TRACE_CATCH_CANC(r);
+            lqr_carver_trace_unwind(r);
+            return LQR_NOMEM;
+        }
+        lqr_carver_trace_end(r, "rcache", -1);
+        lqr_carver_stats_stop(r, &r->stats.rcache, t0, (guint64) r->w * r->h);
+    }
+
     return LQR_OK;
 }
 
 LqrRetVal
 lqr_carver_compute_e(LqrCarver *r, gint x, gint y)
+{
+    return lqr_carver_compute_e_window(r, r->rwindow, x, y);
+}
+
+/* same as lqr_carver_compute_e, reading the image through the
+ * given window (one per thread when rows are computed concurrently) */
+LqrRetVal
+lqr_carver_compute_e_window(LqrCarver *r, LqrReadingWindow *rwindow, gint x, gint y)
 {
     gint data;
     gfloat b_add = 0;
+    gfloat nrg;
 
     /* removed CANC check for performance reasons */
     /* LQR_CATCH_CANC (r); */
 
     data = r->raw[y][x];
 
-    LQR_CATCH(lqr_rwindow_fill(r->rwindow, r, x, y));
     if (r->bias != NULL) {
         b_add = r->bias[data] / r->w_start;
     }
-    r->en[data] = r->nrg(x, y, r->w, r->h, r->rwindow, r->nrg_extra_data) + b_add;
+    if (r->nrg_buffer != NULL) {
+        nrg = r->nrg_buffer[data];
+        if (r->nrg_func_weight != 0) {
+            LQR_CATCH(lqr_rwindow_fill(rwindow, r, x, y));
+            nrg += r->nrg_func_weight * r->nrg(x, y, r->w, r->h, rwindow, r->nrg_extra_data);
+        }
+    } else {
+        LQR_CATCH(lqr_rwindow_fill(rwindow, r, x, y));
+        nrg = r->nrg(x, y, r->w, r->h, rwindow, r->nrg_extra_data);
+    }
+    nrg += b_add;
+    if (r->nrg_quant_scale > 0) {
+        nrg = lqr_carver_quantize_e(r, nrg);
+    }
+    r->en[data] = nrg;
 
     return LQR_OK;
 }
 
-/* compute auxiliary minpath map
- * defined as
- *   y = 1 : m(x,y) = e(x,y)
- *   y > 1 : m(x,y) = min_{x'=-dx,..,dx} ( m(x-x',y-1) + rig(x') ) + e(x,y)
- * where
- *   e(x,y)  is the energy at point (x,y)
- *   dx      is the max seam step delta_x
- *   rig(x') is the rigidity for step x'
- */
-LqrRetVal
-lqr_carver_build_mmap(LqrCarver *r)
+/* create a reading window suited to the energy function of the carver */
+LqrReadingWindow *
+lqr_carver_rwindow_new(LqrCarver *r)
+{
+    if (r->nrg_read_t == LQR_ER_CUSTOM) {
+        return lqr_rwindow_new_custom(r->nrg_radius, r->use_rcache, r->channels);
+    }
+    return lqr_rwindow_new(r->nrg_radius, r->nrg_read_t, r->use_rcache);
+}
+
+/* choose the quantization levels from the largest (finite) energy
+ * in the map and quantize it; the levels are bound by the map height
+ * so that the sum of one energy per row stays below LQR_QUANT_M_MAX */
+void
+lqr_carver_quantize_emap(LqrCarver *r)
 {
     gint x, y;
     gint data;
-    gint data_down;
-    gint x1_min, x1_max, x1;
-    gfloat m, m1, r_fact;
-
-    LQR_CATCH_CANC(r);
+    gfloat nrg, nrg_max = 0;
 
-    /* span first row */
-    for (x = 0; x < r->w; x++) {
-        data = r->raw[0][x];
-#ifdef __LQR_DEBUG__
-        assert(r->vs[data] == 0);
-#endif /* __LQR_DEBUG__ */
-        r->m[data] = r->en[data];
+    for (y = 0; y < r->h; y++) {
+        for (x = 0; x < r->w; x++) {
+            nrg = fabsf(r->en[r->raw[y][x]]);
+            if (!isinf(nrg)) {
+                nrg_max = MAX(nrg_max, nrg);
+            }
+        }
+    }
+    if (nrg_max == 0) {
+        nrg_max = 1;
     }
 
-    /* span all other rows */
-    for (y = 1; y < r->h; y++) {
-        for (x = 0; x < r->w; x++) {
-            LQR_CATCH_CANC(r);
+    r->nrg_quant_max = (gfloat) MIN(LQR_QUANT_LEVELS, LQR_QUANT_M_MAX / r->h);
+    r->nrg_quant_scale = r->nrg_quant_max / nrg_max;
 
+    for (y = 0; y < r->h; y++) {
+        for (x = 0; x < r->w; x++) {
             data = r->raw[y][x];
-#ifdef __LQR_DEBUG__
-            assert(r->vs[data] == 0);
-#endif /* __LQR_DEBUG__ */
-            /* watch for boundaries */
-            x1_min = MAX(-x, -r->delta_x);
-            x1_max = MIN(r->w - 1 - x, r->delta_x);
-            if (r->rigidity_mask) {
-                r_fact = r->rigidity_mask[data];
-            } else {
-                r_fact = 1;
-            }
+            r->en[data] = lqr_carver_quantize_e(r, r->en[data]);
+        }
+    }
+}
 
-            /* we use the data_down pointer to be able to
-             * track the seams later (needed for rigidity) */
-            data_down = r->raw[y - 1][x + x1_min];
-            r->least[data] = data_down;
-            if (r->rigidity) {
-                m = r->m[data_down] + r_fact * r->rigidity_map[x1_min];
+/* round an energy value to the current quantization levels
+ * (infinite energies, which exclude points from the seams,
+ * e.g. in the strip carver, are kept) */
+gfloat
+lqr_carver_quantize_e(LqrCarver *r, gfloat nrg)
+{
+    if (isinf(nrg)) {
+        return nrg;
+    }
+    nrg = rintf(nrg * r->nrg_quant_scale);
+    return CLAMP(nrg, -r->nrg_quant_max, r->nrg_quant_max);
+}
+
+/* find the point at the other end of the run of minima among the
+ * neighbours x1_min..x1_max in the previous row, i.e. the one which
+ * would be chosen with the other side switch setting (least is the
+ * one chosen with the current setting, m the minimum value) */
+gint
+lqr_carver_least_alt(LqrCarver *r, gint y, gint x, gint x1_min, gint x1_max, gint least, gfloat m, gfloat r_fact)
+{
+    gint x1;
+    gfloat m1;
+
+    if (r->leftright) {
+        for (x1 = x1_min; x1 < least; x1++) {
+            m1 = r->m[r->raw[y - 1][x1]] + (r->rigidity ? r_fact * r->rigidity_map[x1 - x] : 0);
+            if (m1 == m) {
+                return x1;
+            }
+        }
+    } else {
+        for (x1 = x1_max; x1 > least; x1--) {
+            m1 = r->m[r->raw[y - 1][x1]] + (r->rigidity ? r_fact * r->rigidity_map[x1 - x] : 0);
+            if (m1 == m) {
+                return x1;
+            }
+        }
+    }
+    return least;
+}
+
+/* prepare the sliding window minimum, if delta_x is large enough
+ * for it to pay off and there is no rigidity (which makes the cost
+ * of each neighbour depend on its distance from the point, so that
+ * the window minimum is no longer shared): *mw_p is set to mw in
+ * that case, to NULL otherwise */
+LqrRetVal
+lqr_carver_min_window_init(LqrCarver *r, LqrMinWindow **mw_p, LqrMinWindow *mw)
+{
+    *mw_p = NULL;
+    if ((r->delta_x < LQR_MIN_WINDOW_MIN_DELTA_X) || r->rigidity) {
+        return LQR_OK;
+    }
+    if (r->min_queue_size < r->w) {
+        g_free(r->min_queue);
+        r->min_queue_size = 0;
+        LQR_CATCH_MEM(r->min_queue = g_try_new(gint, r->w));
+        r->min_queue_size = r->w;
+    }
+    mw->queue = r->min_queue;
+    lqr_carver_min_window_reset(mw, 0);
+    *mw_p = mw;
+
+    return LQR_OK;
+}
+
+/* start a new row, with x as the first position to enter the window */
+void
+lqr_carver_min_window_reset(LqrMinWindow *mw, gint x)
+{
+    mw->head = 0;
+    mw->tail = 0;
+    mw->next = x;
+}
+
+/* move the window to x1_min..x1_max in the row before y (both ends
+ * can only move forward within a row) and return the position of the
+ * minimum, the leftmost or the rightmost one according to leftright:
+ * each position enters and leaves the queue once, so that the cost
+ * per point doesn't depend on delta_x */
+gint
+lqr_carver_min_window(LqrCarver *r, LqrMinWindow *mw, gint y, gint x1_min, gint x1_max)
+{
+    gint *row = r->raw[y - 1];
+    gfloat m1;
+
+    while (mw->next <= x1_max) {
+        m1 = r->m[row[mw->next]];
+        if (r->leftright) {
+            while ((mw->tail > mw->head) && (r->m[row[mw->queue[mw->tail - 1]]] >= m1)) {
+                mw->tail--;
+            }
+        } else {
+            while ((mw->tail > mw->head) && (r->m[row[mw->queue[mw->tail - 1]]] > m1)) {
+                mw->tail--;
+            }
+        }
+        mw->queue[mw->tail++] = mw->next++;
+    }
+    while (mw->queue[mw->head] < x1_min) {
+        mw->head++;
+    }
+
+    return mw->queue[mw->head];
+}
+
+/* compute auxiliary minpath map
+ * defined as
+ *   y = 1 : m(x,y) = e(x,y)
+ *   y > 1 : m(x,y) = min_{x'=-dx,..,dx} ( m(x-x',y-1) + rig(x') ) + e(x,y)
+ * where
+ *   e(x,y)  is the energy at point (x,y)
+ *   dx      is the max seam step delta_x
+ *   rig(x') is the rigidity for step x'
+ *
+ * the minimum value doesn't depend on how ties are broken, only the
+ * offsets do: when the side switch is on, the offsets for the other
+ * side are kept in least_alt, so that switching sides is just a
+ * matter of swapping the two maps
+ */
+LqrRetVal
+lqr_carver_build_mmap(LqrCarver *r)
+{
+    gint x, y;
+    gint data;
+    gint data_down;
+    gint x1_min, x1_max, x1;
+    gint least, least_alt;
+    gfloat m, m1, r_fact;
+    LqrMinWindow mw_storage;
+    LqrMinWindow *mw;
+    gdouble t0;
+
+    LQR_CATCH_CANC(r);
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "build_mmap", -1);
+
+    if (r->lr_switch_frequency && (r->least_alt == NULL)) {
+        LQR_TRACE_CATCH_MEM(r, r->least_alt = LEAST_TRY_NEW(r, (gsize) r->w0 * r->h0));
+    }
+    LQR_TRACE_CATCH(r, lqr_carver_min_window_init(r, &mw, &mw_storage));
+
+    /* span first row */
+    for (x = 0; x < r->w; x++) {
+        data = r->raw[0][x];
+#ifdef __LQR_DEBUG__
+        assert(VS_GET(r, data) == 0);
+#endif /* __LQR_DEBUG__ */
+        r->m[data] = r->en[data];
+    }
+
+    /* span all other rows */
+    for (y = 1; y < r->h; y++) {
+        LQR_TRACE_CATCH_CANC_ROW(r, y);
+        if (LQR_DEADLINE_ROW(r, y)) {
+            r->deadline_hit = TRUE;
+            lqr_carver_trace_end(r, "build_mmap", -1);
+            return LQR_OK;
+        }
+        if (mw) {
+            lqr_carver_min_window_reset(mw, 0);
+        }
+        for (x = 0; x < r->w; x++) {
+            data = r->raw[y][x];
+#ifdef __LQR_DEBUG__
+            assert(VS_GET(r, data) == 0);
+#endif /* __LQR_DEBUG__ */
+            /* watch for boundaries */
+            x1_min = MAX(-x, -r->delta_x);
+            x1_max = MIN(r->w - 1 - x, r->delta_x);
+            if (r->rigidity_mask) {
+                r_fact = r->rigidity_mask[data];
+            } else {
+                r_fact = 1;
+            }
+
+            /* we use the data_down pointer to be able to
+             * track the seams later (needed for rigidity) */
+            data_down = r->raw[y - 1][x + x1_min];
+            least = x1_min;
+            if (mw) {
+                x1 = lqr_carver_min_window(r, mw, y, x + x1_min, x + x1_max);
+                m = r->m[r->raw[y - 1][x1]];
+                least = x1 - x;
+            } else if (r->rigidity) {
+                m = r->m[data_down] + r_fact * r->rigidity_map[x1_min];
                 for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
                     data_down = r->raw[y - 1][x + x1];
                     /* find the min among the neighbors
@@ -671,7 +1459,7 @@ lqr_carver_build_mmap(LqrCarver *r)
                     m1 = r->m[data_down] + r_fact * r->rigidity_map[x1];
                     if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
                         m = m1;
-                        r->least[data] = data_down;
+                        least = x1;
                     }
                     /* m = MIN(m, r->m[data_down] + r->rigidity_map[x1]); */
                 }
@@ -684,26 +1472,48 @@ lqr_carver_build_mmap(LqrCarver *r)
                     m1 = r->m[data_down];
                     if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
                         m = m1;
-                        r->least[data] = data_down;
+                        least = x1;
                     }
                     m = MIN(m, r->m[data_down]);
                 }
             }
+            LEAST_SET(r, data, least);
+            if (r->least_alt) {
+                least_alt = lqr_carver_least_alt(r, y, x, x + x1_min, x + x1_max, x + least, m, r_fact) - x;
+                LEAST_ALT_SET(r, data, least_alt);
+            }
 
             /* set current m */
             r->m[data] = r->en[data] + m;
         }
     }
+
+    lqr_carver_trace_end(r, "build_mmap", -1);
+    lqr_carver_stats_stop(r, &r->stats.build_mmap, t0, (guint64) r->w * r->h);
+
     return LQR_OK;
 }
 
+/* exchange the offsets of the two sides */
+void
+lqr_carver_swap_least(LqrCarver *r)
+{
+    void *least;
+
+    least = r->least;
+    r->least = r->least_alt;
+    r->least_alt = least;
+}
+
 /* compute (vertical) visibility map up to given depth
  * (it also calls inflate() to add image enlargment information) */
 LqrRetVal
 lqr_carver_build_vsmap(LqrCarver *r, gint depth)
 {
-    gint l;
+    gint l, l_first;
     gint lr_switch_interval = 0;
+    gboolean lr_switch;
+    gdouble t_first, t0, points;
     LqrDataTok data_tok;
 
 #ifdef __LQR_VERBOSE__
@@ -722,6 +1532,8 @@ lqr_carver_build_vsmap(LqrCarver *r, gint depth)
         depth = r->w_start + 1;
     }
 
+    lqr_carver_trace_begin(r, "build_vsmap", depth);
+
     /* here we assume that
      * lqr_carver_set_width(w_start - max_level + 1);
      * has been given */
@@ -731,13 +1543,35 @@ lqr_carver_build_vsmap(LqrCarver *r, gint depth)
         lr_switch_interval = (depth - r->max_level - 1) / r->lr_switch_frequency + 1;
     }
 
-    /* cycle over levels */
-    for (l = r->max_level; l < depth; l++) {
-        LQR_CATCH_CANC(r);
+    /* cycle over levels
+     * (the first ones may be done in parallel slices, but not
+     * with a deadline, which needs to stop between any two seams) */
+    l = r->max_level;
+    if ((r->n_slices > 1) && !r->deadline) {
+        LQR_TRACE_CATCH(r, lqr_carver_build_vsmap_slices(r, &l, depth));
+    }
+    l_first = l;
+    t_first = lqr_carver_deadline_start(r);
+    for (; l < depth; l++) {
+        LQR_TRACE_CATCH_CANC(r);
+
+        /* when the carving has to stop, the remaining
+         * levels are filled in by uniform scaling */
+        if (r->deadline && (r->deadline_hit || lqr_carver_deadline_near(r, l - l_first, t_first))) {
+            lqr_carver_deadline_stop(r, LQR_DEADLINE_SEAM, t_first, (gdouble) (l - l_first) * r->h);
+            r->deadline_hit = TRUE;
+            points = (gdouble) r->w * r->h;
+            t0 = lqr_carver_deadline_start(r);
+            LQR_TRACE_CATCH(r, lqr_carver_build_vsmap_uniform(r, l, depth));
+            lqr_carver_deadline_stop(r, LQR_DEADLINE_UNIFORM, t0, points);
+            r->res_strategy = LQR_RES_STRATEGY_UNIFORM;
+            break;
+        }
+
+        lqr_carver_trace_begin(r, "seam", l);
 
-        if ((l - r->max_level + r->session_rescale_current) % r->session_update_step == 0) {
-            lqr_progress_update(r->progress, (gdouble) (l - r->max_level + r->session_rescale_current) /
-                                (gdouble) (r->session_rescale_total));
+        if (--r->session_update_countdown <= 0) {
+            lqr_carver_progress_update(r, l - r->max_level + r->session_rescale_current);
         }
 #ifdef __LQR_DEBUG__
         /* check raw rows */
@@ -756,36 +1590,62 @@ lqr_carver_build_vsmap(LqrCarver *r, gint depth)
         r->level++;
         r->w--;
 
-        /* update raw data */
-        lqr_carver_carve(r);
-
         if (r->w > 1) {
-            /* update the energy */
-            /* LQR_CATCH (lqr_carver_build_emap (r));  */
-            LQR_CATCH(lqr_carver_update_emap(r));
-
-            /* recalculate the minpath map */
-            if ((r->lr_switch_frequency) && (((l - r->max_level + lr_switch_interval / 2) % lr_switch_interval) == 0)) {
+            lr_switch = (r->lr_switch_frequency) &&
+                (((l - r->max_level + lr_switch_interval / 2) % lr_switch_interval) == 0);
+            if (lr_switch) {
                 r->leftright ^= 1;
-                LQR_CATCH(lqr_carver_build_mmap(r));
+            }
+            if (lr_switch && (r->least_alt == NULL)) {
+                /* update raw data and energy, then
+                 * recalculate the minpath map */
+                lqr_carver_carve(r);
+                LQR_TRACE_CATCH(r, lqr_carver_update_emap(r));
+                LQR_TRACE_CATCH(r, lqr_carver_build_mmap(r));
             } else {
-                /* lqr_carver_build_mmap (r); */
-                LQR_CATCH(lqr_carver_update_mmap(r));
+                if (lr_switch) {
+                    /* the offsets for the other side are at hand */
+                    lqr_carver_swap_least(r);
+                }
+                /* update raw data, energy and minpath map */
+                LQR_TRACE_CATCH(r, lqr_carver_update_seam(r));
             }
         } else {
+            /* update raw data */
+            lqr_carver_carve(r);
             /* complete the map (last seam) */
             lqr_carver_finish_vsmap(r);
         }
+
+        lqr_carver_trace_end(r, "seam", l);
+    }
+    if (l == depth) {
+        lqr_carver_deadline_stop(r, LQR_DEADLINE_SEAM, t_first, (gdouble) (l - l_first) * r->h);
     }
 
-    /* insert seams for image enlargement */
-    LQR_CATCH(lqr_carver_inflate(r, depth - 1));
+    /* insert seams for image enlargement (with a deadline, a reduction
+     * is flattened at its new size instead, which takes a single pass
+     * over the smaller image, see lqr_carver_resize_width()) */
+    if (!r->deadline || !r->deadline_flatten) {
+        t0 = lqr_carver_deadline_start(r);
+        LQR_TRACE_CATCH(r, lqr_carver_inflate(r, depth - 1));
+        lqr_carver_deadline_stop(r, LQR_DEADLINE_INFLATE, t0, (gdouble) r->w0 * r->h0);
+    } else {
+        /* the levels are complete down to the new size
+         * (until the flattening resets them) */
+        r->max_level = depth;
+        data_tok.integer = depth;
+        LQR_TRACE_CATCH(r, lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_set_max_level_attached,
+                                                              data_tok));
+    }
 
     /* reset image size */
     lqr_carver_set_width(r, r->w_start);
     /* repeat for auxiliary layers */
     data_tok.integer = r->w_start;
-    LQR_CATCH(lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_set_width_attached, data_tok));
+    LQR_TRACE_CATCH(r, lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_set_width_attached, data_tok));
+
+    lqr_carver_trace_end(r, "build_vsmap", depth);
 
 #ifdef __LQR_VERBOSE__
     printf("[ visibility map OK ]\n");
@@ -795,464 +1655,1919 @@ lqr_carver_build_vsmap(LqrCarver *r, gint depth)
     return LQR_OK;
 }
 
-/* enlarge the image by seam insertion
- * visibility map is updated and the resulting multisize image
- * is complete in both directions */
+/* carve the first seams of build_vsmap() separately in vertical slices
+ * of the image, concurrently when OpenMP is available. This is an
+ * approximation: seams cannot cross the slice borders, and while the
+ * slices are carved, the energy at their borders is computed as if they
+ * were at the border of the image (only the initial energy map sees
+ * the whole image). Each slice takes a share of the seams proportional
+ * to its width, and the seams of different slices are interleaved in the
+ * visibility levels, so that any intermediate width is evenly spread
+ * over the slices and the visibility map is a standard one. The result
+ * doesn't depend on the number of threads. On return, *l_p is the
+ * first level left to the serial loop */
 LqrRetVal
-lqr_carver_inflate(LqrCarver *r, gint l)
+lqr_carver_build_vsmap_slices(LqrCarver *r, gint *l_p, gint depth)
 {
-    gint w1, z0, vs, k;
-    gint x, y;
-    gint c_left;
-    void *new_rgb = NULL;
-    gint *new_vs = NULL;
-    gdouble tmp_rgb;
-    gfloat *new_bias = NULL;
-    gfloat *new_rigmask = NULL;
-    LqrDataTok data_tok;
-    LqrCarverState prev_state = LQR_CARVER_STATE_STD;
-
-#ifdef __LQR_VERBOSE__
-    printf("  [ inflating (active=%i) ]\n", r->active);
-    fflush(stdout);
-#endif /* __LQR_VERBOSE__ */
-
-#ifdef __LQR_DEBUG__
-    assert(l + 1 > r->max_level);       /* otherwise is useless */
-#endif /* __LQR_DEBUG__ */
-
-    LQR_CATCH_CANC(r);
-
-    if (r->root == NULL) {
-        prev_state = g_atomic_int_get(&r->state);
-        LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_INFLATING, TRUE));
+    LqrCarver *slices;
+    LqrRetVal *ret_vals;
+    LqrRetVal ret_val = LQR_OK;
+    gint *x0, *n_seams, *first, *done, *levels;
+    gint n_slices, n, total;
+    gint s, t, g, y, x, width;
+    gint l0 = *l_p;
+    volatile gint seams_done = 0;
+
+    n_slices = MIN(r->n_slices, r->w / LQR_SLICE_MIN_WIDTH);
+    if ((n_slices < 2) || (depth - l0 < n_slices)) {
+        return LQR_OK;
     }
 
-    /* first iterate on attached carvers */
-    data_tok.integer = l;
-    LQR_CATCH(lqr_carver_list_foreach(r->attached_list, lqr_carver_inflate_attached, data_tok));
-
-    /* scale to current maximum size
-     * (this is the original size the first time) */
-    lqr_carver_set_width(r, r->w0);
-
-    /* final width */
-    w1 = r->w0 + l - r->max_level + 1;
-
-    /* allocate room for new maps */
-    BUF_TRY_NEW0_RET_LQR(new_rgb, w1 * r->h0 * r->channels, r->col_depth);
+    LQR_CATCH_MEM(x0 = g_try_new0(gint, 4 * n_slices + 1));
+    n_seams = x0 + n_slices + 1;
+    first = n_seams + n_slices;
+    done = first + n_slices;
 
-    if (r->root == NULL) {
-        LQR_CATCH_MEM(new_vs = g_try_new0(gint, w1 * r->h0));
+    /* split the columns and the seams */
+    n = depth - l0;
+    total = 0;
+    for (s = 0; s <= n_slices; s++) {
+        x0[s] = (gint) ((gint64) s * r->w / n_slices);
     }
-    if (r->active) {
-        if (r->bias) {
-            LQR_CATCH_MEM(new_bias = g_try_new0(gfloat, w1 * r->h0));
-        }
-        if (r->rigidity_mask) {
-            LQR_CATCH_MEM(new_rigmask = g_try_new(gfloat, w1 * r->h0));
-        }
+    for (s = 0; s < n_slices; s++) {
+        n_seams[s] = (gint) ((gint64) n * x0[s + 1] / r->w - (gint64) n * x0[s] / r->w);
+        n_seams[s] = MIN(n_seams[s], x0[s + 1] - x0[s] - LQR_SLICE_MIN_KEEP);
+        first[s] = total;
+        total += n_seams[s];
     }
 
-    /* span the image with a cursor
-     * and build the new image */
-    lqr_cursor_reset(r->c);
-    x = 0;
-    y = 0;
-    for (z0 = 0; z0 < w1 * r->h0; z0++, lqr_cursor_next(r->c)) {
-
-        LQR_CATCH_CANC(r);
-
-        /* read visibility */
-        vs = r->vs[r->c->now];
-        if ((vs != 0) && (vs <= l + r->max_level - 1)
-            && (vs >= 2 * r->max_level - 1)) {
-            /* the point belongs to a previously computed seam
-             * and was not inserted during a previous
-             * inflate() call : insert another seam */
-
-            /* the new pixel value is equal to the average of its
-             * left and right neighbors */
-
-            if (r->c->x > 0) {
-                c_left = lqr_cursor_left(r->c);
-            } else {
-                c_left = r->c->now;
-            }
+    levels = g_try_new(gint, total);
+    slices = g_try_new0(LqrCarver, n_slices);
+    ret_vals = g_try_new(LqrRetVal, n_slices);
+    if ((levels == NULL) || (slices == NULL) || (ret_vals == NULL)) {
+        g_free(levels);
+        g_free(slices);
+        g_free(ret_vals);
+        g_free(x0);
+        return LQR_NOMEM;
+    }
 
-            for (k = 0; k < r->channels; k++) {
-                switch (r->col_depth) {
-                    case LQR_COLDEPTH_8I:
-                        tmp_rgb = (AS_8I(r->rgb)[c_left * r->channels + k] +
-                                   AS_8I(r->rgb)[r->c->now * r->channels + k]) / 2;
-                        AS_8I(new_rgb)[z0 * r->channels + k] = (lqr_t_8i) (tmp_rgb + 0.499999);
-                        break;
-                    case LQR_COLDEPTH_16I:
-                        tmp_rgb = (AS_16I(r->rgb)[c_left * r->channels + k] +
-                                   AS_16I(r->rgb)[r->c->now * r->channels + k]) / 2;
-                        AS_16I(new_rgb)[z0 * r->channels + k] = (lqr_t_16i) (tmp_rgb + 0.499999);
-                        break;
-                    case LQR_COLDEPTH_32F:
-                        tmp_rgb = (AS_32F(r->rgb)[c_left * r->channels + k] +
-                                   AS_32F(r->rgb)[r->c->now * r->channels + k]) / 2;
-                        AS_32F(new_rgb)[z0 * r->channels + k] = (lqr_t_32f) tmp_rgb;
-                        break;
-                    case LQR_COLDEPTH_64F:
-                        tmp_rgb = (AS_64F(r->rgb)[c_left * r->channels + k] +
-                                   AS_64F(r->rgb)[r->c->now * r->channels + k]) / 2;
-                        AS_64F(new_rgb)[z0 * r->channels + k] = (lqr_t_64f) tmp_rgb;
-                        break;
-                }
-            }
-            if (r->active) {
-                if (r->bias) {
-                    new_bias[z0] = (r->bias[c_left] + r->bias[r->c->now]) / 2;
-                }
-                if (r->rigidity_mask) {
-                    new_rigmask[z0] = (r->rigidity_mask[c_left] + r->rigidity_mask[r->c->now]) / 2;
-                }
+    /* assign the levels: at each step, the next seam is taken from
+     * the slice with the largest fraction of its seams still to go */
+    for (g = 0; g < total; g++) {
+        t = -1;
+        for (s = 0; s < n_slices; s++) {
+            if (done[s] == n_seams[s]) {
+                continue;
             }
-            /* the first time inflate() is called
-             * the new visibility should be -vs + 1 but we shift it
-             * so that the final minimum visibiliy will be 1 again
-             * and so that vs=0 still means "uninitialized".
-             * Subsequent inflations account for that */
-            if (r->root == NULL) {
-                new_vs[z0] = l - vs + r->max_level;
+            if ((t < 0) ||
+                ((gint64) (n_seams[s] - done[s]) * n_seams[t] > (gint64) (n_seams[t] - done[t]) * n_seams[s])) {
+                t = s;
             }
-            z0++;
-        }
-        for (k = 0; k < r->channels; k++) {
-            PXL_COPY(new_rgb, z0 * r->channels + k, r->rgb, r->c->now * r->channels + k, r->col_depth);
         }
-        if (r->active) {
-            if (r->bias) {
-                new_bias[z0] = r->bias[r->c->now];
-            }
-            if (r->rigidity_mask) {
-                new_rigmask[z0] = r->rigidity_mask[r->c->now];
-            }
+        levels[first[t] + done[t]++] = l0 + g + r->max_level - 1;
+    }
+
+    lqr_carver_trace_begin(r, "slices", n_slices);
+
+    for (s = 0; s < n_slices && ret_val == LQR_OK; s++) {
+        ret_val = lqr_carver_slice_init(r, slices + s, x0[s], x0[s + 1] - x0[s]);
+    }
+
+    if (ret_val == LQR_OK) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(lqr_carver_n_threads(r))
+#endif /* _OPENMP */
+        for (s = 0; s < n_slices; s++) {
+            ret_vals[s] = lqr_carver_carve_slice(slices + s, r, levels + first[s], n_seams[s], &seams_done,
+                                                 l0 - r->max_level + r->session_rescale_current);
         }
-        if (vs != 0) {
-            /* visibility has to be shifted up */
-            if (r->root == NULL) {
-                new_vs[z0] = vs + l - r->max_level + 1;
-            }
-        } else if (r->raw != NULL) {
-#ifdef __LQR_DEBUG__
-            assert(y < r->h_start);
-            assert(x < r->w_start - l);
-#endif /* __LQR_DEBUG__ */
-            r->raw[y][x] = z0;
-            x++;
-            if (x >= r->w_start - l) {
-                x = 0;
-                y++;
+        for (s = 0; s < n_slices; s++) {
+            if (ret_vals[s] != LQR_OK) {
+                ret_val = ret_vals[s];
+                break;
             }
         }
     }
 
-#ifdef __LQR_DEBUG__
-    if (r->raw != NULL) {
-        assert(x == 0);
-        if (w1 != 2 * r->w_start - 1) {
-            assert((y == r->h_start)
-                   || (printf("y=%i hst=%i w1=%i\n", y, r->h_start, w1)
-                       && fflush(stdout) && 0));
-        }
+    for (s = 0; s < n_slices; s++) {
+        lqr_carver_slice_clear(slices + s);
     }
-#endif /* __LQR_DEBUG__ */
 
-    /* substitute maps */
-    if (!r->preserve_in_buffer) {
-        g_free(r->rgb);
+    if (ret_val == LQR_OK) {
+        /* join the slices back */
+        for (y = 0; y < r->h_start; y++) {
+            x = 0;
+            for (s = 0; s < n_slices; s++) {
+                width = x0[s + 1] - x0[s] - n_seams[s];
+                memmove(r->raw[y] + x, r->raw[y] + x0[s], width * sizeof(gint));
+                x += width;
+            }
+        }
+        r->w -= total;
+        r->level += total;
+        r->nrg_uptodate = FALSE;
+        *l_p = l0 + total;
     }
-    /* g_free (r->vs); */
-    g_free(r->en);
-    g_free(r->m);
-    g_free(r->rcache);
-    g_free(r->least);
-    g_free(r->bias);
-    g_free(r->rigidity_mask);
 
-    r->bias = NULL;
-    r->rcache = NULL;
-    r->nrg_uptodate = FALSE;
+    lqr_carver_trace_end(r, "slices", n_slices);
 
-    r->rgb = new_rgb;
-    r->preserve_in_buffer = FALSE;
+    g_free(levels);
+    g_free(slices);
+    g_free(ret_vals);
+    g_free(x0);
 
-    if (r->root == NULL) {
-        g_free(r->vs);
-        r->vs = new_vs;
-        LQR_CATCH(lqr_carver_propagate_vsmap(r));
-    } else {
-        /* r->vs = NULL; */
+    if (ret_val != LQR_OK) {
+        return ret_val;
     }
-    if (r->nrg_active) {
-        LQR_CATCH_MEM(r->en = g_try_new0(gfloat, w1 * r->h0));
+
+    /* the maps are only valid within the slices */
+    if (*l_p < depth) {
+        LQR_CATCH(lqr_carver_build_emap(r));
+        LQR_CATCH(lqr_carver_build_mmap(r));
     }
-    if (r->active) {
-        r->bias = new_bias;
-        r->rigidity_mask = new_rigmask;
-        LQR_CATCH_MEM(r->m = g_try_new0(gfloat, w1 * r->h0));
-        LQR_CATCH_MEM(r->least = g_try_new0(gint, w1 * r->h0));
+
+    return LQR_OK;
+}
+
+/* number of threads for the parallel phases of the carver (the
+ * setting of the root carver applies to the attached ones too) */
+gint
+lqr_carver_n_threads(LqrCarver *r)
+{
+    LqrCarver *root = (r->root != NULL) ? r->root : r;
+
+#ifdef _OPENMP
+    if (root->n_threads == 0) {
+        return omp_get_max_threads();
     }
+#endif /* _OPENMP */
+    return MAX(root->n_threads, 1);
+}
 
-    /* set new widths & levels (w_start is kept for reference) */
-    r->level = l + 1;
-    r->max_level = l + 1;
-    r->w0 = w1;
-    r->w = r->w_start;
+/* set up v as a view of the columns x0..x0+width-1 of r: the maps are
+ * shared (each slice only touches its own points), while the rows and
+ * the buffers used to compute the seams are private; the side switch
+ * and the counters are turned off. The state is r's one (through
+ * state_p), so that the checks within the slice see a cancellation */
+LqrRetVal
+lqr_carver_slice_init(LqrCarver *r, LqrCarver *v, gint x0, gint width)
+{
+    gint y;
 
-    /* reset readout buffer */
-    g_free(r->rgb_ro_buffer);
-    BUF_TRY_NEW0_RET_LQR(r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
+    *v = *r;
+    v->w = width;
+    v->raw = NULL;
+    v->vpath = NULL;
+    v->vpath_x = NULL;
+    v->nrg_xmin = NULL;
+    v->nrg_xmax = NULL;
+    v->rwindow = NULL;
+    v->least_alt = NULL;
+    v->lr_switch_frequency = 0;
+    v->min_queue = NULL;
+    v->min_queue_size = 0;
+    v->collect_stats = FALSE;
+    v->trace_depth = 0;
+
+    LQR_CATCH_MEM(v->raw = g_try_new(gint *, r->h_start));
+    for (y = 0; y < r->h_start; y++) {
+        v->raw[y] = r->raw[y] + x0;
+    }
+    LQR_CATCH_MEM(v->vpath = g_try_new(gint, r->h));
+    LQR_CATCH_MEM(v->vpath_x = g_try_new(gint, r->h));
+    LQR_CATCH_MEM(v->nrg_xmin = g_try_new(gint, r->h));
+    LQR_CATCH_MEM(v->nrg_xmax = g_try_new(gint, r->h));
+    LQR_CATCH_MEM(v->rwindow = lqr_carver_rwindow_new(r));
 
-#ifdef __LQR_VERBOSE__
+    return LQR_OK;
+}
+
+/* free the private buffers of a slice */
+void
+lqr_carver_slice_clear(LqrCarver *v)
+{
+    g_free(v->raw);
+    g_free(v->vpath);
+    g_free(v->vpath_x);
+    g_free(v->nrg_xmin);
+    g_free(v->nrg_xmax);
+    g_free(v->min_queue);
+    lqr_rwindow_destroy(v->rwindow);
+    v->raw = NULL;
+    v->vpath = NULL;
+    v->vpath_x = NULL;
+    v->nrg_xmin = NULL;
+    v->nrg_xmax = NULL;
+    v->min_queue = NULL;
+    v->rwindow = NULL;
+}
+
+/* carve n seams from slice v of r, as in build_vsmap(),
+ * assigning them the given visibility levels. The seams carved by
+ * all the slices are counted in seams_done, and the progress of r is
+ * updated from the calling thread only (the OpenMP master), while
+ * its own slice lasts; progress_base is the progress before the
+ * slices */
+LqrRetVal
+lqr_carver_carve_slice(LqrCarver *v, LqrCarver *r, gint *levels, gint n, volatile gint *seams_done,
+                       gint progress_base)
+{
+    gint i;
+    gboolean master = TRUE;
+
+    if (n == 0) {
+        return LQR_OK;
+    }
+
+#ifdef _OPENMP
+    master = (omp_get_thread_num() == 0);
+#endif /* _OPENMP */
+
+    lqr_carver_trace_begin(v, "slice", n);
+
+    LQR_TRACE_CATCH(v, lqr_carver_build_mmap(v));
+
+    for (i = 0; i < n; i++) {
+        LQR_TRACE_CATCH_CANC(v);
+
+        if (master && (--r->session_update_countdown <= 0)) {
+            lqr_carver_progress_update(r, progress_base + g_atomic_int_get(seams_done));
+        }
+
+        lqr_carver_build_vpath(v);
+        lqr_carver_update_vsmap(v, levels[i]);
+        v->w--;
+        if (i < n - 1) {
+            LQR_TRACE_CATCH(v, lqr_carver_update_seam(v));
+        } else {
+            lqr_carver_carve(v);
+        }
+        g_atomic_int_inc(seams_done);
+    }
+
+    lqr_carver_trace_end(v, "slice", n);
+
+    return LQR_OK;
+}
+
+/* whether carving one more seam would go past the time by which the
+ * carving has to stop, given the time taken by the seams carved since
+ * t0 (before the first one, its estimated cost) */
+gboolean
+lqr_carver_deadline_near(LqrCarver *r, gint seams, gdouble t0)
+{
+    gdouble now = g_timer_elapsed(r->deadline_timer, NULL);
+    gdouble seam_time = seams > 0 ? (now - t0) / seams : r->deadline_cost[LQR_DEADLINE_SEAM] * r->h;
+
+    return now + seam_time >= r->deadline_stop;
+}
+
+/* whether a phase over the given number of points can be done before
+ * the carving has to stop, according to its estimated cost */
+gboolean
+lqr_carver_deadline_fits(LqrCarver *r, LqrDeadlinePhase phase, gdouble points)
+{
+    return g_timer_elapsed(r->deadline_timer, NULL) + r->deadline_cost[phase] * points < r->deadline_stop;
+}
+
+/* plan the time left before the deadline for a step of a resize (the maps
+ * built up to depth, towards the width w1): the carving has to stop early
+ * enough to leave time for the work done anyway afterwards, i.e. the
+ * uniform scaling, the enlargement (or the flattening of a reduction),
+ * the further steps in this direction and the transposition for the size
+ * change still to come in the other one, as estimated from the costs per
+ * point of the phases; the rest is shared between the two directions in
+ * proportion to their estimated carving work (maps and seams) */
+void
+lqr_carver_deadline_plan(LqrCarver *r, gint depth, gint w1)
+{
+    gdouble *cost = r->deadline_cost;
+    gdouble now, h, w_maps, next_points, spare;
+    gdouble fixed = 0;
+    gdouble work = 0;
+    gdouble work_next = 0;
+
+    now = g_timer_elapsed(r->deadline_timer, NULL);
+    h = r->h;
+
+    /* this step (nothing is built if the maps are deep enough already;
+     * a reduction is flattened rather than inflated, unless down to a
+     * single column, which could not be enlarged again by carving) */
+    r->deadline_flatten = (depth > r->max_level) && (w1 < r->w_start) && (w1 > 1);
+    if (depth > r->max_level) {
+        w_maps = r->w_start - r->max_level + 1;
+        fixed += cost[LQR_DEADLINE_UNIFORM] * w_maps * h;
+        if (r->deadline_flatten) {
+            fixed += cost[LQR_DEADLINE_FLATTEN] * w1 * h;
+        } else {
+            fixed += cost[LQR_DEADLINE_INFLATE] * (r->w0 + depth - r->max_level) * r->h0;
+        }
+        work += cost[LQR_DEADLINE_MAPS] * w_maps * h;
+        work += cost[LQR_DEADLINE_SEAM] * (depth - r->max_level) * h;
+    }
+
+    /* further steps (only for large enlargements) are accounted
+     * for as one more step at the final size, without seams */
+    if (w1 > r->w_start + depth - 1) {
+        fixed += (cost[LQR_DEADLINE_FLATTEN] + cost[LQR_DEADLINE_UNIFORM] + cost[LQR_DEADLINE_INFLATE]) * w1 * h;
+    }
+
+    /* the other direction */
+    if (r->deadline_next) {
+        next_points = (gdouble) w1 * h;
+        fixed += (cost[LQR_DEADLINE_TRANSPOSE] + cost[LQR_DEADLINE_UNIFORM]) * next_points;
+        if (r->deadline_next < 0) {
+            fixed += cost[LQR_DEADLINE_FLATTEN] * w1 * (h + r->deadline_next);
+        } else {
+            fixed += cost[LQR_DEADLINE_INFLATE] * w1 * (h + r->deadline_next + 1);
+        }
+        work_next += cost[LQR_DEADLINE_MAPS] * next_points;
+        work_next += cost[LQR_DEADLINE_SEAM] * ABS(r->deadline_next) * w1;
+    }
+
+    spare = r->deadline * 1e-6 - now - fixed;
+    if (work_next > 0) {
+        spare *= work / (work + work_next);
+    }
+    r->deadline_stop = now + MAX(spare, 0);
+    r->deadline_watch = FALSE;
+    r->deadline_hit = FALSE;
+}
+
+/* returns the starting time of a phase (only with a deadline) */
+gdouble
+lqr_carver_deadline_start(LqrCarver *r)
+{
+    if (!r->deadline) {
+        return 0;
+    }
+    return g_timer_elapsed(r->deadline_timer, NULL);
+}
+
+/* update the estimated cost per point of a phase started at t0
+ * with the time it took (only with a deadline) */
+void
+lqr_carver_deadline_stop(LqrCarver *r, LqrDeadlinePhase phase, gdouble t0, gdouble points)
+{
+    if (!r->deadline || (points <= 0)) {
+        return;
+    }
+    r->deadline_cost[phase] = (g_timer_elapsed(r->deadline_timer, NULL) - t0) / points;
+}
+
+/* complete the visibility map from level l up to depth with straight
+ * seams evenly spaced over the current image, i.e. by a nearest-neighbour
+ * scaling of what has been carved so far (this only takes one pass over
+ * the rows). The seams are assigned their levels in a scattered order,
+ * stepping through them by about the golden ratio, so that intermediate
+ * widths are evenly spread as well */
+LqrRetVal
+lqr_carver_build_vsmap_uniform(LqrCarver *r, gint l, gint depth)
+{
+    gint *cols, *col_levels;
+    gint n, step, a, b, t;
+    gint i, j, x, y, x_dest;
+
+    n = MIN(depth - l, r->w - 1);
+
+    if (n > 0) {
+        LQR_CATCH_MEM(cols = g_try_new(gint, 2 * n));
+        col_levels = cols + n;
+
+        /* the step must be coprime with n for all the seams to be visited */
+        step = MAX((gint) (n * 0.618034), 1);
+        for (;;) {
+            a = step;
+            b = n;
+            while (b != 0) {
+                t = a % b;
+                a = b;
+                b = t;
+            }
+            if (a == 1) {
+                break;
+            }
+            step++;
+        }
+
+        for (i = 0; i < n; i++) {
+            cols[i] = (gint) ((2 * (gint64) i + 1) * r->w / (2 * n));
+        }
+        for (j = 0, i = 0; j < n; j++, i = (i + step) % n) {
+            col_levels[i] = l + j + r->max_level - 1;
+        }
+
+        for (y = 0; y < r->h; y++) {
+            LQR_CATCH_CANC_ROW(r, y);
+            x_dest = 0;
+            for (x = 0, i = 0; x < r->w; x++) {
+                if ((i < n) && (x == cols[i])) {
+                    VS_SET(r, r->raw[y][x], col_levels[i]);
+                    i++;
+                } else {
+                    r->raw[y][x_dest++] = r->raw[y][x];
+                }
+            }
+        }
+
+        g_free(cols);
+
+        r->w -= n;
+        r->level += n;
+        r->nrg_uptodate = FALSE;
+    }
+
+    if (r->w == 1) {
+        /* complete the map (last seam) */
+        lqr_carver_finish_vsmap(r);
+    }
+
+    return LQR_OK;
+}
+
+/* enlarge the image by seam insertion
+ * visibility map is updated and the resulting multisize image
+ * is complete in both directions */
+/* average the two neighbours of an inserted point,
+ * channel by channel (note that for integer types the
+ * rounding is the same as the truncated integer average);
+ * this is also used by the passive layers */
+void
+lqr_carver_inflate_average(void *rgb, void *new_rgb, gint channels, LqrColDepth col_depth, gint z0, gint c_left,
+                           gint z1)
+{
+    gint k;
+    gsize d0 = (gsize) z0 * channels;
+    gsize d1 = (gsize) c_left * channels;
+    gsize d2 = (gsize) z1 * channels;
+
+    switch (col_depth) {
+        case LQR_COLDEPTH_8I:
+            for (k = 0; k < channels; k++) {
+                AS_8I(new_rgb)[d0 + k] = (lqr_t_8i) ((AS_8I(rgb)[d1 + k] + AS_8I(rgb)[d2 + k]) / 2);
+            }
+            break;
+        case LQR_COLDEPTH_16I:
+            for (k = 0; k < channels; k++) {
+                AS_16I(new_rgb)[d0 + k] = (lqr_t_16i) ((AS_16I(rgb)[d1 + k] + AS_16I(rgb)[d2 + k]) / 2);
+            }
+            break;
+        case LQR_COLDEPTH_32F:
+            for (k = 0; k < channels; k++) {
+                AS_32F(new_rgb)[d0 + k] = (AS_32F(rgb)[d1 + k] + AS_32F(rgb)[d2 + k]) / 2;
+            }
+            break;
+        case LQR_COLDEPTH_64F:
+            for (k = 0; k < channels; k++) {
+                AS_64F(new_rgb)[d0 + k] = (AS_64F(rgb)[d1 + k] + AS_64F(rgb)[d2 + k]) / 2;
+            }
+            break;
+    }
+}
+
+/* insertion kernels: the i-th inserted point of a row goes before
+ * the old point ins[i], i.e. at ins[i] + i in the new row, and is
+ * interpolated from the old points ins[i] - 2 ... ins[i] + 1 (clamped
+ * to the row). Integer samples are interpolated in integer units
+ * (no normalisation), and rounded to the nearest value.
+ * When the kernel is given a buffer (buf != NULL) it first
+ * interpolates the whole row with plain contiguous loops (which the
+ * compiler can vectorize) and then picks the inserted points,
+ * otherwise it works point by point; buf must have room for
+ * (w0 + 1) * channels gdoubles */
+
+/* cubic kernel on integer samples: (9 (b + c) - (a + d)) / 16,
+ * clamped between b and c */
+static inline gint
+lqr_ins_cubic_int(gint a, gint b, gint c, gint d)
+{
+    gint val = (9 * (b + c) - (a + d) + 8) >> 4;
+    return CLAMP(val, MIN(b, c), MAX(b, c));
+}
+
+static inline gfloat
+lqr_ins_cubic_float(gfloat a, gfloat b, gfloat c, gfloat d)
+{
+    gfloat val = (9 * (b + c) - (a + d)) * 0.0625f;
+    return CLAMP(val, MIN(b, c), MAX(b, c));
+}
+
+static inline gdouble
+lqr_ins_cubic_double(gdouble a, gdouble b, gdouble c, gdouble d)
+{
+    gdouble val = (9 * (b + c) - (a + d)) * 0.0625;
+    return CLAMP(val, MIN(b, c), MAX(b, c));
+}
+
+/* cubic kernel on a single point x (with clamped taps) */
+static void
+lqr_ins_cubic_point_8i(const lqr_t_8i *src, lqr_t_8i *out, gint x, gint channels, gint w0)
+{
+    const lqr_t_8i *a = src + MAX(x - 2, 0) * channels;
+    const lqr_t_8i *b = src + MAX(x - 1, 0) * channels;
+    const lqr_t_8i *c = src + x * channels;
+    const lqr_t_8i *d = src + MIN(x + 1, w0 - 1) * channels;
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_8i) lqr_ins_cubic_int(a[k], b[k], c[k], d[k]);
+    }
+}
+
+static void
+lqr_ins_cubic_row_8i(const lqr_t_8i *src, lqr_t_8i *dest, const gint *ins, gint n, gint channels, gint w0,
+                     lqr_t_8i *mid)
+{
+    gint i, x, s;
+
+    if (mid == NULL) {
+        for (i = 0; i < n; i++) {
+            lqr_ins_cubic_point_8i(src, dest + (ins[i] + i) * channels, ins[i], channels, w0);
+        }
+        return;
+    }
+
+    /* mid holds, for each x, the point which would be inserted before x
+     * (the taps only need clamping at the ends of the row) */
+    for (x = 0; x < MIN(w0, 2); x++) {
+        lqr_ins_cubic_point_8i(src, mid + x * channels, x, channels, w0);
+    }
+    for (s = 2 * channels; s < (w0 - 1) * channels; s++) {
+        mid[s] = (lqr_t_8i) lqr_ins_cubic_int(src[s - 2 * channels], src[s - channels], src[s], src[s + channels]);
+    }
+    if (w0 > 2) {
+        lqr_ins_cubic_point_8i(src, mid + (w0 - 1) * channels, w0 - 1, channels, w0);
+    }
+
+    for (i = 0; i < n; i++) {
+        memcpy(dest + (ins[i] + i) * channels, mid + ins[i] * channels, channels * sizeof(lqr_t_8i));
+    }
+}
+
+/* energy-weighted kernel on a single point: b and c are the left and
+ * right neighbors, en_l and en_r their energies (in sample units);
+ * since each neighbor weighs 1 / (eps + en), the result is
+ * (b (eps + en_r) + c (eps + en_l)) / (2 eps + en_l + en_r),
+ * computed exactly in units of eps times the sample range */
+static void
+lqr_ins_weighted_blend_8i(const lqr_t_8i *b, const lqr_t_8i *c, lqr_t_8i *out, gint channels, gint en_l,
+                          gint en_r)
+{
+    gint64 e_l = (gint64) en_l * LQR_INS_ENERGY_EPS_INV + 0xFF;
+    gint64 e_r = (gint64) en_r * LQR_INS_ENERGY_EPS_INV + 0xFF;
+    gint64 den = 2 * (e_l + e_r);
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_8i) ((2 * (b[k] * e_r + c[k] * e_l) + e_l + e_r) / den);
+    }
+}
+
+static void
+lqr_ins_weighted_row_8i(const lqr_t_8i *src, lqr_t_8i *dest, const gint *ins, gint n, gint channels, gint w0,
+                        gint *en)
+{
+    const lqr_t_8i *a, *b, *c, *d;
+    gint en_l, en_r, sum;
+    gint i, k, x, s;
+
+    if (en == NULL) {
+        for (i = 0; i < n; i++) {
+            x = ins[i];
+            a = src + MAX(x - 2, 0) * channels;
+            b = src + MAX(x - 1, 0) * channels;
+            c = src + x * channels;
+            d = src + MIN(x + 1, w0 - 1) * channels;
+            en_l = 0;
+            en_r = 0;
+            for (k = 0; k < channels; k++) {
+                en_l += ABS((gint) b[k] - (gint) a[k]);
+                en_r += ABS((gint) d[k] - (gint) c[k]);
+            }
+            lqr_ins_weighted_blend_8i(b, c, dest + (x + i) * channels, channels, en_l, en_r);
+        }
+        return;
+    }
+
+    /* en[x] is the energy between x - 1 and x (0 at the ends of the
+     * row): the differences of the samples are computed first, then
+     * summed over the channels in place */
+    for (s = channels; s < w0 * channels; s++) {
+        en[s] = ABS((gint) src[s] - (gint) src[s - channels]);
+    }
+    for (x = 1; x < w0; x++) {
+        sum = 0;
+        for (k = 0; k < channels; k++) {
+            sum += en[x * channels + k];
+        }
+        en[x] = sum;
+    }
+    en[0] = 0;
+    en[w0] = 0;
+
+    for (i = 0; i < n; i++) {
+        x = ins[i];
+        lqr_ins_weighted_blend_8i(src + MAX(x - 1, 0) * channels, src + x * channels, dest + (x + i) * channels,
+                                  channels, en[MAX(x - 1, 0)], en[x + 1]);
+    }
+}
+
+/* cubic kernel on a single point x (with clamped taps) */
+static void
+lqr_ins_cubic_point_16i(const lqr_t_16i *src, lqr_t_16i *out, gint x, gint channels, gint w0)
+{
+    const lqr_t_16i *a = src + MAX(x - 2, 0) * channels;
+    const lqr_t_16i *b = src + MAX(x - 1, 0) * channels;
+    const lqr_t_16i *c = src + x * channels;
+    const lqr_t_16i *d = src + MIN(x + 1, w0 - 1) * channels;
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_16i) lqr_ins_cubic_int(a[k], b[k], c[k], d[k]);
+    }
+}
+
+static void
+lqr_ins_cubic_row_16i(const lqr_t_16i *src, lqr_t_16i *dest, const gint *ins, gint n, gint channels, gint w0,
+                     lqr_t_16i *mid)
+{
+    gint i, x, s;
+
+    if (mid == NULL) {
+        for (i = 0; i < n; i++) {
+            lqr_ins_cubic_point_16i(src, dest + (ins[i] + i) * channels, ins[i], channels, w0);
+        }
+        return;
+    }
+
+    /* mid holds, for each x, the point which would be inserted before x
+     * (the taps only need clamping at the ends of the row) */
+    for (x = 0; x < MIN(w0, 2); x++) {
+        lqr_ins_cubic_point_16i(src, mid + x * channels, x, channels, w0);
+    }
+    for (s = 2 * channels; s < (w0 - 1) * channels; s++) {
+        mid[s] = (lqr_t_16i) lqr_ins_cubic_int(src[s - 2 * channels], src[s - channels], src[s], src[s + channels]);
+    }
+    if (w0 > 2) {
+        lqr_ins_cubic_point_16i(src, mid + (w0 - 1) * channels, w0 - 1, channels, w0);
+    }
+
+    for (i = 0; i < n; i++) {
+        memcpy(dest + (ins[i] + i) * channels, mid + ins[i] * channels, channels * sizeof(lqr_t_16i));
+    }
+}
+
+/* energy-weighted kernel on a single point: b and c are the left and
+ * right neighbors, en_l and en_r their energies (in sample units);
+ * since each neighbor weighs 1 / (eps + en), the result is
+ * (b (eps + en_r) + c (eps + en_l)) / (2 eps + en_l + en_r),
+ * computed exactly in units of eps times the sample range */
+static void
+lqr_ins_weighted_blend_16i(const lqr_t_16i *b, const lqr_t_16i *c, lqr_t_16i *out, gint channels, gint en_l,
+                          gint en_r)
+{
+    gint64 e_l = (gint64) en_l * LQR_INS_ENERGY_EPS_INV + 0xFFFF;
+    gint64 e_r = (gint64) en_r * LQR_INS_ENERGY_EPS_INV + 0xFFFF;
+    gint64 den = 2 * (e_l + e_r);
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_16i) ((2 * (b[k] * e_r + c[k] * e_l) + e_l + e_r) / den);
+    }
+}
+
+static void
+lqr_ins_weighted_row_16i(const lqr_t_16i *src, lqr_t_16i *dest, const gint *ins, gint n, gint channels, gint w0,
+                        gint *en)
+{
+    const lqr_t_16i *a, *b, *c, *d;
+    gint en_l, en_r, sum;
+    gint i, k, x, s;
+
+    if (en == NULL) {
+        for (i = 0; i < n; i++) {
+            x = ins[i];
+            a = src + MAX(x - 2, 0) * channels;
+            b = src + MAX(x - 1, 0) * channels;
+            c = src + x * channels;
+            d = src + MIN(x + 1, w0 - 1) * channels;
+            en_l = 0;
+            en_r = 0;
+            for (k = 0; k < channels; k++) {
+                en_l += ABS((gint) b[k] - (gint) a[k]);
+                en_r += ABS((gint) d[k] - (gint) c[k]);
+            }
+            lqr_ins_weighted_blend_16i(b, c, dest + (x + i) * channels, channels, en_l, en_r);
+        }
+        return;
+    }
+
+    /* en[x] is the energy between x - 1 and x (0 at the ends of the
+     * row): the differences of the samples are computed first, then
+     * summed over the channels in place */
+    for (s = channels; s < w0 * channels; s++) {
+        en[s] = ABS((gint) src[s] - (gint) src[s - channels]);
+    }
+    for (x = 1; x < w0; x++) {
+        sum = 0;
+        for (k = 0; k < channels; k++) {
+            sum += en[x * channels + k];
+        }
+        en[x] = sum;
+    }
+    en[0] = 0;
+    en[w0] = 0;
+
+    for (i = 0; i < n; i++) {
+        x = ins[i];
+        lqr_ins_weighted_blend_16i(src + MAX(x - 1, 0) * channels, src + x * channels, dest + (x + i) * channels,
+                                  channels, en[MAX(x - 1, 0)], en[x + 1]);
+    }
+}
+
+/* cubic kernel on a single point x (with clamped taps) */
+static void
+lqr_ins_cubic_point_32f(const lqr_t_32f *src, lqr_t_32f *out, gint x, gint channels, gint w0)
+{
+    const lqr_t_32f *a = src + MAX(x - 2, 0) * channels;
+    const lqr_t_32f *b = src + MAX(x - 1, 0) * channels;
+    const lqr_t_32f *c = src + x * channels;
+    const lqr_t_32f *d = src + MIN(x + 1, w0 - 1) * channels;
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_32f) lqr_ins_cubic_float(a[k], b[k], c[k], d[k]);
+    }
+}
+
+static void
+lqr_ins_cubic_row_32f(const lqr_t_32f *src, lqr_t_32f *dest, const gint *ins, gint n, gint channels, gint w0,
+                     lqr_t_32f *mid)
+{
+    gint i, x, s;
+
+    if (mid == NULL) {
+        for (i = 0; i < n; i++) {
+            lqr_ins_cubic_point_32f(src, dest + (ins[i] + i) * channels, ins[i], channels, w0);
+        }
+        return;
+    }
+
+    /* mid holds, for each x, the point which would be inserted before x
+     * (the taps only need clamping at the ends of the row) */
+    for (x = 0; x < MIN(w0, 2); x++) {
+        lqr_ins_cubic_point_32f(src, mid + x * channels, x, channels, w0);
+    }
+    for (s = 2 * channels; s < (w0 - 1) * channels; s++) {
+        mid[s] = (lqr_t_32f) lqr_ins_cubic_float(src[s - 2 * channels], src[s - channels], src[s], src[s + channels]);
+    }
+    if (w0 > 2) {
+        lqr_ins_cubic_point_32f(src, mid + (w0 - 1) * channels, w0 - 1, channels, w0);
+    }
+
+    for (i = 0; i < n; i++) {
+        memcpy(dest + (ins[i] + i) * channels, mid + ins[i] * channels, channels * sizeof(lqr_t_32f));
+    }
+}
+
+/* energy-weighted kernel on a single point: b and c are the left and
+ * right neighbors, en_l and en_r their energies; since each neighbor
+ * weighs 1 / (eps + en), the result is
+ * (b (eps + en_r) + c (eps + en_l)) / (2 eps + en_l + en_r) */
+static void
+lqr_ins_weighted_blend_32f(const lqr_t_32f *b, const lqr_t_32f *c, lqr_t_32f *out, gint channels, lqr_t_32f en_l,
+                          lqr_t_32f en_r)
+{
+    gdouble e_l = LQR_INS_ENERGY_EPS + en_l;
+    gdouble e_r = LQR_INS_ENERGY_EPS + en_r;
+    gdouble inv = 1 / (e_l + e_r);
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_32f) ((b[k] * e_r + c[k] * e_l) * inv);
+    }
+}
+
+static void
+lqr_ins_weighted_row_32f(const lqr_t_32f *src, lqr_t_32f *dest, const gint *ins, gint n, gint channels, gint w0,
+                        lqr_t_32f *en)
+{
+    const lqr_t_32f *a, *b, *c, *d;
+    lqr_t_32f en_l, en_r, sum;
+    gint i, k, x, s;
+
+    if (en == NULL) {
+        for (i = 0; i < n; i++) {
+            x = ins[i];
+            a = src + MAX(x - 2, 0) * channels;
+            b = src + MAX(x - 1, 0) * channels;
+            c = src + x * channels;
+            d = src + MIN(x + 1, w0 - 1) * channels;
+            en_l = 0;
+            en_r = 0;
+            for (k = 0; k < channels; k++) {
+                en_l += fabsf(b[k] - a[k]);
+                en_r += fabsf(d[k] - c[k]);
+            }
+            lqr_ins_weighted_blend_32f(b, c, dest + (x + i) * channels, channels, en_l, en_r);
+        }
+        return;
+    }
+
+    /* en[x] is the energy between x - 1 and x (0 at the ends of the
+     * row): the differences of the samples are computed first, then
+     * summed over the channels in place */
+    for (s = channels; s < w0 * channels; s++) {
+        en[s] = fabsf(src[s] - src[s - channels]);
+    }
+    for (x = 1; x < w0; x++) {
+        sum = 0;
+        for (k = 0; k < channels; k++) {
+            sum += en[x * channels + k];
+        }
+        en[x] = sum;
+    }
+    en[0] = 0;
+    en[w0] = 0;
+
+    for (i = 0; i < n; i++) {
+        x = ins[i];
+        lqr_ins_weighted_blend_32f(src + MAX(x - 1, 0) * channels, src + x * channels, dest + (x + i) * channels,
+                                  channels, en[MAX(x - 1, 0)], en[x + 1]);
+    }
+}
+
+/* cubic kernel on a single point x (with clamped taps) */
+static void
+lqr_ins_cubic_point_64f(const lqr_t_64f *src, lqr_t_64f *out, gint x, gint channels, gint w0)
+{
+    const lqr_t_64f *a = src + MAX(x - 2, 0) * channels;
+    const lqr_t_64f *b = src + MAX(x - 1, 0) * channels;
+    const lqr_t_64f *c = src + x * channels;
+    const lqr_t_64f *d = src + MIN(x + 1, w0 - 1) * channels;
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_64f) lqr_ins_cubic_double(a[k], b[k], c[k], d[k]);
+    }
+}
+
+static void
+lqr_ins_cubic_row_64f(const lqr_t_64f *src, lqr_t_64f *dest, const gint *ins, gint n, gint channels, gint w0,
+                     lqr_t_64f *mid)
+{
+    gint i, x, s;
+
+    if (mid == NULL) {
+        for (i = 0; i < n; i++) {
+            lqr_ins_cubic_point_64f(src, dest + (ins[i] + i) * channels, ins[i], channels, w0);
+        }
+        return;
+    }
+
+    /* mid holds, for each x, the point which would be inserted before x
+     * (the taps only need clamping at the ends of the row) */
+    for (x = 0; x < MIN(w0, 2); x++) {
+        lqr_ins_cubic_point_64f(src, mid + x * channels, x, channels, w0);
+    }
+    for (s = 2 * channels; s < (w0 - 1) * channels; s++) {
+        mid[s] = (lqr_t_64f) lqr_ins_cubic_double(src[s - 2 * channels], src[s - channels], src[s], src[s + channels]);
+    }
+    if (w0 > 2) {
+        lqr_ins_cubic_point_64f(src, mid + (w0 - 1) * channels, w0 - 1, channels, w0);
+    }
+
+    for (i = 0; i < n; i++) {
+        memcpy(dest + (ins[i] + i) * channels, mid + ins[i] * channels, channels * sizeof(lqr_t_64f));
+    }
+}
+
+/* energy-weighted kernel on a single point: b and c are the left and
+ * right neighbors, en_l and en_r their energies; since each neighbor
+ * weighs 1 / (eps + en), the result is
+ * (b (eps + en_r) + c (eps + en_l)) / (2 eps + en_l + en_r) */
+static void
+lqr_ins_weighted_blend_64f(const lqr_t_64f *b, const lqr_t_64f *c, lqr_t_64f *out, gint channels, lqr_t_64f en_l,
+                          lqr_t_64f en_r)
+{
+    gdouble e_l = LQR_INS_ENERGY_EPS + en_l;
+    gdouble e_r = LQR_INS_ENERGY_EPS + en_r;
+    gdouble inv = 1 / (e_l + e_r);
+    gint k;
+
+    for (k = 0; k < channels; k++) {
+        out[k] = (lqr_t_64f) ((b[k] * e_r + c[k] * e_l) * inv);
+    }
+}
+
+static void
+lqr_ins_weighted_row_64f(const lqr_t_64f *src, lqr_t_64f *dest, const gint *ins, gint n, gint channels, gint w0,
+                        lqr_t_64f *en)
+{
+    const lqr_t_64f *a, *b, *c, *d;
+    lqr_t_64f en_l, en_r, sum;
+    gint i, k, x, s;
+
+    if (en == NULL) {
+        for (i = 0; i < n; i++) {
+            x = ins[i];
+            a = src + MAX(x - 2, 0) * channels;
+            b = src + MAX(x - 1, 0) * channels;
+            c = src + x * channels;
+            d = src + MIN(x + 1, w0 - 1) * channels;
+            en_l = 0;
+            en_r = 0;
+            for (k = 0; k < channels; k++) {
+                en_l += fabs(b[k] - a[k]);
+                en_r += fabs(d[k] - c[k]);
+            }
+            lqr_ins_weighted_blend_64f(b, c, dest + (x + i) * channels, channels, en_l, en_r);
+        }
+        return;
+    }
+
+    /* en[x] is the energy between x - 1 and x (0 at the ends of the
+     * row): the differences of the samples are computed first, then
+     * summed over the channels in place */
+    for (s = channels; s < w0 * channels; s++) {
+        en[s] = fabs(src[s] - src[s - channels]);
+    }
+    for (x = 1; x < w0; x++) {
+        sum = 0;
+        for (k = 0; k < channels; k++) {
+            sum += en[x * channels + k];
+        }
+        en[x] = sum;
+    }
+    en[0] = 0;
+    en[w0] = 0;
+
+    for (i = 0; i < n; i++) {
+        x = ins[i];
+        lqr_ins_weighted_blend_64f(src + MAX(x - 1, 0) * channels, src + x * channels, dest + (x + i) * channels,
+                                  channels, en[MAX(x - 1, 0)], en[x + 1]);
+    }
+}
+
+/* interpolate the points inserted in row y with the cubic or the
+ * energy-weighted kernel (the sample type is dispatched once per row):
+ *  - cubic: a four-tap cubic (Catmull-Rom at the midpoint) along the
+ *    row, clamped between the two nearest neighbors, which avoids
+ *    ringing at edges;
+ *  - energy-weighted: a weighted average of the left and right
+ *    neighbors, where each one weighs inversely to its local energy
+ *    (the gradient towards its outer neighbor, summed over the
+ *    channels); this keeps the inserted point on the smooth side
+ *    of an edge instead of smearing it */
+void
+lqr_carver_inflate_row_kernel(LqrCarver *r, void *new_rgb, gint y, gint w1, gint *ins, gint n, gpointer buf)
+{
+    gsize d0 = (gsize) y * w1 * r->channels;
+    gsize d1 = (gsize) y * r->w0 * r->channels;
+
+    /* interpolating the whole row only pays off if enough points are inserted */
+    if (n * LQR_INS_DENSE_RATIO < r->w0) {
+        buf = NULL;
+    }
+
+    if (r->ins_kernel == LQR_INS_KERNEL_CUBIC) {
+        switch (r->col_depth) {
+            case LQR_COLDEPTH_8I:
+                lqr_ins_cubic_row_8i(AS_8I(r->rgb) + d1, AS_8I(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+            case LQR_COLDEPTH_16I:
+                lqr_ins_cubic_row_16i(AS_16I(r->rgb) + d1, AS_16I(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+            case LQR_COLDEPTH_32F:
+                lqr_ins_cubic_row_32f(AS_32F(r->rgb) + d1, AS_32F(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+            case LQR_COLDEPTH_64F:
+                lqr_ins_cubic_row_64f(AS_64F(r->rgb) + d1, AS_64F(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+        }
+    } else {
+        switch (r->col_depth) {
+            case LQR_COLDEPTH_8I:
+                lqr_ins_weighted_row_8i(AS_8I(r->rgb) + d1, AS_8I(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+            case LQR_COLDEPTH_16I:
+                lqr_ins_weighted_row_16i(AS_16I(r->rgb) + d1, AS_16I(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+            case LQR_COLDEPTH_32F:
+                lqr_ins_weighted_row_32f(AS_32F(r->rgb) + d1, AS_32F(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+            case LQR_COLDEPTH_64F:
+                lqr_ins_weighted_row_64f(AS_64F(r->rgb) + d1, AS_64F(new_rgb) + d0, ins, n, r->channels, r->w0, buf);
+                break;
+        }
+    }
+}
+
+/* build row y of the inflated maps; ins must have room
+ * for the (w1 - w0) insertion points of the row, kbuf is
+ * the buffer of the insertion kernel (see above, may be NULL) */
+void
+lqr_carver_inflate_row(LqrCarver *r, gint l, gint y, gint w1, gint *ins, void *new_rgb, void *new_vs,
+                       gboolean new_vs_compact, gfloat *new_bias, gfloat *new_nrg_buffer, gfloat *new_rigmask,
+                       gpointer kbuf)
+{
+    gint x, x1, x1_next, vs, n, i, run;
+    gint z0, z1, c_left;
+    gsize pxl_size;
+
+    z1 = y * r->w0;
+
+    /* first pass: locate the insertion points, and meanwhile
+     * compute the new visibilities and the new raw indices */
+    n = 0;
+    x = 0;
+    for (x1 = 0; x1 < r->w0; x1++) {
+        z0 = y * w1 + x1 + n;
+        vs = VS_GET(r, z1 + x1);
+        if ((vs != 0) && (vs <= l + r->max_level - 1)
+            && (vs >= 2 * r->max_level - 1)) {
+            /* the point belongs to a previously computed seam
+             * and was not inserted during a previous
+             * inflate() call : insert another seam */
+#ifdef __LQR_DEBUG__
+            assert(n < w1 - r->w0);
+#endif /* __LQR_DEBUG__ */
+            ins[n++] = x1;
+
+            /* the first time inflate() is called
+             * the new visibility should be -vs + 1 but we shift it
+             * so that the final minimum visibiliy will be 1 again
+             * and so that vs=0 still means "uninitialized".
+             * Subsequent inflations account for that */
+            if (r->root == NULL) {
+                VS_SET_AS(new_vs, new_vs_compact, z0, l - vs + r->max_level);
+            }
+            z0++;
+        }
+        if (vs != 0) {
+            /* visibility has to be shifted up */
+            if (r->root == NULL) {
+                VS_SET_AS(new_vs, new_vs_compact, z0, vs + l - r->max_level + 1);
+            }
+        } else if (r->raw != NULL) {
+#ifdef __LQR_DEBUG__
+            assert(y < r->h_start);
+            assert(x < r->w_start - l);
+#endif /* __LQR_DEBUG__ */
+            r->raw[y][x] = z0;
+            x++;
+        }
+    }
+
+#ifdef __LQR_DEBUG__
+    assert(n == w1 - r->w0);
+    if ((r->raw != NULL) && (w1 != 2 * r->w_start - 1)) {
+        assert(x == r->w_start - l);
+    }
+#endif /* __LQR_DEBUG__ */
+
+    /* second pass: block-copy the runs between insertion points;
+     * with the default kernel each inserted point is the average
+     * of its neighbors, the other kernels work on the whole row
+     * afterwards */
+    pxl_size = LQR_SAMPLE_SIZE(r->col_depth) * r->channels;
+    z0 = y * w1;
+    x1 = 0;
+    for (i = 0; i <= n; i++) {
+        x1_next = (i < n) ? ins[i] : r->w0;
+        run = x1_next - x1;
+        if (run > 0) {
+            memcpy((guchar *) new_rgb + z0 * pxl_size, (guchar *) r->rgb + (z1 + x1) * pxl_size, run * pxl_size);
+            if (r->active) {
+                if (r->bias) {
+                    memcpy(new_bias + z0, r->bias + z1 + x1, run * sizeof(gfloat));
+                }
+                if (r->nrg_buffer) {
+                    memcpy(new_nrg_buffer + z0, r->nrg_buffer + z1 + x1, run * sizeof(gfloat));
+                }
+                if (r->rigidity_mask) {
+                    memcpy(new_rigmask + z0, r->rigidity_mask + z1 + x1, run * sizeof(gfloat));
+                }
+            }
+            z0 += run;
+            x1 = x1_next;
+        }
+        if (i == n) {
+            break;
+        }
+
+        c_left = (x1 > 0) ? z1 + x1 - 1 : z1 + x1;
+        if (r->ins_kernel == LQR_INS_KERNEL_AVERAGE) {
+            lqr_carver_inflate_average(r->rgb, new_rgb, r->channels, r->col_depth, z0, c_left, z1 + x1);
+        }
+        if (r->active) {
+            if (r->bias) {
+                new_bias[z0] = (r->bias[c_left] + r->bias[z1 + x1]) / 2;
+            }
+            if (r->nrg_buffer) {
+                new_nrg_buffer[z0] = (r->nrg_buffer[c_left] + r->nrg_buffer[z1 + x1]) / 2;
+            }
+            if (r->rigidity_mask) {
+                new_rigmask[z0] = (r->rigidity_mask[c_left] + r->rigidity_mask[z1 + x1]) / 2;
+            }
+        }
+        z0++;
+    }
+
+    if ((r->ins_kernel != LQR_INS_KERNEL_AVERAGE) && (n > 0)) {
+        lqr_carver_inflate_row_kernel(r, new_rgb, y, w1, ins, n, kbuf);
+    }
+}
+
+LqrRetVal
+lqr_carver_inflate(LqrCarver *r, gint l)
+{
+    gint w1, y;
+    gint *ins = NULL;
+    LqrRetVal ret_val;
+    void *new_rgb = NULL;
+    void *new_vs = NULL;
+    gboolean new_vs_compact = FALSE;
+    gfloat *new_bias = NULL;
+    gfloat *new_nrg_buffer = NULL;
+    gfloat *new_rigmask = NULL;
+    LqrDataTok data_tok;
+    LqrCarverState prev_state = LQR_CARVER_STATE_STD;
+    gdouble t0;
+
+#ifdef __LQR_VERBOSE__
+    printf("  [ inflating (active=%i) ]\n", r->active);
+    fflush(stdout);
+#endif /* __LQR_VERBOSE__ */
+
+#ifdef __LQR_DEBUG__
+    assert(l + 1 > r->max_level);       /* otherwise is useless */
+#endif /* __LQR_DEBUG__ */
+
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(LQR_POINTS_FIT(r->w0 + l - r->max_level + 1, r->h0));
+
+    if (r->root == NULL) {
+        prev_state = g_atomic_int_get(&r->state);
+        LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_INFLATING, TRUE));
+    }
+
+    /* first iterate on attached carvers */
+    data_tok.integer = l;
+    LQR_CATCH(lqr_carver_list_foreach_parallel(r->attached_list, lqr_carver_inflate_attached, data_tok));
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "inflate", -1);
+
+    /* scale to current maximum size
+     * (this is the original size the first time) */
+    lqr_carver_set_width(r, r->w0);
+
+    /* final width */
+    w1 = r->w0 + l - r->max_level + 1;
+
+    /* allocate room for new maps */
+    BUF_SCRATCH_TRY_NEW0_RET_LQR(r, new_rgb, (gsize) w1 * r->h0 * r->channels, r->col_depth);
+
+    if (r->root == NULL) {
+        new_vs_compact = VS_USE_COMPACT(w1);
+        LQR_TRACE_CATCH_MEM(r, new_vs = VS_TRY_NEW0(r, new_vs_compact, (gsize) w1 * r->h0));
+    }
+    if (r->active) {
+        if (r->bias) {
+            LQR_TRACE_CATCH_MEM(r, new_bias = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) w1 * r->h0));
+        }
+        if (r->nrg_buffer) {
+            LQR_TRACE_CATCH_MEM(r, new_nrg_buffer = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) w1 * r->h0));
+        }
+        if (r->rigidity_mask) {
+            LQR_TRACE_CATCH_MEM(r, new_rigmask = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) w1 * r->h0));
+        }
+    }
+
+    LQR_TRACE_CATCH_MEM(r, ins = LQR_SCRATCH_TRY_NEW(r, gint, (gsize) MAX(w1 - r->w0, 1) * r->h0));
+
+    /* rows are independent: each one holds exactly w1 points in
+     * the new maps, and its insertion points are those of its own
+     * visibility values (all points are visible at the current size,
+     * therefore we can gather them in order without using the cursor);
+     * each thread has its own buffer for the insertion kernel (if it
+     * cannot be allocated the kernel works point by point) */
+#ifdef _OPENMP
+#pragma omp parallel num_threads(lqr_carver_n_threads(r)) if (w1 * r->h0 >= LQR_INFLATE_PARALLEL_MIN_SIZE)
+#endif /* _OPENMP */
+    {
+        gpointer kbuf = NULL;
+
+        if (r->ins_kernel != LQR_INS_KERNEL_AVERAGE) {
+            kbuf = g_try_new(gdouble, (gsize) (r->w0 + 1) * r->channels);
+        }
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif /* _OPENMP */
+        for (y = 0; y < r->h0; y++) {
+            if (LQR_CANC_ROW(r, y)) {
+                continue;
+            }
+            lqr_carver_inflate_row(r, l, y, w1, ins + (gsize) y * (w1 - r->w0), new_rgb, new_vs, new_vs_compact,
+                                   new_bias, new_nrg_buffer, new_rigmask, kbuf);
+        }
+        g_free(kbuf);
+    }
+
+    if (g_atomic_int_get(&r->state) == LQR_CARVER_STATE_CANCELLED) {
+        lqr_carver_scratch_free(r, ins);
+        lqr_carver_trace_unwind(r);
+        return LQR_USRCANCEL;
+    }
+
+    /* passive layers follow the same insertion points */
+    ret_val = lqr_layer_list_inflate(r->layers, w1, ins);
+    lqr_carver_scratch_free(r, ins);
+    if (ret_val != LQR_OK) {
+        lqr_carver_trace_unwind(r);
+        return ret_val;
+    }
+
+    /* substitute maps */
+    if (!r->preserve_in_buffer) {
+        lqr_carver_scratch_free(r, r->rgb);
+    }
+    /* g_free (r->vs); */
+    lqr_carver_scratch_free(r, r->en);
+    lqr_carver_scratch_free(r, r->m);
+    lqr_carver_scratch_free(r, r->rcache);
+    lqr_carver_scratch_free(r, r->least);
+    lqr_carver_scratch_free(r, r->least_alt);
+    r->least_alt = NULL;
+    lqr_carver_scratch_free(r, r->bias);
+    lqr_carver_scratch_free(r, r->nrg_buffer);
+    lqr_carver_scratch_free(r, r->rigidity_mask);
+
+    r->bias = NULL;
+    r->nrg_buffer = NULL;
+    r->rcache = NULL;
+    r->nrg_uptodate = FALSE;
+    r->mmap_uptodate = FALSE;
+
+    r->rgb = new_rgb;
+    r->preserve_in_buffer = FALSE;
+
+    if (r->root == NULL) {
+        lqr_carver_scratch_free(r, r->vs);
+        r->vs = new_vs;
+        r->vs_compact = new_vs_compact;
+        LQR_TRACE_CATCH(r, lqr_carver_propagate_vsmap(r));
+    } else {
+        /* r->vs = NULL; */
+    }
+    if (r->nrg_active) {
+        LQR_TRACE_CATCH_MEM(r, r->en = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) w1 * r->h0));
+    }
+    if (r->active) {
+        r->bias = new_bias;
+        r->nrg_buffer = new_nrg_buffer;
+        r->rigidity_mask = new_rigmask;
+        LQR_TRACE_CATCH_MEM(r, r->m = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) w1 * r->h0));
+        LQR_TRACE_CATCH_MEM(r, r->least = LEAST_TRY_NEW0(r, (gsize) w1 * r->h0));
+    }
+
+    /* set new widths & levels (w_start is kept for reference) */
+    r->level = l + 1;
+    r->max_level = l + 1;
+    r->w0 = w1;
+    r->w = r->w_start;
+
+    /* reset readout buffer */
+    g_free(r->rgb_ro_buffer);
+    BUF_TRY_NEW0_RET_LQR(r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
+
+#ifdef __LQR_VERBOSE__
     printf("  [ inflating OK ]\n");
     fflush(stdout);
 #endif /* __LQR_VERBOSE__ */
 
-    if (r->root == NULL) {
-        LQR_CATCH(lqr_carver_set_state(r, prev_state, TRUE));
+    lqr_carver_trace_end(r, "inflate", -1);
+    lqr_carver_stats_stop(r, &r->stats.inflate, t0, (guint64) r->w0 * r->h0);
+
+    if (r->root == NULL) {
+        LQR_CATCH(lqr_carver_set_state(r, prev_state, TRUE));
+    }
+
+    return LQR_OK;
+}
+
+LqrRetVal
+lqr_carver_inflate_attached(LqrCarver *r, LqrDataTok data)
+{
+    return lqr_carver_inflate(r, data.integer);
+}
+
+/*** internal functions for maps computations ***/
+
+/* least-cost point in row y - 1 among those reachable from
+ * (x, y), found by scanning the minpath map */
+gint
+lqr_carver_least_scan(LqrCarver *r, gint y, gint x)
+{
+    gint x1, x1_min, x1_max;
+    gint least;
+    gfloat m, m1;
+
+    x1_min = MAX(x - r->delta_x, 0);
+    x1_max = MIN(x + r->delta_x, r->w - 1);
+    least = x1_min;
+    m = r->m[r->raw[y - 1][x1_min]];
+    for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
+        m1 = r->m[r->raw[y - 1][x1]];
+        if (m1 < m) {
+            m = m1;
+            least = x1;
+        }
+    }
+    return least;
+}
+
+/* shift an offset of the minpath map across the seam */
+gint
+lqr_carver_carve_least(LqrCarver *r, gint least, gint x, gint x_seam, gint x_seam_down)
+{
+    gint x_down;
+
+    if (least == LEAST_NONE(r)) {
+        return least;
+    }
+    x_down = x + least;
+    if (x_down == x_seam_down) {
+        /* the least-cost point has been carved away,
+         * update_mmap() will need to recompute it */
+        return LEAST_NONE(r);
+    }
+    return (x_down - (x_down > x_seam_down)) - (x - (x > x_seam));
+}
+
+/* carve row y of the raw array
+ * (the offsets in the minpath map are fixed first: only the points
+ * within delta_x from the seam may see them changed;
+ * note: here r->w has already been decreased)
+ * returns the number of points moved */
+gint
+lqr_carver_carve_row(LqrCarver *r, gint y)
+{
+    gint x;
+    gint x_min, x_max;
+    gint x_seam, x_seam_down;
+    gint data;
+
+    if (y > 0) {
+        x_seam = r->vpath_x[y];
+        x_seam_down = r->vpath_x[y - 1];
+        x_min = MAX(MIN(x_seam, x_seam_down) - r->delta_x, 0);
+        x_max = MIN(MAX(x_seam, x_seam_down) + r->delta_x, r->w);
+        for (x = x_min; x <= x_max; x++) {
+            data = r->raw[y][x];
+            if (x == x_seam) {
+                continue;
+            }
+            LEAST_SET(r, data, lqr_carver_carve_least(r, LEAST_GET(r, data), x, x_seam, x_seam_down));
+            if (r->least_alt) {
+                LEAST_ALT_SET(r, data, lqr_carver_carve_least(r, LEAST_ALT_GET(r, data), x, x_seam, x_seam_down));
+            }
+        }
+    }
+
+#ifdef __LQR_DEBUG__
+    assert(VS_GET(r, r->raw[y][r->vpath_x[y]]) != 0);
+    for (x = 0; x < r->vpath_x[y]; x++) {
+        assert(VS_GET(r, r->raw[y][x]) == 0);
+    }
+#endif /* __LQR_DEBUG__ */
+    memmove(r->raw[y] + r->vpath_x[y], r->raw[y] + r->vpath_x[y] + 1, (r->w - r->vpath_x[y]) * sizeof(gint));
+#ifdef __LQR_DEBUG__
+    for (x = r->vpath_x[y]; x < r->w; x++) {
+        assert(VS_GET(r, r->raw[y][x]) == 0);
+    }
+#endif /* __LQR_DEBUG__ */
+
+    return r->w - r->vpath_x[y];
+}
+
+/* do the carving
+ * this actually carves the raw array,
+ * which holds the indices to be used
+ * in all the other maps */
+void
+lqr_carver_carve(LqrCarver *r)
+{
+    gint y;
+    guint64 points = 0;
+    gdouble t0;
+
+#ifdef __LQR_DEBUG__
+    assert(r->root == NULL);
+#endif /* __LQR_DEBUG__ */
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "carve", -1);
+
+    for (y = 0; y < r->h_start; y++) {
+        points += lqr_carver_carve_row(r, y);
+    }
+
+    r->nrg_uptodate = FALSE;
+
+    lqr_carver_trace_end(r, "carve", -1);
+    lqr_carver_stats_stop(r, &r->stats.carve, t0, points);
+}
+
+/* set the range of row y whose energy is affected by the seam,
+ * i.e. the points within radius from the seam in the rows within
+ * radius from y (note: here the vpath has already been carved) */
+void
+lqr_carver_update_emap_range(LqrCarver *r, gint y, gint radius)
+{
+    gint y1;
+    gint x_min, x_max;
+
+    x_min = r->vpath_x[y];
+    x_max = r->vpath_x[y] - 1;
+    for (y1 = MAX(y - radius, 0); y1 <= MIN(y + radius, r->h - 1); y1++) {
+        x_min = MIN(x_min, r->vpath_x[y1] - radius);
+        /* note: the -1 below is because of the previous carving */
+        x_max = MAX(x_max, r->vpath_x[y1] + radius - 1);
+    }
+    r->nrg_xmin[y] = MAX(0, x_min);
+    r->nrg_xmax[y] = MIN(r->w - 1, x_max);
+}
+
+/* update energy map after seam removal */
+LqrRetVal
+lqr_carver_update_emap(LqrCarver *r)
+{
+    gint x, y;
+    gint radius;
+    gboolean is_static;
+    guint64 points = 0;
+    gdouble t0;
+
+    LQR_CATCH_CANC(r);
+
+    if (r->nrg_uptodate) {
+        return LQR_OK;
+    }
+
+    /* a static energy does not depend on the neighbours,
+     * so the energy of the remaining points is unchanged;
+     * we only need to mark the seam for update_mmap */
+    is_static = LQR_NRG_IS_STATIC(r);
+    radius = is_static ? 0 : r->nrg_radius;
+
+    if (r->use_rcache && !is_static) {
+        LQR_CATCH_F(r->rcache != NULL);
+    }
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "update_emap", -1);
+
+    for (y = 0; y < r->h; y++) {
+        lqr_carver_update_emap_range(r, y, radius);
+    }
+
+    for (y = 0; y < r->h && !is_static; y++) {
+        LQR_TRACE_CATCH_CANC_ROW(r, y);
+
+        for (x = r->nrg_xmin[y]; x <= r->nrg_xmax[y]; x++) {
+            LQR_TRACE_CATCH(r, lqr_carver_compute_e(r, x, y));
+        }
+        points += MAX(r->nrg_xmax[y] - r->nrg_xmin[y] + 1, 0);
+    }
+
+    r->nrg_uptodate = TRUE;
+
+    lqr_carver_trace_end(r, "update_emap", -1);
+    lqr_carver_stats_stop(r, &r->stats.update_emap, t0, points);
+
+    return LQR_OK;
+}
+
+/* update the auxiliary minpath map
+ * this only updates the affected pixels,
+ * which start form the beginning of the changed
+ * energy region around the seam and expand
+ * at most by delta_x (in both directions)
+ * at each row */
+LqrRetVal
+lqr_carver_update_mmap(LqrCarver *r)
+{
+    gint y;
+    gint x_min = 0, x_max = -1;
+    gfloat *mc = NULL;
+    LqrMinWindow mw_storage;
+    LqrMinWindow *mw;
+    guint64 span = 0;
+    gdouble t0;
+
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(r->nrg_uptodate);
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "update_mmap", -1);
+
+    if (r->rigidity) {
+        LQR_TRACE_CATCH_MEM(r, mc = g_try_new(gfloat, 2 * r->delta_x + 1));
+        mc += r->delta_x;
+    }
+    LQR_TRACE_CATCH(r, lqr_carver_min_window_init(r, &mw, &mw_storage));
+
+    for (y = 0; y < r->h; y++) {
+        LQR_TRACE_CATCH_CANC_ROW(r, y);
+        span += lqr_carver_update_mmap_row(r, y, &x_min, &x_max, mc, mw);
+    }
+
+    if (r->rigidity) {
+        mc -= r->delta_x;
+        g_free(mc);
+    }
+
+    if (r->collect_stats) {
+        r->stats_mmap_rows += r->h;
+    }
+    lqr_carver_trace_end(r, "update_mmap", -1);
+    lqr_carver_stats_stop(r, &r->stats.update_mmap, t0, span);
+
+    return LQR_OK;
+}
+
+/* update row y of the minpath map, as part of update_mmap():
+ * x_min and x_max hold the region affected in the previous row
+ * and are updated for the next one; mc is a scratch buffer of
+ * 2 * delta_x + 1 elements (centered) used with rigidity, mw is
+ * the sliding window minimum (NULL if delta_x is small).
+ * Returns the number of points spanned */
+gint
+lqr_carver_update_mmap_row(LqrCarver *r, gint y, gint *x_min_p, gint *x_max_p, gfloat *mc, LqrMinWindow *mw)
+{
+    gint x;
+    gint x_min, x_max;
+    gint x1, dx;
+    gint x1_min, x1_max;
+    gint data, data_down, least;
+    gint least_alt = 0;
+    gfloat m, m1, r_fact;
+    gfloat new_m;
+    gint stop;
+    gint x_stop;
+    gint span;
+
+    if (y == 0) {
+        /* span first row */
+        /* x_min = MAX (r->vpath_x[0] - r->delta_x, 0); */
+        x_min = MAX(r->nrg_xmin[0], 0);
+        /* x_max = MIN (r->vpath_x[0] + r->delta_x - 1, r->w - 1); */
+        /* x_max = MIN (r->vpath_x[0] + r->delta_x, r->w - 1); */
+        x_max = MIN(r->nrg_xmax[0], r->w - 1);
+
+        for (x = x_min; x <= x_max; x++) {
+            data = r->raw[0][x];
+            r->m[data] = r->en[data];
+        }
+        *x_min_p = x_min;
+        *x_max_p = x_max;
+        return MAX(x_max - x_min + 1, 0);
+    }
+
+    /* make sure to include the changed energy region */
+    x_min = MIN(*x_min_p, r->nrg_xmin[y]);
+    x_max = MAX(*x_max_p, r->nrg_xmax[y]);
+
+    /* expand the affected region by delta_x */
+    x_min = MAX(x_min - r->delta_x, 0);
+    x_max = MIN(x_max + r->delta_x, r->w - 1);
+    span = x_max - x_min + 1;
+
+    if (mw) {
+        lqr_carver_min_window_reset(mw, MAX(x_min - r->delta_x, 0));
     }
 
-    return LQR_OK;
-}
+    /* span the affected region */
+    stop = 0;
+    x_stop = 0;
+    for (x = x_min; x <= x_max; x++) {
+        data = r->raw[y][x];
+        if (r->rigidity_mask) {
+            r_fact = r->rigidity_mask[data];
+        } else {
+            r_fact = 1;
+        }
 
-LqrRetVal
-lqr_carver_inflate_attached(LqrCarver *r, LqrDataTok data)
-{
-    return lqr_carver_inflate(r, data.integer);
-}
+        /* find the minimum in the previous rows
+         * as in build_mmap() */
+        x1_min = MAX(0, x - r->delta_x);
+        x1_max = MIN(r->w - 1, x + r->delta_x);
+
+        if (mw) {
+            least = lqr_carver_min_window(r, mw, y, x1_min, x1_max);
+            m = r->m[r->raw[y - 1][least]];
+        } else if (r->rigidity) {
+            dx = x1_min - x;
+            switch (x1_max - x1_min + 1) {
+                UPDATE_MMAP_OPTIMISED_CASES_RIG
+                default:
+                    data_down = r->raw[y - 1][x1_min];
+                    least = x1_min;
+                    m = r->m[data_down] + r_fact * r->rigidity_map[dx++];
+                    /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1_min, dx, m, MRDOWN(y, x1_min, dx), r->m[data_down], MDOWN(y, x1_min)); fflush(stderr);   */
+                    for (x1 = x1_min + 1; x1 <= x1_max; x1++, dx++) {
+                        data_down = r->raw[y - 1][x1];
+                        m1 = r->m[data_down] + r_fact * r->rigidity_map[dx];
+                        /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1, dx, m1, MRDOWN(y, x1, dx), r->m[data_down], MDOWN(y, x1)); fflush(stderr);   */
+                        if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                            m = m1;
+                            least = x1;
+                        }
+                    }
+            }
+            /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr); */
+        } else {
+            switch (x1_max - x1_min + 1) {
+                UPDATE_MMAP_OPTIMISED_CASES
+                default:
+                    data_down = r->raw[y - 1][x1_min];
+                    least = x1_min;
+                    m = r->m[data_down];
+                    for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
+                        data_down = r->raw[y - 1][x1];
+                        m1 = r->m[data_down];
+                        if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                            m = m1;
+                            least = x1;
+                        }
+                    }
+            }
+            /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr);   */
+        }
 
-/*** internal functions for maps computations ***/
+        new_m = r->en[data] + m;
 
-/* do the carving
- * this actually carves the raw array,
- * which holds the indices to be used
- * in all the other maps */
-void
-lqr_carver_carve(LqrCarver *r)
-{
-    gint x, y;
+        if (r->least_alt) {
+            least_alt = lqr_carver_least_alt(r, y, x, x1_min, x1_max, least, m, r_fact) - x;
+        }
 
-#ifdef __LQR_DEBUG__
-    assert(r->root == NULL);
-#endif /* __LQR_DEBUG__ */
+        /* the minpath map stores relative offsets */
+        least -= x;
 
-    for (y = 0; y < r->h_start; y++) {
-#ifdef __LQR_DEBUG__
-        assert(r->vs[r->raw[y][r->vpath_x[y]]] != 0);
-        for (x = 0; x < r->vpath_x[y]; x++) {
-            assert(r->vs[r->raw[y][x]] == 0);
+        /* reduce the range if there's no (relevant) difference
+         * with the previous map (infinite values compare equal) */
+        if ((LEAST_GET(r, data) == least) && ((r->least_alt == NULL) || (LEAST_ALT_GET(r, data) == least_alt))) {
+            if ((r->m[data] == new_m) || (!LQR_MMAP_IS_EXACT(r) && (fabsf(r->m[data] - new_m) < UPDATE_TOLERANCE))) {
+                if (stop == 0) {
+                    x_stop = x;
+                }
+                stop = 1;
+                new_m = r->m[data];
+            } else {
+                stop = 0;
+                r->m[data] = new_m;
+            }
+            if ((x == x_min) && stop) {
+                x_min++;
+            }
+        } else {
+            stop = 0;
+            r->m[data] = new_m;
         }
-#endif /* __LQR_DEBUG__ */
-        for (x = r->vpath_x[y]; x < r->w; x++) {
-            r->raw[y][x] = r->raw[y][x + 1];
-#ifdef __LQR_DEBUG__
-            assert(r->vs[r->raw[y][x]] == 0);
-#endif /* __LQR_DEBUG__ */
+
+        LEAST_SET(r, data, least);
+        if (r->least_alt) {
+            LEAST_ALT_SET(r, data, least_alt);
+        }
+
+        if ((x == x_max) && (stop)) {
+            x_max = x_stop;
         }
     }
 
-    r->nrg_uptodate = FALSE;
+    *x_min_p = x_min;
+    *x_max_p = x_max;
+
+    return span;
 }
 
-/* update energy map after seam removal */
+/* carve the seam and update the energy and minpath maps
+ * in a single sweep over the rows, instead of one sweep each:
+ * after row y has been carved, the energy of row y - radius
+ * (whose neighbourhood is now complete) is updated, followed
+ * by its minpath. The result is the same as calling carve(),
+ * update_emap() and update_mmap() in a row */
 LqrRetVal
-lqr_carver_update_emap(LqrCarver *r)
+lqr_carver_update_seam(LqrCarver *r)
 {
-    gint x, y;
-    gint y1, y1_min, y1_max;
+    gint x, y, y1;
+    gint radius;
+    gboolean is_static;
+    gint x_min = 0, x_max = -1;
+    gfloat *mc = NULL;
+    LqrMinWindow mw_storage;
+    LqrMinWindow *mw;
+    guint64 carve_points = 0;
+    guint64 nrg_points = 0;
+    guint64 span = 0;
+    gdouble t0, t1, t2, t3;
+    gdouble carve_time = 0;
+    gdouble nrg_time = 0;
+    gdouble mmap_time = 0;
+
+#ifdef __LQR_DEBUG__
+    assert(r->root == NULL);
+#endif /* __LQR_DEBUG__ */
 
     LQR_CATCH_CANC(r);
 
-    if (r->nrg_uptodate) {
-        return LQR_OK;
-    }
-    if (r->use_rcache) {
+    /* see update_emap() */
+    is_static = LQR_NRG_IS_STATIC(r);
+    radius = is_static ? 0 : r->nrg_radius;
+
+    if (r->use_rcache && !is_static) {
         LQR_CATCH_F(r->rcache != NULL);
     }
 
-    for (y = 0; y < r->h; y++) {
-        /* note: here the vpath has already
-         * been carved */
-        x = r->vpath_x[y];
-        r->nrg_xmin[y] = x;
-        r->nrg_xmax[y] = x - 1;
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "update_seam", -1);
+
+    if (r->rigidity) {
+        LQR_TRACE_CATCH_MEM(r, mc = g_try_new(gfloat, 2 * r->delta_x + 1));
+        mc += r->delta_x;
     }
-    for (y = 0; y < r->h; y++) {
-        x = r->vpath_x[y];
-        y1_min = MAX(y - r->nrg_radius, 0);
-        y1_max = MIN(y + r->nrg_radius, r->h - 1);
+    LQR_TRACE_CATCH(r, lqr_carver_min_window_init(r, &mw, &mw_storage));
 
-        for (y1 = y1_min; y1 <= y1_max; y1++) {
-            r->nrg_xmin[y1] = MIN(r->nrg_xmin[y1], x - r->nrg_radius);
-            r->nrg_xmin[y1] = MAX(0, r->nrg_xmin[y1]);
-            /* note: the -1 below is because of the previous carving */
-            r->nrg_xmax[y1] = MAX(r->nrg_xmax[y1], x + r->nrg_radius - 1);
-            r->nrg_xmax[y1] = MIN(r->w - 1, r->nrg_xmax[y1]);
+    for (y = 0; y < r->h + radius; y++) {
+        LQR_TRACE_CATCH_CANC_ROW(r, y);
+
+        /* the time of each step is accounted to its own phase */
+        t1 = lqr_carver_stats_start(r);
+        if (y < r->h) {
+            carve_points += lqr_carver_carve_row(r, y);
         }
-    }
+        t2 = lqr_carver_stats_start(r);
+        carve_time += t2 - t1;
 
-    for (y = 0; y < r->h; y++) {
-        LQR_CATCH_CANC(r);
+        y1 = y - radius;
+        if (y1 < 0) {
+            continue;
+        }
 
-        for (x = r->nrg_xmin[y]; x <= r->nrg_xmax[y]; x++) {
-            LQR_CATCH(lqr_carver_compute_e(r, x, y));
+        lqr_carver_update_emap_range(r, y1, radius);
+        if (!is_static) {
+            for (x = r->nrg_xmin[y1]; x <= r->nrg_xmax[y1]; x++) {
+                LQR_TRACE_CATCH(r, lqr_carver_compute_e(r, x, y1));
+            }
+            nrg_points += MAX(r->nrg_xmax[y1] - r->nrg_xmin[y1] + 1, 0);
         }
+        t3 = lqr_carver_stats_start(r);
+        nrg_time += t3 - t2;
+
+        span += lqr_carver_update_mmap_row(r, y1, &x_min, &x_max, mc, mw);
+        mmap_time += lqr_carver_stats_start(r) - t3;
+    }
+
+    if (r->rigidity) {
+        mc -= r->delta_x;
+        g_free(mc);
     }
 
     r->nrg_uptodate = TRUE;
 
+    if (r->collect_stats) {
+        r->stats_mmap_rows += r->h;
+    }
+    lqr_carver_stats_add(r, &r->stats.carve, carve_time, carve_points);
+    lqr_carver_stats_add(r, &r->stats.update_emap, nrg_time, nrg_points);
+    lqr_carver_stats_add(r, &r->stats.update_mmap, mmap_time, span);
+    lqr_carver_trace_end(r, "update_seam", -1);
+    lqr_carver_stats_stop(r, &r->stats.update_seam, t0, 0);
+
     return LQR_OK;
 }
 
-/* update the auxiliary minpath map
- * this only updates the affected pixels,
- * which start form the beginning of the changed
- * energy region around the seam and expand
- * at most by delta_x (in both directions)
- * at each row */
+/* recompute the minpath map after the energy or the rigidity mask have
+ * changed inside the rectangle x0..x1, y0..y1 (carver coordinates).
+ * The affected region expands by delta_x at each row below the changed
+ * points, and is trimmed to the points which actually changed, as in
+ * update_mmap(); no tolerance is used here, so that the result is the
+ * same that build_mmap() would give */
 LqrRetVal
-lqr_carver_update_mmap(LqrCarver *r)
+lqr_carver_update_mmap_rect(LqrCarver *r, gint x0, gint y0, gint x1, gint y1)
 {
     gint x, y;
     gint x_min, x_max;
-    gint x1, dx;
-    gint x1_min, x1_max;
-    gint data, data_down, least;
+    gint ch_min, ch_max;
+    gint x1_min, x1_max, dx;
+    gint data, data_down;
+    gint least, least_alt;
     gfloat m, m1, r_fact;
-    gfloat new_m;
-    gfloat *mc = NULL;
-    gint stop;
-    gint x_stop;
+    guint64 points = 0;
+    gdouble t0;
 
     LQR_CATCH_CANC(r);
-    LQR_CATCH_F(r->nrg_uptodate);
-
-    if (r->rigidity) {
-        LQR_CATCH_MEM(mc = g_try_new(gfloat, 2 * r->delta_x + 1));
-        mc += r->delta_x;
-    }
-
-    /* span first row */
-    /* x_min = MAX (r->vpath_x[0] - r->delta_x, 0); */
-    x_min = MAX(r->nrg_xmin[0], 0);
-    /* x_max = MIN (r->vpath_x[0] + r->delta_x - 1, r->w - 1); */
-    /* x_max = MIN (r->vpath_x[0] + r->delta_x, r->w - 1); */
-    x_max = MIN(r->nrg_xmax[0], r->w - 1);
 
-    for (x = x_min; x <= x_max; x++) {
-        data = r->raw[0][x];
-        r->m[data] = r->en[data];
+    x0 = MAX(x0, 0);
+    y0 = MAX(y0, 0);
+    x1 = MIN(x1, r->w - 1);
+    y1 = MIN(y1, r->h - 1);
+    if (x0 > x1 || y0 > y1) {
+        return LQR_OK;
     }
 
-    /* other rows */
-    for (y = 1; y < r->h; y++) {
-        LQR_CATCH_CANC(r);
-
-        /* make sure to include the changed energy region */
-        x_min = MIN(x_min, r->nrg_xmin[y]);
-        x_max = MAX(x_max, r->nrg_xmax[y]);
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "update_mmap_rect", -1);
 
-        /* expand the affected region by delta_x */
-        x_min = MAX(x_min - r->delta_x, 0);
-        x_max = MIN(x_max + r->delta_x, r->w - 1);
+    x_min = x0;
+    x_max = x1;
+    for (y = y0; y < r->h; y++) {
+        LQR_TRACE_CATCH_CANC_ROW(r, y);
 
-        /* span the affected region */
-        stop = 0;
-        x_stop = 0;
+        ch_min = r->w;
+        ch_max = -1;
         for (x = x_min; x <= x_max; x++) {
             data = r->raw[y][x];
-            if (r->rigidity_mask) {
-                r_fact = r->rigidity_mask[data];
-            } else {
-                r_fact = 1;
-            }
-
-            /* find the minimum in the previous rows
-             * as in build_mmap() */
-            x1_min = MAX(0, x - r->delta_x);
-            x1_max = MIN(r->w - 1, x + r->delta_x);
-
-            if (r->rigidity) {
-                dx = x1_min - x;
-                switch (x1_max - x1_min + 1) {
-                    UPDATE_MMAP_OPTIMISED_CASES_RIG
-                    default:
-                        data_down = r->raw[y - 1][x1_min];
-                        least = data_down;
-                        m = r->m[data_down] + r_fact * r->rigidity_map[dx++];
-                        /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1_min, dx, m, MRDOWN(y, x1_min, dx), r->m[data_down], MDOWN(y, x1_min)); fflush(stderr);   */
-                        for (x1 = x1_min + 1; x1 <= x1_max; x1++, dx++) {
-                            data_down = r->raw[y - 1][x1];
-                            m1 = r->m[data_down] + r_fact * r->rigidity_map[dx];
-                            /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1, dx, m1, MRDOWN(y, x1, dx), r->m[data_down], MDOWN(y, x1)); fflush(stderr);   */
-                            if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
-                                m = m1;
-                                least = data_down;
-                            }
-                        }
-                }
-                /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr); */
+            least = LEAST_GET(r, data);
+            least_alt = r->least_alt ? LEAST_ALT_GET(r, data) : 0;
+            if (y == 0) {
+                m = r->en[data];
             } else {
-                switch (x1_max - x1_min + 1) {
-                    UPDATE_MMAP_OPTIMISED_CASES
-                    default:
-                        data_down = r->raw[y - 1][x1_min];
-                        least = data_down;
-                        m = r->m[data_down];
-                        for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
-                            data_down = r->raw[y - 1][x1];
-                            m1 = r->m[data_down];
-                            if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
-                                m = m1;
-                                least = data_down;
-                            }
-                        }
+                if (r->rigidity_mask) {
+                    r_fact = r->rigidity_mask[data];
+                } else {
+                    r_fact = 1;
                 }
-                /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr);   */
-            }
-
-            new_m = r->en[data] + m;
 
-            /* reduce the range if there's no (relevant) difference
-             * with the previous map */
-            if (r->least[data] == least) {
-                if (fabsf(r->m[data] - new_m) < UPDATE_TOLERANCE) {
-                    if (stop == 0) {
-                        x_stop = x;
+                /* find the minimum in the previous row
+                 * as in build_mmap() */
+                x1_min = MAX(-x, -r->delta_x);
+                x1_max = MIN(r->w - 1 - x, r->delta_x);
+
+                data_down = r->raw[y - 1][x + x1_min];
+                least = x1_min;
+                if (r->rigidity) {
+                    m = r->m[data_down] + r_fact * r->rigidity_map[x1_min];
+                    for (dx = x1_min + 1; dx <= x1_max; dx++) {
+                        data_down = r->raw[y - 1][x + dx];
+                        m1 = r->m[data_down] + r_fact * r->rigidity_map[dx];
+                        if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                            m = m1;
+                            least = dx;
+                        }
                     }
-                    stop = 1;
-                    new_m = r->m[data];
                 } else {
-                    stop = 0;
-                    r->m[data] = new_m;
+                    m = r->m[data_down];
+                    for (dx = x1_min + 1; dx <= x1_max; dx++) {
+                        data_down = r->raw[y - 1][x + dx];
+                        m1 = r->m[data_down];
+                        if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                            m = m1;
+                            least = dx;
+                        }
+                    }
                 }
-                if ((x == x_min) && stop) {
-                    x_min++;
+                if (r->least_alt) {
+                    least_alt = lqr_carver_least_alt(r, y, x, x + x1_min, x + x1_max, x + least, m, r_fact) - x;
                 }
-            } else {
-                stop = 0;
-                r->m[data] = new_m;
+                m = r->en[data] + m;
             }
 
-            r->least[data] = least;
-
-            if ((x == x_max) && (stop)) {
-                x_max = x_stop;
+            if ((m != r->m[data]) || (least != LEAST_GET(r, data)) ||
+                ((r->least_alt != NULL) && (least_alt != LEAST_ALT_GET(r, data)))) {
+                r->m[data] = m;
+                LEAST_SET(r, data, least);
+                if (r->least_alt) {
+                    LEAST_ALT_SET(r, data, least_alt);
+                }
+                ch_min = MIN(ch_min, x);
+                ch_max = MAX(ch_max, x);
             }
         }
+        points += x_max - x_min + 1;
 
+        /* next row: the points which can reach the changed
+         * ones, plus the rest of the rectangle */
+        if (ch_min <= ch_max) {
+            x_min = MAX(ch_min - r->delta_x, 0);
+            x_max = MIN(ch_max + r->delta_x, r->w - 1);
+        } else {
+            x_min = r->w;
+            x_max = -1;
+        }
+        if (y < y1) {
+            x_min = MIN(x_min, x0);
+            x_max = MAX(x_max, x1);
+        } else if (x_min > x_max) {
+            break;
+        }
     }
 
-    if (r->rigidity) {
-        mc -= r->delta_x;
-        g_free(mc);
-    }
+    lqr_carver_trace_end(r, "update_mmap_rect", -1);
+    lqr_carver_stats_stop(r, &r->stats.build_mmap, t0, points);
 
     return LQR_OK;
 }
@@ -1265,16 +3580,23 @@ lqr_carver_build_vpath(LqrCarver *r)
     gfloat m, m1;
     gint last = -1;
     gint last_x = 0;
-    gint x_min, x_max;
+    gint least;
+    gdouble t0;
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "build_vpath", -1);
 
     /* we start at last row */
     y = r->h - 1;
 
-    /* span the last row for the minimum mmap value */
-    m = (1 << 29);
-    for (x = 0, z0 = y * r->w_start; x < r->w; x++, z0++) {
+    /* span the last row for the minimum mmap value
+     * (starting from the first point, since the values may be
+     * arbitrarily large, up to infinite ones, see the strip carver) */
+    last = r->raw[y][0];
+    m = r->m[last];
+    for (x = 1, z0 = y * r->w_start + 1; x < r->w; x++, z0++) {
 #ifdef __LQR_DEBUG__
-        assert(r->vs[r->raw[y][x]] == 0);
+        assert(VS_GET(r, r->raw[y][x]) == 0);
 #endif /* __LQR_DEBUG__ */
 
         m1 = r->m[r->raw[y][x]];
@@ -1292,33 +3614,35 @@ lqr_carver_build_vpath(LqrCarver *r)
     /* follow the track for the other rows */
     for (y = r->h0 - 1; y >= 0; y--) {
 #ifdef __LQR_DEBUG__
-        assert(r->vs[last] == 0);
+        assert(VS_GET(r, last) == 0);
         assert(last_x < r->w);
 #endif /* __LQR_DEBUG__ */
         r->vpath[y] = last;
         r->vpath_x[y] = last_x;
         if (y > 0) {
-            last = r->least[r->raw[y][last_x]];
-            /* we also need to retrieve the x coordinate */
-            x_min = MAX(last_x - r->delta_x, 0);
-            x_max = MIN(last_x + r->delta_x, r->w - 1);
-            for (x = x_min; x <= x_max; x++) {
-                if (r->raw[y - 1][x] == last) {
-                    last_x = x;
-                    break;
-                }
-            }
+            least = LEAST_GET(r, r->raw[y][last_x]);
 #ifdef __LQR_DEBUG__
-            assert(x < x_max + 1);
+            assert(least != LEAST_NONE(r));
+            assert((last_x + least >= 0) && (last_x + least < r->w));
 #endif /* __LQR_DEBUG__ */
+            if ((least == LEAST_NONE(r)) || (last_x + least < 0) || (last_x + least >= r->w)) {
+                /* stale link (never expected): don't follow it */
+                last_x = lqr_carver_least_scan(r, y, last_x);
+            } else {
+                last_x += least;
+            }
+            last = r->raw[y - 1][last_x];
         }
     }
 
+    lqr_carver_trace_end(r, "build_vpath", -1);
+    lqr_carver_stats_stop(r, &r->stats.build_vpath, t0, (guint64) r->w + r->h0);
+
 #if 0
     /* we backtrack the seam following the min mmap */
     for (y = r->h0 - 1; y >= 0; y--) {
 #ifdef __LQR_DEBUG__
-        assert(r->vs[last] == 0);
+        assert(VS_GET(r, last) == 0);
         assert(last_x < r->w);
 #endif /* __LQR_DEBUG__ */
 
@@ -1351,10 +3675,10 @@ lqr_carver_update_vsmap(LqrCarver *r, gint l)
 #endif /* __LQR_DEBUG__ */
     for (y = 0; y < r->h; y++) {
 #ifdef __LQR_DEBUG__
-        assert(r->vs[r->vpath[y]] == 0);
+        assert(VS_GET(r, r->vpath[y]) == 0);
         assert(r->vpath[y] == r->raw[y][r->vpath_x[y]]);
 #endif /* __LQR_DEBUG__ */
-        r->vs[r->vpath[y]] = l;
+        VS_SET(r, r->vpath[y], l);
     }
 }
 
@@ -1372,9 +3696,9 @@ lqr_carver_finish_vsmap(LqrCarver *r)
     lqr_cursor_reset(r->c);
     for (y = 1; y <= r->h; y++, lqr_cursor_next(r->c)) {
 #ifdef __LQR_DEBUG__
-        assert(r->vs[r->c->now] == 0);
+        assert(VS_GET(r, r->c->now) == 0);
 #endif /* __LQR_DEBUG__ */
-        r->vs[r->c->now] = r->w0;
+        VS_SET(r, r->c->now, r->w0);
     }
     lqr_cursor_reset(r->c);
 }
@@ -1398,11 +3722,183 @@ lqr_carver_propagate_vsmap_attached(LqrCarver *r, LqrDataTok data)
     /* LqrDataTok data_tok;
     data_tok.data = NULL; */
     r->vs = r->root->vs;
+    r->vs_compact = r->root->vs_compact;
     lqr_carver_scan_reset(r);
     /* LQR_CATCH (lqr_carver_list_foreach (r->attached_list,  lqr_carver_propagate_vsmap_attached, data_tok)); */
     return LQR_OK;
 }
 
+/*** incremental edits ***/
+
+/* save the maps of the base image
+ * (to be called right after they have been built) */
+LqrRetVal
+lqr_carver_base_maps_save(LqrCarver *r)
+{
+    gsize size = (gsize) r->w0 * r->h0;
+
+    if (r->base_en == NULL) {
+        LQR_CATCH_MEM(r->base_en = LQR_SCRATCH_TRY_NEW(r, gfloat, size));
+        LQR_CATCH_MEM(r->base_m = LQR_SCRATCH_TRY_NEW(r, gfloat, size));
+        LQR_CATCH_MEM(r->base_least = LEAST_TRY_NEW(r, size));
+    }
+
+    memcpy(r->base_en, r->en, size * sizeof(gfloat));
+    memcpy(r->base_m, r->m, size * sizeof(gfloat));
+    memcpy(r->base_least, r->least, size * LEAST_SIZEOF(r->least_compact));
+    r->base_leftright = r->leftright;
+    r->base_nrg_quant_scale = r->nrg_quant_scale;
+    r->base_nrg_quant_max = r->nrg_quant_max;
+
+    return LQR_OK;
+}
+
+void
+lqr_carver_base_maps_free(LqrCarver *r)
+{
+    lqr_carver_scratch_free(r, r->base_en);
+    lqr_carver_scratch_free(r, r->base_m);
+    lqr_carver_scratch_free(r, r->base_least);
+    r->base_en = NULL;
+    r->base_m = NULL;
+    r->base_least = NULL;
+    r->mmap_uptodate = FALSE;
+    lqr_carver_edit_clear(r);
+}
+
+/* go back to the base image and restore its maps */
+LqrRetVal
+lqr_carver_rewind(LqrCarver *r)
+{
+    LqrDataTok data_tok;
+    gint size;
+
+    LQR_CATCH_F(r->base_en != NULL);
+
+    if (r->mmap_uptodate) {
+        return LQR_OK;
+    }
+
+    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->max_level > 1)) {
+        /* the base image is the visible one at the start width */
+        lqr_carver_set_width(r, r->w_start);
+        data_tok.integer = r->w_start;
+        LQR_CATCH(lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_set_width_attached, data_tok));
+        LQR_CATCH(lqr_carver_flatten(r));
+    }
+
+    /* flattening at the start width keeps the base maps */
+    LQR_CATCH_F(r->base_en != NULL);
+
+    size = r->w0 * r->h0;
+    memcpy(r->en, r->base_en, size * sizeof(gfloat));
+    memcpy(r->m, r->base_m, size * sizeof(gfloat));
+    memcpy(r->least, r->base_least, size * LEAST_SIZEOF(r->least_compact));
+    r->leftright = r->base_leftright;
+    r->nrg_quant_scale = r->base_nrg_quant_scale;
+    r->nrg_quant_max = r->base_nrg_quant_max;
+    /* the offsets for the other side are not saved */
+    lqr_carver_scratch_free(r, r->least_alt);
+    r->least_alt = NULL;
+
+    r->nrg_uptodate = TRUE;
+    r->mmap_uptodate = TRUE;
+
+    return LQR_OK;
+}
+
+/* prepare the carver for a bias or rigidity mask edit:
+ * either go back to the base image or flatten the current one */
+LqrRetVal
+lqr_carver_edit_begin(LqrCarver *r)
+{
+    if (r->incremental_edits && r->base_en != NULL) {
+        LQR_CATCH(lqr_carver_rewind(r));
+    } else if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
+        LQR_CATCH(lqr_carver_flatten(r));
+    }
+
+    return LQR_OK;
+}
+
+/* record an edit of the rectangle x0..x1, y0..y1 (in the carver
+ * orientation); nrg tells whether the energy is affected (bias) or
+ * only the minpath map is (rigidity mask) */
+void
+lqr_carver_edit_mark(LqrCarver *r, gint x0, gint y0, gint x1, gint y1, gboolean nrg)
+{
+    if ((x1 < x0) || (y1 < y0)) {
+        return;
+    }
+
+    /* with quantized energy, a bias edit may change the
+     * quantization levels, hence the whole map is rebuilt */
+    if (!r->mmap_uptodate || (nrg && (r->nrg_quant_scale > 0))) {
+        if (nrg) {
+            r->nrg_uptodate = FALSE;
+        }
+        return;
+    }
+
+    if (r->dirty_x0 > r->dirty_x1) {
+        r->dirty_x0 = x0;
+        r->dirty_y0 = y0;
+        r->dirty_x1 = x1;
+        r->dirty_y1 = y1;
+    } else {
+        r->dirty_x0 = MIN(r->dirty_x0, x0);
+        r->dirty_y0 = MIN(r->dirty_y0, y0);
+        r->dirty_x1 = MAX(r->dirty_x1, x1);
+        r->dirty_y1 = MAX(r->dirty_y1, y1);
+    }
+    r->dirty_nrg = r->dirty_nrg || nrg;
+}
+
+void
+lqr_carver_edit_clear(LqrCarver *r)
+{
+    r->dirty_nrg = FALSE;
+    r->dirty_x0 = 0;
+    r->dirty_y0 = 0;
+    r->dirty_x1 = -1;
+    r->dirty_y1 = -1;
+}
+
+/* bring the restored base maps up to date with the edits */
+LqrRetVal
+lqr_carver_update_dirty(LqrCarver *r)
+{
+    gint x, y;
+    gdouble t0;
+
+    LQR_CATCH_F(r->mmap_uptodate);
+
+    /* needed by the seams updates anyway */
+    LQR_CATCH(lqr_carver_build_rcache(r));
+
+    if (r->dirty_x0 <= r->dirty_x1) {
+        if (r->dirty_nrg) {
+            /* the bias only enters the energy of its own point */
+            t0 = lqr_carver_stats_start(r);
+            lqr_carver_trace_begin(r, "update_emap_rect", -1);
+            for (y = MAX(r->dirty_y0, 0); y <= MIN(r->dirty_y1, r->h - 1); y++) {
+                LQR_TRACE_CATCH_CANC_ROW(r, y);
+                for (x = MAX(r->dirty_x0, 0); x <= MIN(r->dirty_x1, r->w - 1); x++) {
+                    LQR_TRACE_CATCH(r, lqr_carver_compute_e(r, x, y));
+                }
+            }
+            lqr_carver_trace_end(r, "update_emap_rect", -1);
+            lqr_carver_stats_stop(r, &r->stats.build_emap, t0,
+                                  (guint64) (r->dirty_x1 - r->dirty_x0 + 1) * (r->dirty_y1 - r->dirty_y0 + 1));
+        }
+        LQR_CATCH(lqr_carver_update_mmap_rect(r, r->dirty_x0, r->dirty_y0, r->dirty_x1, r->dirty_y1));
+    }
+
+    lqr_carver_edit_clear(r);
+
+    return LQR_OK;
+}
+
 /*** image manipulations ***/
 
 /* set width of the multisize image
@@ -1425,6 +3921,13 @@ lqr_carver_set_width_attached(LqrCarver *r, LqrDataTok data)
     return LQR_OK;
 }
 
+LqrRetVal
+lqr_carver_set_max_level_attached(LqrCarver *r, LqrDataTok data)
+{
+    r->max_level = data.integer;
+    return LQR_OK;
+}
+
 /* flatten the image to its current state
  * (all maps are reset, invisible points are lost) */
 /* LQR_PUBLIC */
@@ -1433,11 +3936,15 @@ lqr_carver_flatten(LqrCarver *r)
 {
     void *new_rgb = NULL;
     gfloat *new_bias = NULL;
+    gfloat *new_nrg_buffer = NULL;
     gfloat *new_rigmask = NULL;
     gint x, y, k;
-    gint z0;
+    gint x1, run;
+    gsize z0, z1;
+    gsize pxl_size;
     LqrDataTok data_tok;
     LqrCarverState prev_state = LQR_CARVER_STATE_STD;
+    gdouble t0;
 
 #ifdef __LQR_VERBOSE__
     printf("    [ flattening (active=%i) ]\n", r->active);
@@ -1453,91 +3960,132 @@ lqr_carver_flatten(LqrCarver *r)
 
     /* first iterate on attached carvers */
     data_tok.data = NULL;
-    LQR_CATCH(lqr_carver_list_foreach(r->attached_list, lqr_carver_flatten_attached, data_tok));
-
-    /* free non needed maps first */
-    g_free(r->en);
-    g_free(r->m);
-    g_free(r->rcache);
-    g_free(r->least);
+    LQR_CATCH(lqr_carver_list_foreach_parallel(r->attached_list, lqr_carver_flatten_attached, data_tok));
+
+    /* then on passive layers */
+    LQR_CATCH(lqr_layer_list_flatten(r->layers));
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "flatten", -1);
+
+    /* free non needed maps first
+     * (flattening at the start width gives back the base image,
+     * so the base maps are still valid in that case) */
+    lqr_carver_scratch_free(r, r->en);
+    lqr_carver_scratch_free(r, r->m);
+    lqr_carver_scratch_free(r, r->rcache);
+    lqr_carver_scratch_free(r, r->least);
+    lqr_carver_scratch_free(r, r->least_alt);
+    r->least_alt = NULL;
+    if (r->w != r->w_start) {
+        lqr_carver_base_maps_free(r);
+    }
 
     r->rcache = NULL;
     r->nrg_uptodate = FALSE;
+    r->mmap_uptodate = FALSE;
 
     /* allocate room for new map */
-    BUF_TRY_NEW0_RET_LQR(new_rgb, r->w * r->h * r->channels, r->col_depth);
+    BUF_SCRATCH_TRY_NEW0_RET_LQR(r, new_rgb, (gsize) r->w * r->h * r->channels, r->col_depth);
 
     if (r->active) {
         if (r->rigidity_mask) {
-            LQR_CATCH_MEM(new_rigmask = g_try_new(gfloat, r->w * r->h));
+            LQR_TRACE_CATCH_MEM(r, new_rigmask = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) r->w * r->h));
         }
     }
     if (r->nrg_active) {
         if (r->bias) {
-            LQR_CATCH_MEM(new_bias = g_try_new0(gfloat, r->w * r->h));
+            LQR_TRACE_CATCH_MEM(r, new_bias = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w * r->h));
         }
-        g_free(r->_raw);
+        if (r->nrg_buffer) {
+            LQR_TRACE_CATCH_MEM(r, new_nrg_buffer = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) r->w * r->h));
+        }
+        lqr_carver_scratch_free(r, r->_raw);
         g_free(r->raw);
-        LQR_CATCH_MEM(r->_raw = g_try_new(gint, r->w * r->h));
-        LQR_CATCH_MEM(r->raw = g_try_new(gint *, r->h));
+        LQR_TRACE_CATCH_MEM(r, r->_raw = LQR_SCRATCH_TRY_NEW(r, gint, (gsize) r->w * r->h));
+        LQR_TRACE_CATCH_MEM(r, r->raw = g_try_new(gint *, r->h));
     }
 
-    /* span the image with the cursor and copy
-     * it in the new array  */
-    lqr_cursor_reset(r->c);
+    /* copy the visible points row by row (each row of the map holds
+     * exactly w of them), in runs between the invisible ones */
+    pxl_size = LQR_SAMPLE_SIZE(r->col_depth) * r->channels;
     for (y = 0; y < r->h; y++) {
-        LQR_CATCH_CANC(r);
+        LQR_TRACE_CATCH_CANC_ROW(r, y);
 
         if (r->nrg_active) {
             r->raw[y] = r->_raw + y * r->w;
         }
-        for (x = 0; x < r->w; x++) {
-            z0 = y * r->w + x;
-            for (k = 0; k < r->channels; k++) {
-                PXL_COPY(new_rgb, z0 * r->channels + k, r->rgb, r->c->now * r->channels + k, r->col_depth);
+        z1 = (gsize) y * r->w0;
+        z0 = (gsize) y * r->w;
+        x = 0;
+        x1 = 0;
+        while (x1 < r->w0) {
+            while ((x1 < r->w0) && VS_HIDDEN(r, z1 + x1)) {
+                x1++;
             }
+            run = 0;
+            while ((x1 + run < r->w0) && !VS_HIDDEN(r, z1 + x1 + run)) {
+                run++;
+            }
+            if (run == 0) {
+                break;
+            }
+            memcpy((guchar *) new_rgb + (z0 + x) * pxl_size, (guchar *) r->rgb + (z1 + x1) * pxl_size,
+                   run * pxl_size);
             if (r->active) {
                 if (r->rigidity_mask) {
-                    new_rigmask[z0] = r->rigidity_mask[r->c->now];
+                    memcpy(new_rigmask + z0 + x, r->rigidity_mask + z1 + x1, run * sizeof(gfloat));
                 }
             }
             if (r->nrg_active) {
                 if (r->bias) {
-                    new_bias[z0] = r->bias[r->c->now];
+                    memcpy(new_bias + z0 + x, r->bias + z1 + x1, run * sizeof(gfloat));
+                }
+                if (r->nrg_buffer) {
+                    memcpy(new_nrg_buffer + z0 + x, r->nrg_buffer + z1 + x1, run * sizeof(gfloat));
+                }
+                for (k = 0; k < run; k++) {
+                    r->raw[y][x + k] = z0 + x + k;
                 }
-                r->raw[y][x] = z0;
             }
-            lqr_cursor_next(r->c);
+            x += run;
+            x1 += run;
         }
+#ifdef __LQR_DEBUG__
+        assert(x == r->w);
+#endif /* __LQR_DEBUG__ */
     }
 
     /* substitute the old maps */
     if (!r->preserve_in_buffer) {
-        g_free(r->rgb);
+        lqr_carver_scratch_free(r, r->rgb);
     }
     r->rgb = new_rgb;
     r->preserve_in_buffer = FALSE;
     if (r->nrg_active) {
-        g_free(r->bias);
+        lqr_carver_scratch_free(r, r->bias);
         r->bias = new_bias;
+        lqr_carver_scratch_free(r, r->nrg_buffer);
+        r->nrg_buffer = new_nrg_buffer;
     }
     if (r->active) {
-        g_free(r->rigidity_mask);
+        lqr_carver_scratch_free(r, r->rigidity_mask);
         r->rigidity_mask = new_rigmask;
     }
 
     /* init the other maps */
     if (r->root == NULL) {
-        g_free(r->vs);
-        LQR_CATCH_MEM(r->vs = g_try_new0(gint, r->w * r->h));
-        LQR_CATCH(lqr_carver_propagate_vsmap(r));
+        lqr_carver_scratch_free(r, r->vs);
+        r->vs_compact = VS_USE_COMPACT(r->w);
+        LQR_TRACE_CATCH_MEM(r, r->vs = VS_TRY_NEW0(r, r->vs_compact, (gsize) r->w * r->h));
+        LQR_TRACE_CATCH(r, lqr_carver_propagate_vsmap(r));
     }
     if (r->nrg_active) {
-        LQR_CATCH_MEM(r->en = g_try_new0(gfloat, r->w * r->h));
+        LQR_TRACE_CATCH_MEM(r, r->en = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w * r->h));
     }
     if (r->active) {
-        LQR_CATCH_MEM(r->m = g_try_new0(gfloat, r->w * r->h));
-        LQR_CATCH_MEM(r->least = g_try_new(gint, r->w * r->h));
+        LQR_TRACE_CATCH_MEM(r, r->m = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w * r->h));
+        LQR_TRACE_CATCH_MEM(r, r->least = LEAST_TRY_NEW(r, (gsize) r->w * r->h));
     }
 
     /* reset widths, heights & levels */
@@ -1553,6 +4101,9 @@ lqr_carver_flatten(LqrCarver *r)
     fflush(stdout);
 #endif /* __LQR_VERBOSE__ */
 
+    lqr_carver_trace_end(r, "flatten", -1);
+    lqr_carver_stats_stop(r, &r->stats.flatten, t0, (guint64) r->w0 * r->h0);
+
     if (r->root == NULL) {
         LQR_CATCH(lqr_carver_set_state(r, prev_state, TRUE));
     }
@@ -1576,9 +4127,11 @@ lqr_carver_transpose(LqrCarver *r)
     gint d;
     void *new_rgb = NULL;
     gfloat *new_bias = NULL;
+    gfloat *new_nrg_buffer = NULL;
     gfloat *new_rigmask = NULL;
     LqrDataTok data_tok;
     LqrCarverState prev_state = LQR_CARVER_STATE_STD;
+    gdouble t0;
 
 #ifdef __LQR_VERBOSE__
     printf("[ transposing (active=%i) ]\n", r->active);
@@ -1598,37 +4151,49 @@ lqr_carver_transpose(LqrCarver *r)
 
     /* first iterate on attached carvers */
     data_tok.data = NULL;
-    LQR_CATCH(lqr_carver_list_foreach(r->attached_list, lqr_carver_transpose_attached, data_tok));
+    LQR_CATCH(lqr_carver_list_foreach_parallel(r->attached_list, lqr_carver_transpose_attached, data_tok));
+
+    /* then on passive layers */
+    LQR_CATCH(lqr_layer_list_transpose(r->layers));
+
+    t0 = lqr_carver_stats_start(r);
+    lqr_carver_trace_begin(r, "transpose", -1);
 
     /* free non needed maps first */
     if (r->root == NULL) {
-        g_free(r->vs);
+        lqr_carver_scratch_free(r, r->vs);
     }
-    g_free(r->en);
-    g_free(r->m);
-    g_free(r->rcache);
-    g_free(r->least);
+    lqr_carver_scratch_free(r, r->en);
+    lqr_carver_scratch_free(r, r->m);
+    lqr_carver_scratch_free(r, r->rcache);
+    lqr_carver_scratch_free(r, r->least);
+    lqr_carver_scratch_free(r, r->least_alt);
+    r->least_alt = NULL;
     g_free(r->rgb_ro_buffer);
+    lqr_carver_base_maps_free(r);
 
     r->rcache = NULL;
     r->nrg_uptodate = FALSE;
 
     /* allocate room for the new maps */
-    BUF_TRY_NEW0_RET_LQR(new_rgb, r->w0 * r->h0 * r->channels, r->col_depth);
+    BUF_SCRATCH_TRY_NEW0_RET_LQR(r, new_rgb, (gsize) r->w0 * r->h0 * r->channels, r->col_depth);
 
     if (r->active) {
         if (r->rigidity_mask) {
-            LQR_CATCH_MEM(new_rigmask = g_try_new(gfloat, r->w0 * r->h0));
+            LQR_TRACE_CATCH_MEM(r, new_rigmask = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) r->w0 * r->h0));
         }
     }
     if (r->nrg_active) {
         if (r->bias) {
-            LQR_CATCH_MEM(new_bias = g_try_new0(gfloat, r->w0 * r->h0));
+            LQR_TRACE_CATCH_MEM(r, new_bias = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w0 * r->h0));
+        }
+        if (r->nrg_buffer) {
+            LQR_TRACE_CATCH_MEM(r, new_nrg_buffer = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) r->w0 * r->h0));
         }
-        g_free(r->_raw);
+        lqr_carver_scratch_free(r, r->_raw);
         g_free(r->raw);
-        LQR_CATCH_MEM(r->_raw = g_try_new0(gint, r->h0 * r->w0));
-        LQR_CATCH_MEM(r->raw = g_try_new0(gint *, r->w0));
+        LQR_TRACE_CATCH_MEM(r, r->_raw = LQR_SCRATCH_TRY_NEW0(r, gint, (gsize) r->h0 * r->w0));
+        LQR_TRACE_CATCH_MEM(r, r->raw = g_try_new0(gint *, r->w0));
     }
 
     /* compute trasposed maps */
@@ -1640,7 +4205,7 @@ lqr_carver_transpose(LqrCarver *r)
             z0 = y * r->w0 + x;
             z1 = x * r->h0 + y;
             for (k = 0; k < r->channels; k++) {
-                PXL_COPY(new_rgb, z1 * r->channels + k, r->rgb, z0 * r->channels + k, r->col_depth);
+                PXL_COPY(new_rgb, (gsize) z1 * r->channels + k, r->rgb, (gsize) z0 * r->channels + k, r->col_depth);
             }
             if (r->active) {
                 if (r->rigidity_mask) {
@@ -1651,6 +4216,9 @@ lqr_carver_transpose(LqrCarver *r)
                 if (r->bias) {
                     new_bias[z1] = r->bias[z0];
                 }
+                if (r->nrg_buffer) {
+                    new_nrg_buffer[z1] = r->nrg_buffer[z0];
+                }
                 r->raw[x][y] = z1;
             }
         }
@@ -1658,31 +4226,35 @@ lqr_carver_transpose(LqrCarver *r)
 
     /* substitute the map */
     if (!r->preserve_in_buffer) {
-        g_free(r->rgb);
+        lqr_carver_scratch_free(r, r->rgb);
     }
     r->rgb = new_rgb;
     r->preserve_in_buffer = FALSE;
 
     if (r->nrg_active) {
-        g_free(r->bias);
+        lqr_carver_scratch_free(r, r->bias);
         r->bias = new_bias;
+        lqr_carver_scratch_free(r, r->nrg_buffer);
+        r->nrg_buffer = new_nrg_buffer;
     }
     if (r->active) {
-        g_free(r->rigidity_mask);
+        lqr_carver_scratch_free(r, r->rigidity_mask);
         r->rigidity_mask = new_rigmask;
     }
 
     /* init the other maps */
     if (r->root == NULL) {
-        LQR_CATCH_MEM(r->vs = g_try_new0(gint, r->w0 * r->h0));
-        LQR_CATCH(lqr_carver_propagate_vsmap(r));
+        /* (the map width will be h0 after the transposition) */
+        r->vs_compact = VS_USE_COMPACT(r->h0);
+        LQR_TRACE_CATCH_MEM(r, r->vs = VS_TRY_NEW0(r, r->vs_compact, (gsize) r->w0 * r->h0));
+        LQR_TRACE_CATCH(r, lqr_carver_propagate_vsmap(r));
     }
     if (r->nrg_active) {
-        LQR_CATCH_MEM(r->en = g_try_new0(gfloat, r->w0 * r->h0));
+        LQR_TRACE_CATCH_MEM(r, r->en = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w0 * r->h0));
     }
     if (r->active) {
-        LQR_CATCH_MEM(r->m = g_try_new0(gfloat, r->w0 * r->h0));
-        LQR_CATCH_MEM(r->least = g_try_new(gint, r->w0 * r->h0));
+        LQR_TRACE_CATCH_MEM(r, r->m = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w0 * r->h0));
+        LQR_TRACE_CATCH_MEM(r, r->least = LEAST_TRY_NEW(r, (gsize) r->w0 * r->h0));
     }
 
     /* switch widths & heights */
@@ -1701,13 +4273,13 @@ lqr_carver_transpose(LqrCarver *r)
     /* reset seam path, cursor and readout buffer */
     if (r->active) {
         g_free(r->vpath);
-        LQR_CATCH_MEM(r->vpath = g_try_new(gint, r->h));
+        LQR_TRACE_CATCH_MEM(r, r->vpath = g_try_new(gint, r->h));
         g_free(r->vpath_x);
-        LQR_CATCH_MEM(r->vpath_x = g_try_new(gint, r->h));
+        LQR_TRACE_CATCH_MEM(r, r->vpath_x = g_try_new(gint, r->h));
         g_free(r->nrg_xmin);
-        LQR_CATCH_MEM(r->nrg_xmin = g_try_new(gint, r->h));
+        LQR_TRACE_CATCH_MEM(r, r->nrg_xmin = g_try_new(gint, r->h));
         g_free(r->nrg_xmax);
-        LQR_CATCH_MEM(r->nrg_xmax = g_try_new(gint, r->h));
+        LQR_TRACE_CATCH_MEM(r, r->nrg_xmax = g_try_new(gint, r->h));
     }
 
     BUF_TRY_NEW0_RET_LQR(r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
@@ -1728,6 +4300,9 @@ lqr_carver_transpose(LqrCarver *r)
     fflush(stdout);
 #endif /* __LQR_VERBOSE__ */
 
+    lqr_carver_trace_end(r, "transpose", -1);
+    lqr_carver_stats_stop(r, &r->stats.transpose, t0, (guint64) r->w0 * r->h0);
+
     if (r->root == NULL) {
         LQR_CATCH(lqr_carver_set_state(r, prev_state, TRUE));
     }
@@ -1751,6 +4326,7 @@ lqr_carver_resize_width(LqrCarver *r, gint w1)
     LqrDataTok data_tok;
     gint delta, gamma;
     gint delta_max;
+    gdouble t0;
     /* delta is used to determine the required depth
      * gamma to decide if action is necessary */
     if (!r->transposed) {
@@ -1774,13 +4350,15 @@ lqr_carver_resize_width(LqrCarver *r, gint w1)
     LQR_CATCH_F(g_atomic_int_get(&r->state) == LQR_CARVER_STATE_STD);
     LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_RESIZING, TRUE));
 
+    lqr_carver_trace_begin(r, "resize_width", w1);
+
     /* update step for progress reprt */
     r->session_rescale_total = gamma > 0 ? gamma : -gamma;
     r->session_rescale_current = 0;
     r->session_update_step = (gint) MAX(r->session_rescale_total * r->progress->update_step, 1);
 
     if (r->session_rescale_total) {
-        lqr_progress_init(r->progress, r->progress->init_width_message);
+        lqr_carver_progress_init(r, r->progress->init_width_message);
     }
 
     while (gamma) {
@@ -1789,11 +4367,16 @@ lqr_carver_resize_width(LqrCarver *r, gint w1)
 
         delta -= delta0;
         if (r->transposed) {
-            LQR_CATCH(lqr_carver_transpose(r));
+            t0 = lqr_carver_deadline_start(r);
+            LQR_TRACE_CATCH(r, lqr_carver_transpose(r));
+            lqr_carver_deadline_stop(r, LQR_DEADLINE_TRANSPOSE, t0, (gdouble) r->w0 * r->h0);
         }
         new_w = MIN(w1, r->w_start + delta_max);
         gamma = w1 - new_w;
-        LQR_CATCH(lqr_carver_build_maps(r, delta0 + 1));
+        if (r->deadline) {
+            lqr_carver_deadline_plan(r, delta0 + 1, w1);
+        }
+        LQR_TRACE_CATCH(r, lqr_carver_build_maps(r, delta0 + 1));
         lqr_carver_set_width(r, new_w);
 
         data_tok.integer = new_w;
@@ -1802,10 +4385,14 @@ lqr_carver_resize_width(LqrCarver *r, gint w1)
         r->session_rescale_current = r->session_rescale_total - (gamma > 0 ? gamma : -gamma);
 
         if (r->dump_vmaps) {
-            LQR_CATCH(lqr_vmap_internal_dump(r));
+            LQR_TRACE_CATCH(r, lqr_vmap_internal_dump(r));
         }
-        if (new_w < w1) {
-            LQR_CATCH(lqr_carver_flatten(r));
+        /* (with a deadline, a reduction was not inflated: the image
+         * is flattened at its new size) */
+        if ((new_w < w1) || (r->deadline && r->deadline_flatten)) {
+            t0 = lqr_carver_deadline_start(r);
+            LQR_TRACE_CATCH(r, lqr_carver_flatten(r));
+            lqr_carver_deadline_stop(r, LQR_DEADLINE_FLATTEN, t0, (gdouble) r->w0 * r->h0);
             delta_max = (gint) ((r->enl_step - 1) * r->w_start) - 1;
             if (delta_max < 1) {
                 delta_max = 1;
@@ -1814,9 +4401,11 @@ lqr_carver_resize_width(LqrCarver *r, gint w1)
     }
 
     if (r->session_rescale_total) {
-        lqr_progress_end(r->progress, r->progress->end_width_message);
+        lqr_progress_end(r->progress, r, r->progress->end_width_message);
     }
 
+    lqr_carver_trace_end(r, "resize_width", w1);
+
     LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_STD, TRUE));
 
     return LQR_OK;
@@ -1828,6 +4417,7 @@ lqr_carver_resize_height(LqrCarver *r, gint h1)
     LqrDataTok data_tok;
     gint delta, gamma;
     gint delta_max;
+    gdouble t0;
     /* delta is used to determine the required depth
      * gamma to decide if action is necessary */
     if (!r->transposed) {
@@ -1851,13 +4441,15 @@ lqr_carver_resize_height(LqrCarver *r, gint h1)
     LQR_CATCH_F(g_atomic_int_get(&r->state) == LQR_CARVER_STATE_STD);
     LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_RESIZING, TRUE));
 
+    lqr_carver_trace_begin(r, "resize_height", h1);
+
     /* update step for progress reprt */
     r->session_rescale_total = gamma > 0 ? gamma : -gamma;
     r->session_rescale_current = 0;
     r->session_update_step = (gint) MAX(r->session_rescale_total * r->progress->update_step, 1);
 
     if (r->session_rescale_total) {
-        lqr_progress_init(r->progress, r->progress->init_height_message);
+        lqr_carver_progress_init(r, r->progress->init_height_message);
     }
 
     while (gamma) {
@@ -1865,11 +4457,16 @@ lqr_carver_resize_height(LqrCarver *r, gint h1)
         gint new_w;
         delta -= delta0;
         if (!r->transposed) {
-            LQR_CATCH(lqr_carver_transpose(r));
+            t0 = lqr_carver_deadline_start(r);
+            LQR_TRACE_CATCH(r, lqr_carver_transpose(r));
+            lqr_carver_deadline_stop(r, LQR_DEADLINE_TRANSPOSE, t0, (gdouble) r->w0 * r->h0);
         }
         new_w = MIN(h1, r->w_start + delta_max);
         gamma = h1 - new_w;
-        LQR_CATCH(lqr_carver_build_maps(r, delta0 + 1));
+        if (r->deadline) {
+            lqr_carver_deadline_plan(r, delta0 + 1, h1);
+        }
+        LQR_TRACE_CATCH(r, lqr_carver_build_maps(r, delta0 + 1));
         lqr_carver_set_width(r, new_w);
 
         data_tok.integer = new_w;
@@ -1878,10 +4475,14 @@ lqr_carver_resize_height(LqrCarver *r, gint h1)
         r->session_rescale_current = r->session_rescale_total - (gamma > 0 ? gamma : -gamma);
 
         if (r->dump_vmaps) {
-            LQR_CATCH(lqr_vmap_internal_dump(r));
+            LQR_TRACE_CATCH(r, lqr_vmap_internal_dump(r));
         }
-        if (new_w < h1) {
-            LQR_CATCH(lqr_carver_flatten(r));
+        /* (with a deadline, a reduction was not inflated: the image
+         * is flattened at its new size) */
+        if ((new_w < h1) || (r->deadline && r->deadline_flatten)) {
+            t0 = lqr_carver_deadline_start(r);
+            LQR_TRACE_CATCH(r, lqr_carver_flatten(r));
+            lqr_carver_deadline_stop(r, LQR_DEADLINE_FLATTEN, t0, (gdouble) r->w0 * r->h0);
             delta_max = (gint) ((r->enl_step - 1) * r->w_start) - 1;
             if (delta_max < 1) {
                 delta_max = 1;
@@ -1890,9 +4491,11 @@ lqr_carver_resize_height(LqrCarver *r, gint h1)
     }
 
     if (r->session_rescale_total) {
-        lqr_progress_end(r->progress, r->progress->end_height_message);
+        lqr_progress_end(r->progress, r, r->progress->end_height_message);
     }
 
+    lqr_carver_trace_end(r, "resize_height", h1);
+
     LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_STD, TRUE));
 
     return LQR_OK;
@@ -1913,13 +4516,25 @@ lqr_carver_resize(LqrCarver *r, gint w1, gint h1)
     LQR_CATCH_CANC(r);
     LQR_CATCH_F(g_atomic_int_get(&r->state) == LQR_CARVER_STATE_STD);
 
+    r->res_strategy = LQR_RES_STRATEGY_SEAMS;
+    r->deadline_watch = FALSE;
+    r->deadline_hit = FALSE;
+    r->deadline_flatten = FALSE;
+    if (r->deadline) {
+        g_timer_start(r->deadline_timer);
+    }
+
     switch (r->resize_order) {
         case LQR_RES_ORDER_HOR:
+            r->deadline_next = h1 - lqr_carver_get_height(r);
             LQR_CATCH(lqr_carver_resize_width(r, w1));
+            r->deadline_next = 0;
             LQR_CATCH(lqr_carver_resize_height(r, h1));
             break;
         case LQR_RES_ORDER_VERT:
+            r->deadline_next = w1 - lqr_carver_get_width(r);
             LQR_CATCH(lqr_carver_resize_height(r, h1));
+            r->deadline_next = 0;
             LQR_CATCH(lqr_carver_resize_width(r, w1));
             break;
 #ifdef __LQR_DEBUG__
@@ -2064,6 +4679,22 @@ lqr_carver_get_enl_step(LqrCarver *r)
     return r->enl_step;
 }
 
+/* get the strategy used by the last resize */
+/* LQR_PUBLIC */
+LqrResizeStrategy
+lqr_carver_get_resize_strategy(LqrCarver *r)
+{
+    return r->res_strategy;
+}
+
+/* get the kernel used to interpolate inserted seams */
+/* LQR_PUBLIC */
+LqrInsKernel
+lqr_carver_get_insertion_kernel(LqrCarver *r)
+{
+    return r->ins_kernel;
+}
+
 /* get orientation */
 /* LQR_PUBLIC */
 gint
@@ -2120,7 +4751,7 @@ lqr_carver_scan(LqrCarver *r, gint *x, gint *y, guchar **rgb)
     (*x) = (r->transposed ? r->c->y : r->c->x);
     (*y) = (r->transposed ? r->c->x : r->c->y);
     for (k = 0; k < r->channels; k++) {
-        AS_8I(r->rgb_ro_buffer)[k] = AS_8I(r->rgb)[r->c->now * r->channels + k];
+        AS_8I(r->rgb_ro_buffer)[k] = AS_8I(r->rgb)[(gsize) r->c->now * r->channels + k];
     }
     (*rgb) = AS_8I(r->rgb_ro_buffer);
     lqr_cursor_next(r->c);
@@ -2139,7 +4770,7 @@ lqr_carver_scan_ext(LqrCarver *r, gint *x, gint *y, void **rgb)
     (*x) = (r->transposed ? r->c->y : r->c->x);
     (*y) = (r->transposed ? r->c->x : r->c->y);
     for (k = 0; k < r->channels; k++) {
-        PXL_COPY(r->rgb_ro_buffer, k, r->rgb, r->c->now * r->channels + k, r->col_depth);
+        PXL_COPY(r->rgb_ro_buffer, k, r->rgb, (gsize) r->c->now * r->channels + k, r->col_depth);
     }
 
     BUF_POINTER_COPY(rgb, r->rgb_ro_buffer, r->col_depth);
@@ -2183,7 +4814,7 @@ lqr_carver_scan_line_ext(LqrCarver *r, gint *n, void **rgb)
     }
     for (x = 0; x < r->w; x++) {
         for (k = 0; k < r->channels; k++) {
-            PXL_COPY(r->rgb_ro_buffer, x * r->channels + k, r->rgb, r->c->now * r->channels + k, r->col_depth);
+            PXL_COPY(r->rgb_ro_buffer, x * r->channels + k, r->rgb, (gsize) r->c->now * r->channels + k, r->col_depth);
         }
         lqr_cursor_next(r->c);
     }
@@ -36,9 +36,10 @@
 void
 lqr_carver_bias_clear(LqrCarver *r)
 {
-    g_free(r->bias);
+    lqr_carver_scratch_free(r, r->bias);
     r->bias = NULL;
     r->nrg_uptodate = FALSE;
+    lqr_carver_base_maps_free(r);
 }
 
 /* LQR_PUBLIC */
@@ -56,11 +57,9 @@ lqr_carver_bias_add_xy(LqrCarver *r, gdouble bias, gint x, gint y)
         LQR_CATCH(lqr_carver_init_energy_related(r));
     }
 
-    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
+    LQR_CATCH(lqr_carver_edit_begin(r));
     if (r->bias == NULL) {
-        LQR_CATCH_MEM(r->bias = g_try_new0(gfloat, r->w0 * r->h0));
+        LQR_CATCH_MEM(r->bias = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w0 * r->h0));
     }
 
     xt = r->transposed ? y : x;
@@ -68,7 +67,7 @@ lqr_carver_bias_add_xy(LqrCarver *r, gdouble bias, gint x, gint y)
 
     r->bias[yt * r->w0 + xt] += (gfloat) bias / 2;
 
-    r->nrg_uptodate = FALSE;
+    lqr_carver_edit_mark(r, xt, yt, xt, yt, TRUE);
 
     return LQR_OK;
 }
@@ -90,16 +89,14 @@ lqr_carver_bias_add_area(LqrCarver *r, gdouble *buffer, gint bias_factor, gint w
         return LQR_OK;
     }
 
-    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
+    LQR_CATCH(lqr_carver_edit_begin(r));
 
     if (r->nrg_active == FALSE) {
         LQR_CATCH(lqr_carver_init_energy_related(r));
     }
 
     if (r->bias == NULL) {
-        LQR_CATCH_MEM(r->bias = g_try_new0(gfloat, r->w * r->h));
+        LQR_CATCH_MEM(r->bias = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w * r->h));
     }
 
     wt = r->transposed ? r->h : r->w;
@@ -123,7 +120,8 @@ lqr_carver_bias_add_area(LqrCarver *r, gdouble *buffer, gint bias_factor, gint w
         }
     }
 
-    r->nrg_uptodate = FALSE;
+    lqr_carver_edit_mark(r, x1, y1, x1 + (r->transposed ? y2 - y1 : x2 - x1) - 1,
+                         y1 + (r->transposed ? x2 - x1 : y2 - y1) - 1, TRUE);
 
     return LQR_OK;
 }
@@ -150,9 +148,7 @@ lqr_carver_bias_add_rgb_area(LqrCarver *r, guchar *rgb, gint bias_factor, gint c
 
     LQR_CATCH_CANC(r);
 
-    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
+    LQR_CATCH(lqr_carver_edit_begin(r));
 
     if (r->nrg_active == FALSE) {
         LQR_CATCH(lqr_carver_init_energy_related(r));
@@ -163,7 +159,7 @@ lqr_carver_bias_add_rgb_area(LqrCarver *r, guchar *rgb, gint bias_factor, gint c
     }
 
     if (r->bias == NULL) {
-        LQR_CATCH_MEM(r->bias = g_try_new0(gfloat, r->w * r->h));
+        LQR_CATCH_MEM(r->bias = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w * r->h));
     }
 
     has_alpha = (channels == 2 || channels >= 4);
@@ -183,12 +179,12 @@ lqr_carver_bias_add_rgb_area(LqrCarver *r, guchar *rgb, gint bias_factor, gint c
         for (x = 0; x < x2 - x1; x++) {
             sum = 0;
             for (k = 0; k < c_channels; k++) {
-                sum += rgb[((y - y0) * width + (x - x0)) * channels + k];
+                sum += rgb[((gsize) (y - y0) * width + (x - x0)) * channels + k];
             }
 
             bias = ((gdouble) bias_factor * sum / (2 * 255 * c_channels));
             if (has_alpha) {
-                bias *= (gdouble) rgb[((y - y0) * width + (x - x0) + 1) * channels - 1] / 255;
+                bias *= (gdouble) rgb[((gsize) (y - y0) * width + (x - x0) + 1) * channels - 1] / 255;
             }
 
             xt = r->transposed ? y : x;
@@ -198,7 +194,8 @@ lqr_carver_bias_add_rgb_area(LqrCarver *r, guchar *rgb, gint bias_factor, gint c
         }
     }
 
-    r->nrg_uptodate = FALSE;
+    lqr_carver_edit_mark(r, x1, y1, x1 + (r->transposed ? y2 - y1 : x2 - x1) - 1,
+                         y1 + (r->transposed ? x2 - x1 : y2 - y1) - 1, TRUE);
 
     return LQR_OK;
 }
@@ -96,7 +96,9 @@ lqr_carver_list_foreach(LqrCarverList *list, LqrCarverFunc func, LqrDataTok data
 {
     LqrCarverList *now = list;
     if (now != NULL) {
-        LQR_CATCH(func(now->current, data));
+        lqr_carver_trace_begin(now->current, "attached", -1);
+        LQR_TRACE_CATCH(now->current, func(now->current, data));
+        lqr_carver_trace_end(now->current, "attached", -1);
         return lqr_carver_list_foreach(now->next, func, data);
     }
     return LQR_OK;
@@ -108,9 +110,71 @@ lqr_carver_list_foreach_recursive(LqrCarverList *list, LqrCarverFunc func, LqrDa
 {
     LqrCarverList *now = list;
     if (now != NULL) {
-        LQR_CATCH(func(now->current, data));
+        lqr_carver_trace_begin(now->current, "attached", -1);
+        LQR_TRACE_CATCH(now->current, func(now->current, data));
+        lqr_carver_trace_end(now->current, "attached", -1);
         LQR_CATCH(lqr_carver_list_foreach(now->current->attached_list, func, data));
         return lqr_carver_list_foreach(now->next, func, data);
     }
     return LQR_OK;
 }
+
+/* same as lqr_carver_list_foreach, but the carvers in the
+ * list are processed concurrently when OpenMP is available
+ * (they must therefore be independent of each other);
+ * it returns after all of them are done, with the first
+ * error in list order, if any */
+LqrRetVal
+lqr_carver_list_foreach_parallel(LqrCarverList *list, LqrCarverFunc func, LqrDataTok data)
+{
+#ifdef _OPENMP
+    LqrCarverList *now;
+    LqrCarver **carvers;
+    LqrRetVal *ret_vals;
+    LqrRetVal ret_val = LQR_OK;
+    gint n, i;
+
+    n = 0;
+    for (now = list; now != NULL; now = now->next) {
+        n++;
+    }
+    if (n < 2) {
+        return lqr_carver_list_foreach(list, func, data);
+    }
+
+    LQR_CATCH_MEM(carvers = g_try_new(LqrCarver *, n));
+    ret_vals = g_try_new(LqrRetVal, n);
+    if (ret_vals == NULL) {
+        g_free(carvers);
+        return LQR_NOMEM;
+    }
+
+    for (now = list, i = 0; now != NULL; now = now->next, i++) {
+        carvers[i] = now->current;
+    }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(lqr_carver_n_threads(carvers[0]))
+    for (i = 0; i < n; i++) {
+        lqr_carver_trace_begin(carvers[i], "attached", -1);
+        ret_vals[i] = func(carvers[i], data);
+        if (ret_vals[i] == LQR_OK) {
+            lqr_carver_trace_end(carvers[i], "attached", -1);
+        } else {
+            lqr_carver_trace_unwind(carvers[i]);
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        if (ret_vals[i] != LQR_OK) {
+            ret_val = ret_vals[i];
+            break;
+        }
+    }
+
+    g_free(carvers);
+    g_free(ret_vals);
+    return ret_val;
+#else
+    return lqr_carver_list_foreach(list, func, data);
+#endif /* _OPENMP */
+}
@@ -38,5 +38,6 @@ struct _LqrCarverList {
 
 LqrCarverList *lqr_carver_list_append(LqrCarverList *list, LqrCarver *buffer);
 void lqr_carver_list_destroy(LqrCarverList *list);
+LqrRetVal lqr_carver_list_foreach_parallel(LqrCarverList *list, LqrCarverFunc func, LqrDataTok data);
 
 #endif /* __LQR_CARVER_LIST_PRIV_H__ */
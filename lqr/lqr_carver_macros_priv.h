@@ -27,7 +27,7 @@
 #define DATADOWN(y, x) (r->raw[(y) - 1][(x)])
 #define MDOWN(y, x) (r->m[DATADOWN((y), (x))])
 
-#define MMIN01G(y, x) (least = DATADOWN((y), (x)), MDOWN((y), (x)))
+#define MMIN01G(y, x) (least = (x), MDOWN((y), (x)))
 #define MMINTESTL(y, x1, x2) (MDOWN((y), (x1)) <= MDOWN((y), (x2)))
 #define MMINTESTR(y, x1, x2) (MDOWN((y), (x1)) <  MDOWN((y), (x2)))
 
@@ -65,7 +65,7 @@
 #define MRSET04(y, x, dx) (MRSET03((y), (x), (dx)), MRSET01((y), (x) + 3, (dx) + 3))
 #define MRSET05(y, x, dx) (MRSET04((y), (x), (dx)), MRSET01((y), (x) + 4, (dx) + 4))
 
-#define MRMIN01G(y, x, dx) (least = DATADOWN((y), (x)), mc[(dx)])
+#define MRMIN01G(y, x, dx) (least = (x), mc[(dx)])
 #define MRMINTESTL(dx1, dx2) (mc[(dx1)] <= mc[(dx2)])
 #define MRMINTESTR(dx1, dx2) (mc[(dx1)] < mc[(dx2)])
 
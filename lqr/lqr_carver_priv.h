@@ -51,6 +51,18 @@
 #error "lqr_vmap_list.h must be included prior to lqr_carver_priv.h"
 #endif /* __LQR_VMAP_LIST_H__ */
 
+#ifndef __LQR_CARVER_SCRATCH_H__
+#error "lqr_carver_scratch.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_CARVER_SCRATCH_H__ */
+
+#ifndef __LQR_CARVER_STATS_H__
+#error "lqr_carver_stats.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_CARVER_STATS_H__ */
+
+#ifndef __LQR_TRACE_H__
+#error "lqr_trace.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_TRACE_H__ */
+
 /* Macros for internal use */
 
 #define AS0_8I(x) ((lqr_t_8i)(x))
@@ -68,6 +80,11 @@
 #define AS2_32F(x) ((lqr_t_32f**)(x))
 #define AS2_64F(x) ((lqr_t_64f**)(x))
 
+#define LQR_SAMPLE_SIZE(col_depth) \
+  ((col_depth) == LQR_COLDEPTH_8I ? sizeof(lqr_t_8i) : \
+   (col_depth) == LQR_COLDEPTH_16I ? sizeof(lqr_t_16i) : \
+   (col_depth) == LQR_COLDEPTH_32F ? sizeof(lqr_t_32f) : sizeof(lqr_t_64f))
+
 #define PXL_COPY(dest, dest_ind, src, src_ind, col_depth) G_STMT_START { \
   switch (col_depth) \
     { \
@@ -158,23 +175,222 @@
     } \
 } G_STMT_END
 
+#define BUF_SCRATCH_TRY_NEW0_RET_LQR(carver, dest, size, col_depth) G_STMT_START { \
+  switch (col_depth) \
+    { \
+      case LQR_COLDEPTH_8I: \
+        LQR_CATCH_MEM ((dest) = LQR_SCRATCH_TRY_NEW0 ((carver), lqr_t_8i, (size))); \
+        break; \
+      case LQR_COLDEPTH_16I: \
+        LQR_CATCH_MEM ((dest) = LQR_SCRATCH_TRY_NEW0 ((carver), lqr_t_16i, (size))); \
+        break; \
+      case LQR_COLDEPTH_32F: \
+        LQR_CATCH_MEM ((dest) = LQR_SCRATCH_TRY_NEW0 ((carver), lqr_t_32f, (size))); \
+        break; \
+      case LQR_COLDEPTH_64F: \
+        LQR_CATCH_MEM ((dest) = LQR_SCRATCH_TRY_NEW0 ((carver), lqr_t_64f, (size))); \
+        break; \
+    } \
+} G_STMT_END
+
+/* cancellation checks read the state through state_p,
+ * which for the slices points to their carver's state */
 #define LQR_CATCH_CANC(carver) G_STMT_START { \
-  if (g_atomic_int_get(&((carver)->state)) == LQR_CARVER_STATE_CANCELLED) \
+  if (g_atomic_int_get((carver)->state_p) == LQR_CARVER_STATE_CANCELLED) \
     { \
       return LQR_USRCANCEL; \
     } \
 } G_STMT_END
 
 #define LQR_CATCH_CANC_N(carver) G_STMT_START { \
-  if (g_atomic_int_get(&((carver)->state)) == LQR_CARVER_STATE_CANCELLED) \
+  if (g_atomic_int_get((carver)->state_p) == LQR_CARVER_STATE_CANCELLED) \
     { \
       return NULL; \
     } \
 } G_STMT_END
 
+/* cancellation check for loops over rows: the state
+ * is only read every canc_rows rows (the inner loops
+ * over the points of a row have no checks at all) */
+#define LQR_CANC_ROW(carver, y) ((((y) % (carver)->canc_rows) == 0) && \
+  (g_atomic_int_get((carver)->state_p) == LQR_CARVER_STATE_CANCELLED))
+
+#define LQR_CATCH_CANC_ROW(carver, y) G_STMT_START { \
+  if (LQR_CANC_ROW((carver), (y))) \
+    { \
+      return LQR_USRCANCEL; \
+    } \
+} G_STMT_END
+
+/* whether the energy is fully given by the energy buffer
+ * (in which case it does not change when seams are carved) */
+#define LQR_NRG_IS_STATIC(carver) ((carver)->nrg_buffer != NULL && (carver)->nrg_func_weight == 0)
+
+/* the points of the maps are indexed by gint (while the sizes
+ * in bytes and the offsets of the samples are 64-bit), hence
+ * their number, enlargement included, cannot exceed G_MAXINT */
+#define LQR_POINTS_FIT(w, h) ((gint64) (w) * (h) <= G_MAXINT)
+
 /* Tolerance for update_mmap */
 #define UPDATE_TOLERANCE (1e-5)
 
+/* Quantized energy:
+ * the energy is rounded to at most LQR_QUANT_LEVELS integer levels,
+ * fewer for tall images, so that the minpath values (sums of one
+ * energy per row) never exceed LQR_QUANT_M_MAX and are thus exactly
+ * represented as gfloat (24 bit mantissa) */
+#define LQR_QUANT_LEVELS (65535)
+#define LQR_QUANT_M_MAX (16777215)
+
+/* whether the minpath map only holds exact integer values
+ * (rigidity adds fractional terms) */
+#define LQR_MMAP_IS_EXACT(carver) ((carver)->nrg_quant_scale > 0 && (carver)->rigidity == 0)
+
+/* Minimum number of points in the inflated maps for
+ * rows to be processed in parallel */
+#define LQR_INFLATE_PARALLEL_MIN_SIZE (1 << 16)
+
+/* whether the rows of the energy map are computed concurrently:
+ * only when the number of threads was set explicitly (i.e. by
+ * lqr_batch_run(), which requires a reentrant energy function) */
+#define LQR_EMAP_PARALLEL(carver) \
+  ((((carver)->root != NULL ? (carver)->root : (carver))->n_threads > 1) && \
+   ((carver)->w * (carver)->h >= LQR_INFLATE_PARALLEL_MIN_SIZE))
+
+/* Offset added to the neighbors' energies in the
+ * energy-weighted insertion kernel */
+#define LQR_INS_ENERGY_EPS (1e-2)
+#define LQR_INS_ENERGY_EPS_INV (100)
+
+/* The insertion kernels interpolate the whole row (instead of
+ * each inserted point) when at least one point every
+ * LQR_INS_DENSE_RATIO is inserted */
+#define LQR_INS_DENSE_RATIO (4)
+
+/* Visibility map storage:
+ * visibility levels never exceed the map width w0, therefore
+ * they are stored as 16 bit integers whenever possible */
+#define VS_USE_COMPACT(w0) ((w0) <= G_MAXUINT16)
+#define VS_SIZEOF(compact) ((compact) ? sizeof(guint16) : sizeof(gint))
+
+#define VS_GET_AS(vs, compact, ind) \
+  ((compact) ? (gint) ((guint16 *) (vs))[(ind)] : ((gint *) (vs))[(ind)])
+
+#define VS_SET_AS(vs, compact, ind, val) G_STMT_START { \
+  if (compact) \
+    { \
+      ((guint16 *) (vs))[(ind)] = (guint16) (val); \
+    } \
+  else \
+    { \
+      ((gint *) (vs))[(ind)] = (val); \
+    } \
+} G_STMT_END
+
+#define VS_GET(carver, ind) VS_GET_AS((carver)->vs, (carver)->vs_compact, (ind))
+#define VS_SET(carver, ind, val) VS_SET_AS((carver)->vs, (carver)->vs_compact, (ind), (val))
+
+/* whether a point is invisible at the current level */
+#define VS_HIDDEN(carver, ind) ((VS_GET((carver), (ind)) != 0) && (VS_GET((carver), (ind)) < (carver)->level))
+
+#define VS_TRY_NEW0(carver, compact, size) \
+  ((compact) ? (gpointer) LQR_SCRATCH_TRY_NEW0((carver), guint16, (size)) \
+             : (gpointer) LQR_SCRATCH_TRY_NEW0((carver), gint, (size)))
+
+/* Minpath map storage:
+ * the least-cost predecessor of each point is stored as its
+ * horizontal offset (at most delta_x) in the previous row,
+ * as a gint8 when delta_x allows it and as a gint otherwise
+ * (this is decided by lqr_carver_init()); LEAST_NONE marks
+ * the offsets which need to be recomputed, and is the lowest
+ * value of the storage type (it is not converted on access) */
+#define LEAST_MAX_DELTA_X G_MAXINT8
+#define LEAST_NONE(carver) ((carver)->least_compact ? G_MININT8 : G_MININT)
+
+#define LEAST_GET_AS(least, compact, ind) \
+  ((compact) ? (gint) ((gint8 *) (least))[(ind)] : ((gint *) (least))[(ind)])
+
+#define LEAST_SET_AS(least, compact, ind, val) G_STMT_START { \
+  if (compact) \
+    { \
+      ((gint8 *) (least))[(ind)] = (gint8) (val); \
+    } \
+  else \
+    { \
+      ((gint *) (least))[(ind)] = (val); \
+    } \
+} G_STMT_END
+
+#define LEAST_GET(carver, ind) LEAST_GET_AS((carver)->least, (carver)->least_compact, (ind))
+#define LEAST_SET(carver, ind, val) LEAST_SET_AS((carver)->least, (carver)->least_compact, (ind), (val))
+#define LEAST_ALT_GET(carver, ind) LEAST_GET_AS((carver)->least_alt, (carver)->least_compact, (ind))
+#define LEAST_ALT_SET(carver, ind, val) LEAST_SET_AS((carver)->least_alt, (carver)->least_compact, (ind), (val))
+
+#define LEAST_SIZEOF(compact) ((compact) ? sizeof(gint8) : sizeof(gint))
+
+#define LEAST_TRY_NEW(carver, size) \
+  ((carver)->least_compact ? (gpointer) LQR_SCRATCH_TRY_NEW((carver), gint8, (size)) \
+                           : (gpointer) LQR_SCRATCH_TRY_NEW((carver), gint, (size)))
+
+#define LEAST_TRY_NEW0(carver, size) \
+  ((carver)->least_compact ? (gpointer) LQR_SCRATCH_TRY_NEW0((carver), gint8, (size)) \
+                           : (gpointer) LQR_SCRATCH_TRY_NEW0((carver), gint, (size)))
+
+/* Minimum delta_x for which the minpath map is computed
+ * with a sliding window minimum, rather than by scanning
+ * all the 2 * delta_x + 1 neighbours of each point
+ * (below this, the unrolled scans are faster) */
+#define LQR_MIN_WINDOW_MIN_DELTA_X (4)
+
+/* deadline check for the loops over rows of the map builds, done along
+ * with the cancellation checks; it is only armed (deadline_watch) while
+ * the maps are built by build_maps(), which abandons them when the
+ * carving has to stop */
+#define LQR_DEADLINE_ROW(carver, y) ((carver)->deadline_watch && (((y) % (carver)->canc_rows) == 0) && \
+  (g_timer_elapsed((carver)->deadline_timer, NULL) >= (carver)->deadline_stop))
+
+/* Parallel slices:
+ * minimum width of a slice, and minimum number
+ * of columns each slice is left with */
+#define LQR_SLICE_MIN_WIDTH (64)
+#define LQR_SLICE_MIN_KEEP (8)
+
+/* Sliding window minimum over a row of the minpath map */
+
+struct _LqrMinWindow;
+
+typedef struct _LqrMinWindow LqrMinWindow;
+
+struct _LqrMinWindow {
+    gint *queue;                        /* candidate positions, with increasing values */
+    gint head;                          /* first candidate (the minimum) */
+    gint tail;                          /* one past the last candidate */
+    gint next;                          /* next position to enter the window */
+};
+
+/* Phases of a resize whose time is estimated for the deadline,
+ * and their default costs per point (in seconds), used until they
+ * are measured (a seam is accounted for row by row) */
+
+enum _LqrDeadlinePhase {
+    LQR_DEADLINE_MAPS,
+    LQR_DEADLINE_SEAM,
+    LQR_DEADLINE_UNIFORM,
+    LQR_DEADLINE_INFLATE,
+    LQR_DEADLINE_FLATTEN,
+    LQR_DEADLINE_TRANSPOSE,
+    LQR_DEADLINE_N_PHASES
+};
+
+typedef enum _LqrDeadlinePhase LqrDeadlinePhase;
+
+#define LQR_DEADLINE_COST_MAPS (8e-8)
+#define LQR_DEADLINE_COST_SEAM (1e-7)
+#define LQR_DEADLINE_COST_UNIFORM (1e-8)
+#define LQR_DEADLINE_COST_INFLATE (3e-8)
+#define LQR_DEADLINE_COST_FLATTEN (3e-8)
+#define LQR_DEADLINE_COST_TRANSPOSE (4e-8)
+
 /* Carver states */
 
 enum _LqrCarverState {
@@ -217,8 +433,18 @@ struct _LqrCarver {
     gboolean resize_aux_layers;         /* flag to determine whether the auxiliary layers are resized */
     gboolean dump_vmaps;                /* flag to determine whether to output the seam map */
     LqrResizeOrder resize_order;        /* resize order */
+    gulong deadline;                    /* time budget of a resize, in microseconds (0 = none) */
+    GTimer *deadline_timer;             /* timer for the deadline (NULL if not needed) */
+    gdouble deadline_cost[LQR_DEADLINE_N_PHASES];       /* estimated time per point of the phases of a resize */
+    gdouble deadline_stop;              /* time by which the carving of the current step has to stop */
+    gint deadline_next;                 /* size change still to come in the other direction */
+    gboolean deadline_watch;            /* flag to check the deadline within the map builds */
+    gboolean deadline_hit;              /* flag set if the carving of the current step was stopped */
+    gboolean deadline_flatten;          /* flag set if the current step is flattened instead of inflated */
+    LqrResizeStrategy res_strategy;     /* strategy used by the last resize */
 
     LqrCarverList *attached_list;       /* list of attached carvers */
+    LqrLayer *layers;                   /* list of attached passive layers */
 
     gfloat rigidity;                    /* rigidity value (can straighten seams) */
     gfloat *rigidity_map;               /* the rigidity function */
@@ -226,11 +452,18 @@ struct _LqrCarver {
     gint delta_x;                       /* max displacement of seams (currently is only meaningful if 0 or 1 */
 
     void *rgb;                          /* array of rgb points */
-    gint *vs;                           /* array of visibility levels */
+    void *vs;                           /* array of visibility levels (see VS_GET) */
+    gboolean vs_compact;                /* whether vs is stored as guint16 */
     gfloat *en;                         /* array of energy levels */
     gfloat *bias;                       /* bias mask */
+    gfloat *nrg_buffer;                 /* caller supplied (static) energy map */
+    gfloat nrg_func_weight;             /* weight of the energy function when nrg_buffer is set */
     gfloat *m;                          /* array of auxiliary energy values */
-    gint *least;                        /* array of pointers */
+    void *least;                        /* array of offsets to the least-cost point in the previous row (see LEAST_GET) */
+    void *least_alt;                    /* same, with ties broken towards the other side (side switch only) */
+    gboolean least_compact;             /* whether least and least_alt are stored as gint8 */
+    gint *min_queue;                    /* storage for the sliding window minimum (large delta_x only) */
+    gint min_queue_size;                /* size of min_queue */
     gint *_raw;                         /* array of array-coordinates, for seam computation */
     gint **raw;                         /* array of array-coordinates, for seam computation */
 
@@ -242,12 +475,20 @@ struct _LqrCarver {
 
     gint leftright;                     /* whether to favor left or right seams */
     gint lr_switch_frequency;           /* interval between leftright switches */
+    gint n_slices;                      /* number of slices carved in parallel (< 2 = off) */
+    gint n_threads;                     /* number of threads of the parallel phases (0 = OpenMP default) */
     gfloat enl_step;                    /* maximum enlargement ratio in a single step */
+    LqrInsKernel ins_kernel;            /* interpolation used for inserted seams */
 
     LqrProgress *progress;              /* pointer to progress update functions */
     gint session_update_step;           /* update step for the rescaling session */
     gint session_rescale_total;         /* total amount of rescaling for the session */
     gint session_rescale_current;       /* current amount of rescaling for the session */
+    gint session_update_countdown;      /* seams left before the next progress update */
+    gint session_last_update;           /* amount of rescaling at the last progress update */
+    gdouble session_last_time;          /* time of the last progress update */
+    gdouble session_seam_time;          /* estimated time per seam (0 = unknown) */
+    GTimer *session_timer;              /* timer for the progress updates (NULL if not needed) */
 
     LqrEnergyFunc nrg;                  /* pointer to a general energy function */
     gint nrg_radius;                    /* energy function radius */
@@ -260,6 +501,22 @@ struct _LqrCarver {
 
     gboolean nrg_uptodate;              /* flag set if energy map is up to date */
 
+    gboolean nrg_quant;                 /* whether the energy is quantized */
+    gfloat nrg_quant_scale;             /* quantization scale of the energy map (0 = not quantized) */
+    gfloat nrg_quant_max;               /* largest quantized energy level (in absolute value) */
+
+    gboolean incremental_edits;         /* whether bias/rigmask edits are applied to the base maps */
+    gfloat *base_en;                    /* copy of the energy map of the base image */
+    gfloat *base_m;                     /* copy of the minpath map of the base image */
+    void *base_least;                   /* copy of the least map of the base image */
+    gint base_leftright;                /* leftright value used for base_m */
+    gfloat base_nrg_quant_scale;        /* quantization scale used for base_en */
+    gfloat base_nrg_quant_max;          /* largest quantized level used for base_en */
+    gboolean mmap_uptodate;             /* flag set if en, m and least hold the (restored) base maps */
+    gboolean dirty_nrg;                 /* whether the energy of the dirty rectangle has to be recomputed */
+    gint dirty_x0, dirty_y0;            /* dirty rectangle of the base maps (empty if x0 > x1) */
+    gint dirty_x1, dirty_y1;
+
     gdouble *rcache;                    /* array of brightness (or luma or else) levels for energy computation */
     gboolean use_rcache;                /* wheter to cache brightness, luma etc. */
 
@@ -267,7 +524,23 @@ struct _LqrCarver {
 
     gboolean preserve_in_buffer;        /* whether to preserve the buffer given to lqr_carver_new */
 
+    gchar *scratch_dir;                 /* directory for file-backed maps (NULL = use the heap) */
+    gsize scratch_threshold;            /* minimum size in bytes of file-backed maps */
+    LqrScratchChunk *scratch_chunks;    /* list of the maps in use (file-backed or not) */
+    gsize map_bytes;                    /* total size of the maps in use */
+
+    gboolean collect_stats;             /* whether to update the performance counters */
+    GTimer *stats_timer;                /* timer for the performance counters */
+    LqrCarverStats stats;               /* performance counters */
+    guint64 stats_mmap_rows;            /* number of rows spanned by update_mmap */
+
+    LqrTrace *trace;                    /* event trace (NULL = no tracing) */
+    LqrTraceFrame trace_open[LQR_TRACE_MAX_DEPTH];      /* events opened and not yet closed */
+    gint trace_depth;                   /* number of events opened and not yet closed */
+
     volatile gint state;                /* current state of the carver (actually a LqrCarverState enum) */
+    volatile gint *state_p;             /* state read by the cancellation checks (&state, except for slices) */
+    gint canc_rows;                     /* rows between cancellation checks */
     volatile gint state_lock;           /* lock for state changing routines */
     volatile gint state_lock_queue;     /* lock queue for state changing routines */
 
@@ -286,18 +559,63 @@ LqrRetVal lqr_carver_build_maps(LqrCarver *r, gint depth);      /* build all */
 LqrRetVal lqr_carver_build_emap(LqrCarver *r);  /* energy */
 LqrRetVal lqr_carver_build_mmap(LqrCarver *r);  /* minpath */
 LqrRetVal lqr_carver_build_vsmap(LqrCarver *r, gint depth);     /* visibility */
+LqrRetVal lqr_carver_build_vsmap_slices(LqrCarver *r, gint *l_p, gint depth);  /* parallel slices */
+gboolean lqr_carver_deadline_near(LqrCarver *r, gint seams, gdouble t0);       /* deadline */
+gboolean lqr_carver_deadline_fits(LqrCarver *r, LqrDeadlinePhase phase, gdouble points);
+void lqr_carver_deadline_plan(LqrCarver *r, gint depth, gint w1);
+gdouble lqr_carver_deadline_start(LqrCarver *r);
+void lqr_carver_deadline_stop(LqrCarver *r, LqrDeadlinePhase phase, gdouble t0, gdouble points);
+LqrRetVal lqr_carver_build_vsmap_uniform(LqrCarver *r, gint l, gint depth);
+LqrRetVal lqr_carver_slice_init(LqrCarver *r, LqrCarver *v, gint x0, gint width);
+void lqr_carver_slice_clear(LqrCarver *v);
+LqrRetVal lqr_carver_carve_slice(LqrCarver *v, LqrCarver *r, gint *levels, gint n, volatile gint *seams_done,
+                                 gint progress_base);
+gint lqr_carver_n_threads(LqrCarver *r);        /* number of threads of the parallel phases */
 
 /* internal functions for maps computation */
 LqrRetVal lqr_carver_compute_e(LqrCarver *r, gint x, gint y);   /* compute energy of point at c */
+LqrRetVal lqr_carver_compute_e_window(LqrCarver *r, LqrReadingWindow *rwindow, gint x, gint y);  /* same, with the given window */
+LqrReadingWindow *lqr_carver_rwindow_new(LqrCarver *r);        /* new reading window for the energy function */
+void lqr_carver_quantize_emap(LqrCarver *r);    /* quantized energy */
+gfloat lqr_carver_quantize_e(LqrCarver *r, gfloat nrg);
 LqrRetVal lqr_carver_update_emap(LqrCarver *r); /* update energy map after seam removal */
+void lqr_carver_update_emap_range(LqrCarver *r, gint y, gint radius);  /* changed energy region in a row */
 LqrRetVal lqr_carver_update_mmap(LqrCarver *r); /* minpath */
+gint lqr_carver_update_mmap_row(LqrCarver *r, gint y, gint *x_min_p, gint *x_max_p, gfloat *mc, LqrMinWindow *mw);   /* one row */
+LqrRetVal lqr_carver_update_seam(LqrCarver *r); /* carve + update_emap + update_mmap in one sweep */
+LqrRetVal lqr_carver_update_mmap_rect(LqrCarver *r, gint x0, gint y0, gint x1, gint y1);  /* minpath below a rect */
+gint lqr_carver_least_alt(LqrCarver *r, gint y, gint x, gint x1_min, gint x1_max, gint least, gfloat m,
+                          gfloat r_fact);       /* least-cost point for the other side */
+void lqr_carver_swap_least(LqrCarver *r);       /* switch side without rebuilding the minpath */
+LqrRetVal lqr_carver_min_window_init(LqrCarver *r, LqrMinWindow **mw_p, LqrMinWindow *mw);    /* large delta_x */
+void lqr_carver_min_window_reset(LqrMinWindow *mw, gint x);
+gint lqr_carver_min_window(LqrCarver *r, LqrMinWindow *mw, gint y, gint x1_min, gint x1_max);
+LqrRetVal lqr_carver_build_rcache(LqrCarver *r);        /* reading cache */
 void lqr_carver_build_vpath(LqrCarver *r);      /* compute seam path */
+gint lqr_carver_least_scan(LqrCarver *r, gint y, gint x);       /* least-cost point, without the minpath links */
 void lqr_carver_carve(LqrCarver *r);    /* updates the "raw" buffer */
+gint lqr_carver_carve_row(LqrCarver *r, gint y);        /* one row */
+gint lqr_carver_carve_least(LqrCarver *r, gint least, gint x, gint x_seam, gint x_seam_down);   /* shift an offset across the seam */
 void lqr_carver_update_vsmap(LqrCarver *r, gint l);     /* update visibility map after seam removal */
 void lqr_carver_finish_vsmap(LqrCarver *r);     /* complete visibility map (last seam) */
 LqrRetVal lqr_carver_inflate(LqrCarver *r, gint l);     /* adds enlargment info to map */
+void lqr_carver_inflate_average(void *rgb, void *new_rgb, gint channels, LqrColDepth col_depth, gint z0, gint c_left,
+                                gint z1);
+void lqr_carver_inflate_row_kernel(LqrCarver *r, void *new_rgb, gint y, gint w1, gint *ins, gint n, gpointer buf);
+void lqr_carver_inflate_row(LqrCarver *r, gint l, gint y, gint w1, gint *ins, void *new_rgb, void *new_vs,
+                            gboolean new_vs_compact, gfloat *new_bias, gfloat *new_nrg_buffer,
+                            gfloat *new_rigmask, gpointer kbuf);
 LqrRetVal lqr_carver_propagate_vsmap(LqrCarver *r);     /* propagates vsmap on attached carvers */
 
+/* incremental edits of the base image */
+LqrRetVal lqr_carver_base_maps_save(LqrCarver *r);
+void lqr_carver_base_maps_free(LqrCarver *r);
+LqrRetVal lqr_carver_rewind(LqrCarver *r);
+LqrRetVal lqr_carver_edit_begin(LqrCarver *r);
+void lqr_carver_edit_mark(LqrCarver *r, gint x0, gint y0, gint x1, gint y1, gboolean nrg);
+void lqr_carver_edit_clear(LqrCarver *r);
+LqrRetVal lqr_carver_update_dirty(LqrCarver *r);
+
 /* image manipulations */
 LqrRetVal lqr_carver_resize_width(LqrCarver *r, gint w1);       /* liquid resize width */
 LqrRetVal lqr_carver_resize_height(LqrCarver *r, gint h1);      /* liquid resize height */
@@ -305,9 +623,14 @@ void lqr_carver_set_width(LqrCarver *r, gint w1);
 LqrRetVal lqr_carver_transpose(LqrCarver *r);
 void lqr_carver_scan_reset_all(LqrCarver *r);
 
+/* progress report */
+void lqr_carver_progress_init(LqrCarver *r, const gchar *message);
+void lqr_carver_progress_update(LqrCarver *r, gint done);
+
 /* auxiliary */
 LqrRetVal lqr_carver_scan_reset_attached(LqrCarver *r, LqrDataTok data);
 LqrRetVal lqr_carver_set_width_attached(LqrCarver *r, LqrDataTok data);
+LqrRetVal lqr_carver_set_max_level_attached(LqrCarver *r, LqrDataTok data);
 LqrRetVal lqr_carver_inflate_attached(LqrCarver *r, LqrDataTok data);
 LqrRetVal lqr_carver_flatten_attached(LqrCarver *r, LqrDataTok data);
 LqrRetVal lqr_carver_transpose_attached(LqrCarver *r, LqrDataTok data);
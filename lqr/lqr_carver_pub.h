@@ -67,6 +67,9 @@ LQR_PUBLIC LqrCarver *lqr_carver_new_ext(void *buffer, gint width, gint height,
                                          LqrColDepth colour_depth);
 LQR_PUBLIC void lqr_carver_destroy(LqrCarver *r);
 
+/* reuse */
+LQR_PUBLIC LqrRetVal lqr_carver_reset_image(LqrCarver *r, void *buffer, gint width, gint height);
+
 /* initialize */
 LQR_PUBLIC LqrRetVal lqr_carver_init(LqrCarver *r, gint delta_x, gfloat rigidity);
 
@@ -77,9 +80,15 @@ LQR_PUBLIC LqrRetVal lqr_carver_set_black_channel(LqrCarver *r, gint channel_ind
 LQR_PUBLIC void lqr_carver_set_dump_vmaps(LqrCarver *r);
 LQR_PUBLIC void lqr_carver_set_no_dump_vmaps(LqrCarver *r);
 LQR_PUBLIC void lqr_carver_set_resize_order(LqrCarver *r, LqrResizeOrder resize_order);
+LQR_PUBLIC LqrRetVal lqr_carver_set_deadline(LqrCarver *r, gulong deadline);
+LQR_PUBLIC LqrRetVal lqr_carver_set_cancel_interval(LqrCarver *r, gint rows);
 LQR_PUBLIC void lqr_carver_set_side_switch_frequency(LqrCarver *r, guint switch_frequency);
+LQR_PUBLIC LqrRetVal lqr_carver_set_parallel_slices(LqrCarver *r, gint n_slices);
 LQR_PUBLIC LqrRetVal lqr_carver_set_enl_step(LqrCarver *r, gfloat enl_step);
+LQR_PUBLIC LqrRetVal lqr_carver_set_insertion_kernel(LqrCarver *r, LqrInsKernel ins_kernel);
 LQR_PUBLIC void lqr_carver_set_use_cache(LqrCarver *r, gboolean use_cache);
+LQR_PUBLIC LqrRetVal lqr_carver_set_incremental_edits(LqrCarver *r, gboolean incremental_edits);
+LQR_PUBLIC LqrRetVal lqr_carver_set_energy_quantization(LqrCarver *r, gboolean quantize);
 LQR_PUBLIC LqrRetVal lqr_carver_attach(LqrCarver *r, LqrCarver *aux);
 LQR_PUBLIC void lqr_carver_set_progress(LqrCarver *r, LqrProgress * p);
 LQR_PUBLIC void lqr_carver_set_preserve_input_image(LqrCarver *r);
@@ -111,6 +120,8 @@ LQR_PUBLIC gint lqr_carver_get_orientation(LqrCarver *r);
 LQR_PUBLIC LqrColDepth lqr_carver_get_col_depth(LqrCarver *r);
 LQR_PUBLIC LqrImageType lqr_carver_get_image_type(LqrCarver *r);
 LQR_PUBLIC gfloat lqr_carver_get_enl_step(LqrCarver *r);
+LQR_PUBLIC LqrInsKernel lqr_carver_get_insertion_kernel(LqrCarver *r);
+LQR_PUBLIC LqrResizeStrategy lqr_carver_get_resize_strategy(LqrCarver *r);
 LQR_PUBLIC gint lqr_carver_get_depth(LqrCarver *r);
 
 #endif /* __LQR_CARVER_PUB_H__ */
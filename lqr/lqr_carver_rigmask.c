@@ -36,8 +36,14 @@
 void
 lqr_carver_rigmask_clear(LqrCarver *r)
 {
-    g_free(r->rigidity_mask);
+    lqr_carver_scratch_free(r, r->rigidity_mask);
     r->rigidity_mask = NULL;
+    if (r->mmap_uptodate) {
+        lqr_carver_edit_mark(r, 0, 0, r->w0 - 1, r->h0 - 1, FALSE);
+    } else {
+        /* the base snapshots were computed with the mask */
+        lqr_carver_base_maps_free(r);
+    }
 }
 
 LqrRetVal
@@ -49,7 +55,8 @@ lqr_carver_rigmask_init(LqrCarver *r)
 
     LQR_CATCH_F(r->active);
 
-    LQR_CATCH_MEM(r->rigidity_mask = g_try_new0(gfloat, r->w0 * r->h0));
+    LQR_CATCH_MEM(r->rigidity_mask = LQR_SCRATCH_TRY_NEW0(r, gfloat, (gsize) r->w0 * r->h0));
+    lqr_carver_edit_mark(r, 0, 0, r->w0 - 1, r->h0 - 1, FALSE);
 
 #if 0
     for (y = 0; y < r->h0; y++) {
@@ -72,9 +79,7 @@ lqr_carver_rigmask_add_xy(LqrCarver *r, gdouble rigidity, gint x, gint y)
 
     LQR_CATCH_F(r->active);
 
-    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
+    LQR_CATCH(lqr_carver_edit_begin(r));
 
     if (r->rigidity_mask == NULL) {
         LQR_CATCH(lqr_carver_rigmask_init(r));
@@ -90,6 +95,8 @@ lqr_carver_rigmask_add_xy(LqrCarver *r, gdouble rigidity, gint x, gint y)
 
     r->rigidity_mask[yt * r->w0 + xt] += (gfloat) rigidity;
 
+    lqr_carver_edit_mark(r, xt, yt, xt, yt, FALSE);
+
     return LQR_OK;
 }
 
@@ -106,9 +113,7 @@ lqr_carver_rigmask_add_area(LqrCarver *r, gdouble *buffer, gint width, gint heig
 
     LQR_CATCH_F(r->active);
 
-    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
+    LQR_CATCH(lqr_carver_edit_begin(r));
 #if 0
     if (r->rigidity == 0) {
         return LQR_OK;
@@ -139,6 +144,9 @@ lqr_carver_rigmask_add_area(LqrCarver *r, gdouble *buffer, gint width, gint heig
 
     }
 
+    lqr_carver_edit_mark(r, x1, y1, x1 + (r->transposed ? y2 - y1 : x2 - x1) - 1,
+                         y1 + (r->transposed ? x2 - x1 : y2 - y1) - 1, FALSE);
+
     return LQR_OK;
 }
 
@@ -166,9 +174,7 @@ lqr_carver_rigmask_add_rgb_area(LqrCarver *r, guchar *rgb, gint channels, gint w
 
     LQR_CATCH_F(r->active);
 
-    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
+    LQR_CATCH(lqr_carver_edit_begin(r));
 #if 0
     if (r->rigidity == 0) {
         return LQR_OK;
@@ -196,12 +202,12 @@ lqr_carver_rigmask_add_rgb_area(LqrCarver *r, guchar *rgb, gint channels, gint w
         for (x = 0; x < x2 - x1; x++) {
             sum = 0;
             for (k = 0; k < c_channels; k++) {
-                sum += rgb[((y - y0) * width + (x - x0)) * channels + k];
+                sum += rgb[((gsize) (y - y0) * width + (x - x0)) * channels + k];
             }
 
             rigmask = (gdouble) sum / (255 * c_channels);
             if (has_alpha) {
-                rigmask *= (gdouble) rgb[((y - y0) * width + (x - x0) + 1) * channels - 1] / 255;
+                rigmask *= (gdouble) rgb[((gsize) (y - y0) * width + (x - x0) + 1) * channels - 1] / 255;
             }
 
             xt = r->transposed ? y : x;
@@ -213,6 +219,9 @@ lqr_carver_rigmask_add_rgb_area(LqrCarver *r, guchar *rgb, gint channels, gint w
 
     }
 
+    lqr_carver_edit_mark(r, x1, y1, x1 + (r->transposed ? y2 - y1 : x2 - x1) - 1,
+                         y1 + (r->transposed ? x2 - x1 : y2 - y1) - 1, FALSE);
+
     return LQR_OK;
 }
 
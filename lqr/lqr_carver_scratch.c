@@ -0,0 +1,243 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <lqr/lqr_all.h>
+
+#ifdef G_OS_UNIX
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif /* G_OS_UNIX */
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_CARVER_SCRATCH FUNCTIONS ****/
+
+/* the large per-pixel maps can be backed by (unlinked) scratch files
+ * instead of the heap: this way the kernel can write them back to disk
+ * instead of failing, trading memory for (mostly sequential) I/O */
+
+/* the settings apply to the attached carvers as well (they are
+ * also taken over by the carvers attached later on, unless these
+ * have their own scratch directory) */
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_scratch_set_dir(LqrCarver *r, const gchar *dir)
+{
+    LqrDataTok data_tok;
+
+    data_tok.data = (gpointer) dir;
+    LQR_CATCH(lqr_carver_scratch_set_dir_attached(r, data_tok));
+    return lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_scratch_set_dir_attached, data_tok);
+}
+
+LqrRetVal
+lqr_carver_scratch_set_dir_attached(LqrCarver *r, LqrDataTok data)
+{
+    const gchar *dir = (const gchar *) data.data;
+
+    g_free(r->scratch_dir);
+    r->scratch_dir = NULL;
+
+    if (dir == NULL) {
+        return LQR_OK;
+    }
+#ifdef G_OS_UNIX
+    LQR_CATCH_MEM(r->scratch_dir = g_strdup(dir));
+    return LQR_OK;
+#else
+    return LQR_ERROR;
+#endif /* G_OS_UNIX */
+}
+
+/* LQR_PUBLIC */
+void
+lqr_carver_scratch_set_threshold(LqrCarver *r, gsize min_bytes)
+{
+    LqrDataTok data_tok;
+
+    data_tok.data = &min_bytes;
+    lqr_carver_scratch_set_threshold_attached(r, data_tok);
+    lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_scratch_set_threshold_attached, data_tok);
+}
+
+LqrRetVal
+lqr_carver_scratch_set_threshold_attached(LqrCarver *r, LqrDataTok data)
+{
+    r->scratch_threshold = *((gsize *) data.data);
+    return LQR_OK;
+}
+
+/* create an unlinked scratch file and map it */
+gpointer
+lqr_carver_scratch_try_map(LqrCarver *r, gsize n_bytes)
+{
+#ifdef G_OS_UNIX
+    LqrScratchChunk *chunk;
+    gchar *path;
+    gint fd;
+    gpointer addr;
+
+    LQR_TRY_N_N(chunk = g_try_new(LqrScratchChunk, 1));
+
+    path = g_build_filename(r->scratch_dir, "lqr-scratch-XXXXXX", NULL);
+    fd = g_mkstemp(path);
+    if (fd < 0) {
+        g_free(path);
+        g_free(chunk);
+        return NULL;
+    }
+    /* the file is only reachable through the mapping */
+    unlink(path);
+    g_free(path);
+
+    if (ftruncate(fd, (off_t) n_bytes) != 0) {
+        close(fd);
+        g_free(chunk);
+        return NULL;
+    }
+
+    addr = mmap(NULL, n_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        g_free(chunk);
+        return NULL;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    /* maps are filled by row sweeps */
+    madvise(addr, n_bytes, MADV_SEQUENTIAL);
+#endif /* MADV_SEQUENTIAL */
+
+    chunk->addr = addr;
+    chunk->size = n_bytes;
+    chunk->mapped = TRUE;
+    chunk->next = r->scratch_chunks;
+    r->scratch_chunks = chunk;
+
+    return addr;
+#else
+    return NULL;
+#endif /* G_OS_UNIX */
+}
+
+/* allocate a map: file-backed if a scratch directory is set
+ * and the map is large enough, on the heap otherwise
+ * (file-backed maps are always zero-filled); heap maps are
+ * listed as well, so that map_bytes counts all of them */
+gpointer
+lqr_carver_scratch_try_alloc(LqrCarver *r, gsize n_bytes, gboolean clear)
+{
+    LqrScratchChunk *chunk;
+    gpointer addr = NULL;
+
+    if ((r->scratch_dir != NULL) && (n_bytes > 0) && (n_bytes >= r->scratch_threshold)) {
+        /* (NULL = fall back to the heap) */
+        addr = lqr_carver_scratch_try_map(r, n_bytes);
+    }
+
+    if (addr == NULL) {
+        LQR_TRY_N_N(chunk = g_try_new(LqrScratchChunk, 1));
+        addr = clear ? g_try_malloc0(n_bytes) : g_try_malloc(n_bytes);
+        if (addr == NULL) {
+            g_free(chunk);
+            return NULL;
+        }
+        chunk->addr = addr;
+        chunk->size = n_bytes;
+        chunk->mapped = FALSE;
+        chunk->next = r->scratch_chunks;
+        r->scratch_chunks = chunk;
+    }
+
+    r->map_bytes += n_bytes;
+    lqr_carver_stats_sample_bytes(r);
+
+    return addr;
+}
+
+/* free a map allocated with lqr_carver_scratch_try_alloc()
+ * (heap pointers, e.g. the input buffer, are also accepted) */
+void
+lqr_carver_scratch_free(LqrCarver *r, gpointer mem)
+{
+    LqrScratchChunk *chunk;
+    LqrScratchChunk **prev;
+
+    if (mem == NULL) {
+        return;
+    }
+
+    for (prev = &r->scratch_chunks, chunk = r->scratch_chunks; chunk != NULL; prev = &chunk->next, chunk = chunk->next) {
+        if (chunk->addr == mem) {
+            if (chunk->mapped) {
+#ifdef G_OS_UNIX
+                munmap(chunk->addr, chunk->size);
+#endif /* G_OS_UNIX */
+            } else {
+                g_free(chunk->addr);
+            }
+            r->map_bytes -= chunk->size;
+            *prev = chunk->next;
+            g_free(chunk);
+            return;
+        }
+    }
+
+    g_free(mem);
+}
+
+/* hint the kernel about the upcoming access pattern:
+ * full row sweeps (sequential) or seam updates (scattered) */
+void
+lqr_carver_scratch_advise(LqrCarver *r, gboolean sequential)
+{
+#if defined(G_OS_UNIX) && defined(MADV_SEQUENTIAL) && defined(MADV_NORMAL)
+    LqrScratchChunk *chunk;
+
+    for (chunk = r->scratch_chunks; chunk != NULL; chunk = chunk->next) {
+        if (chunk->mapped) {
+            madvise(chunk->addr, chunk->size, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+        }
+    }
+#endif /* G_OS_UNIX && MADV_SEQUENTIAL && MADV_NORMAL */
+}
+
+/* release all remaining maps */
+void
+lqr_carver_scratch_destroy(LqrCarver *r)
+{
+    while (r->scratch_chunks != NULL) {
+        lqr_carver_scratch_free(r, r->scratch_chunks->addr);
+    }
+    g_free(r->scratch_dir);
+    r->scratch_dir = NULL;
+}
+
+/**** END OF LQR_CARVER_SCRATCH FUNCTIONS ****/
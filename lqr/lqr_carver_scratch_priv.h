@@ -0,0 +1,63 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_CARVER_SCRATCH_PRIV_H__
+#define __LQR_CARVER_SCRATCH_PRIV_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_carver_scratch_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+/* default minimum size of the file-backed maps */
+#define LQR_SCRATCH_DEFAULT_THRESHOLD (1 << 20)
+
+/**** LQR_SCRATCH_CHUNK CLASS DEFINITION ****/
+/* a map allocated by the carver, either file-backed
+ * (and mapped in memory) or on the heap */
+struct _LqrScratchChunk;
+
+typedef struct _LqrScratchChunk LqrScratchChunk;
+
+struct _LqrScratchChunk {
+    gpointer addr;                      /* start of the mapped region */
+    gsize size;                         /* size of the mapped region */
+    gboolean mapped;                    /* whether the map is file-backed */
+    LqrScratchChunk *next;
+};
+
+/* allocation macros for the (large) per-pixel maps */
+#define LQR_SCRATCH_TRY_NEW(r, struct_type, n_structs) \
+    ((struct_type *) lqr_carver_scratch_try_alloc((r), sizeof(struct_type) * (gsize) (n_structs), FALSE))
+#define LQR_SCRATCH_TRY_NEW0(r, struct_type, n_structs) \
+    ((struct_type *) lqr_carver_scratch_try_alloc((r), sizeof(struct_type) * (gsize) (n_structs), TRUE))
+
+/* LQR_CARVER_SCRATCH PRIVATE FUNCTIONS */
+
+gpointer lqr_carver_scratch_try_map(LqrCarver *r, gsize n_bytes);
+gpointer lqr_carver_scratch_try_alloc(LqrCarver *r, gsize n_bytes, gboolean clear);
+void lqr_carver_scratch_free(LqrCarver *r, gpointer mem);
+void lqr_carver_scratch_advise(LqrCarver *r, gboolean sequential);
+void lqr_carver_scratch_destroy(LqrCarver *r);
+LqrRetVal lqr_carver_scratch_set_dir_attached(LqrCarver *r, LqrDataTok data);
+LqrRetVal lqr_carver_scratch_set_threshold_attached(LqrCarver *r, LqrDataTok data);
+
+#endif /* __LQR_CARVER_SCRATCH_PRIV_H__ */
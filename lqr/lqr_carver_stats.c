@@ -0,0 +1,125 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <lqr/lqr_all.h>
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_CARVER_STATS FUNCTIONS ****/
+
+/* the counters are only updated when collection is turned on,
+ * so that a carver which doesn't ask for them doesn't pay for the
+ * timer calls; each carver keeps its own counters (attached carvers
+ * included), hence no locking is needed */
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_collect_stats(LqrCarver *r, gboolean collect)
+{
+    if (collect && (r->stats_timer == NULL)) {
+        LQR_CATCH_MEM(r->stats_timer = g_timer_new());
+    }
+    r->collect_stats = collect;
+    lqr_carver_stats_sample_bytes(r);
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_get_stats(LqrCarver *r, LqrCarverStats *stats)
+{
+    LqrCarverStats *s;
+
+    LQR_CATCH_F(stats != NULL);
+
+    s = &r->stats;
+    *stats = *s;
+
+    stats->points = s->build_emap.points + s->update_emap.points + s->build_mmap.points + s->update_mmap.points +
+        s->build_vpath.points + s->carve.points + s->inflate.points + s->flatten.points + s->transpose.points +
+        s->rcache.points;
+    stats->update_mmap_avg_span = r->stats_mmap_rows ? (gdouble) s->update_mmap.points / r->stats_mmap_rows : 0;
+
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+void
+lqr_carver_reset_stats(LqrCarver *r)
+{
+    memset(&r->stats, 0, sizeof(LqrCarverStats));
+    r->stats_mmap_rows = 0;
+    lqr_carver_stats_sample_bytes(r);
+}
+
+/* returns the starting time of a phase */
+gdouble
+lqr_carver_stats_start(LqrCarver *r)
+{
+    if (!r->collect_stats) {
+        return 0;
+    }
+    return g_timer_elapsed(r->stats_timer, NULL);
+}
+
+/* accounts for a phase started at t0 */
+void
+lqr_carver_stats_stop(LqrCarver *r, LqrPhaseStats *phase, gdouble t0, guint64 points)
+{
+    if (!r->collect_stats) {
+        return;
+    }
+    phase->calls++;
+    phase->time += g_timer_elapsed(r->stats_timer, NULL) - t0;
+    phase->points += points;
+}
+
+/* accounts for a phase which was run interleaved with other
+ * ones, and whose time was measured piecewise */
+void
+lqr_carver_stats_add(LqrCarver *r, LqrPhaseStats *phase, gdouble time, guint64 points)
+{
+    if (!r->collect_stats) {
+        return;
+    }
+    phase->calls++;
+    phase->time += time;
+    phase->points += points;
+}
+
+/* update the peak memory usage of the maps (this is
+ * called whenever a map is allocated) */
+void
+lqr_carver_stats_sample_bytes(LqrCarver *r)
+{
+    if (!r->collect_stats) {
+        return;
+    }
+    r->stats.peak_map_bytes = MAX(r->stats.peak_map_bytes, r->map_bytes);
+}
@@ -0,0 +1,76 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_CARVER_STATS_PUB_H__
+#define __LQR_CARVER_STATS_PUB_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_carver_stats_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/**** LQR_PHASE_STATS STRUCT DEFINITION ****/
+/* counters for a single phase of the computation */
+struct _LqrPhaseStats;
+
+typedef struct _LqrPhaseStats LqrPhaseStats;
+
+struct _LqrPhaseStats {
+    guint64 calls;                      /* number of times the phase was run */
+    gdouble time;                       /* total wall-clock time, in seconds */
+    guint64 points;                     /* number of map points processed */
+};
+
+/**** LQR_CARVER_STATS STRUCT DEFINITION ****/
+/* counters for all the phases of the computation */
+struct _LqrCarverStats;
+
+typedef struct _LqrCarverStats LqrCarverStats;
+
+struct _LqrCarverStats {
+    LqrPhaseStats build_emap;           /* full energy map computation */
+    LqrPhaseStats update_emap;          /* energy map update after each seam */
+    LqrPhaseStats build_mmap;           /* full minpath map computation */
+    LqrPhaseStats update_mmap;          /* minpath map update after each seam */
+    LqrPhaseStats build_vpath;          /* seam extraction */
+    LqrPhaseStats carve;                /* seam removal */
+    LqrPhaseStats inflate;              /* seam insertion (enlargement) */
+    LqrPhaseStats flatten;              /* flattening */
+    LqrPhaseStats transpose;            /* transposition */
+    LqrPhaseStats rcache;               /* generation of the readout cache */
+    LqrPhaseStats update_seam;          /* combined carve and map updates after each seam; its
+                                         * time is also split among carve, update_emap and
+                                         * update_mmap, and must not be added to theirs */
+    gdouble update_mmap_avg_span;       /* average width of the rows updated by update_mmap */
+    guint64 points;                     /* total number of map points processed */
+    gsize peak_map_bytes;               /* peak number of bytes allocated for the carver's maps
+                                         * (heap or file-backed) since the counters were reset;
+                                         * the input buffer and the per-row arrays are not
+                                         * included */
+};
+
+/* PUBLIC STATS-RELATED FUNCTIONS */
+
+LQR_PUBLIC LqrRetVal lqr_carver_set_collect_stats(LqrCarver *r, gboolean collect);
+LQR_PUBLIC LqrRetVal lqr_carver_get_stats(LqrCarver *r, LqrCarverStats *stats);
+LQR_PUBLIC void lqr_carver_reset_stats(LqrCarver *r);
+
+#endif /* __LQR_CARVER_STATS_PUB_H__ */
@@ -78,7 +78,7 @@ lqr_cursor_reset(LqrCursor *c)
     c->now = 0;
 
     /* skip invisible points */
-    while ((c->o->vs[c->now] != 0) && (c->o->vs[c->now] < c->o->level)) {
+    while ((VS_GET(c->o, c->now) != 0) && (VS_GET(c->o, c->now) < c->o->level)) {
         c->now++;
 #ifdef __LQR_DEBUG__
         assert(c->now < c->o->w0);
@@ -122,7 +122,7 @@ lqr_cursor_next(LqrCursor *c)
 #endif /* __LQR_DEBUG__ */
 
     /* skip invisible points */
-    while ((c->o->vs[c->now] != 0) && (c->o->vs[c->now] < c->o->level)) {
+    while ((VS_GET(c->o, c->now) != 0) && (VS_GET(c->o, c->now) < c->o->level)) {
         c->now++;
 #ifdef __LQR_DEBUG__
         assert(c->now < (c->o->w0 * c->o->h0));
@@ -161,7 +161,7 @@ lqr_cursor_prev(LqrCursor *c)
 #endif /* __LQR_DEBUG__ */
 
     /* skip invisible points */
-    while ((c->o->vs[c->now] != 0) && (c->o->vs[c->now] < c->o->level)) {
+    while ((VS_GET(c->o, c->now) != 0) && (VS_GET(c->o, c->now) < c->o->level)) {
         c->now--;
 #ifdef __LQR_DEBUG__
         assert(c->now >= 0);
@@ -193,7 +193,7 @@ lqr_cursor_left(LqrCursor *c)
 #endif /* __LQR_DEBUG__ */
 
     /* skip invisible points */
-    while ((c->o->vs[ret] != 0) && c->o->vs[ret] < c->o->level) {
+    while ((VS_GET(c->o, ret) != 0) && VS_GET(c->o, ret) < c->o->level) {
         ret--;
 #ifdef __LQR_DEBUG__
         assert(ret >= 0);
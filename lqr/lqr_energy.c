@@ -35,6 +35,9 @@
 #include <lqr/lqr_vmap.h>
 #include <lqr/lqr_vmap_list.h>
 #include <lqr/lqr_carver_list.h>
+#include <lqr/lqr_carver_scratch.h>
+#include <lqr/lqr_carver_stats.h>
+#include <lqr/lqr_trace.h>
 #include <lqr/lqr_carver.h>
 
 #ifdef __LQR_DEBUG__
@@ -45,7 +48,7 @@
 /* read normalised pixel value from
  * rgb buffer at the given index */
 gdouble
-lqr_pixel_get_norm(void *rgb, gint rgb_ind, LqrColDepth col_depth)
+lqr_pixel_get_norm(void *rgb, gsize rgb_ind, LqrColDepth col_depth)
 {
     switch (col_depth) {
         case LQR_COLDEPTH_8I:
@@ -67,7 +70,7 @@ lqr_pixel_get_norm(void *rgb, gint rgb_ind, LqrColDepth col_depth)
 /* write pixel from normalised value
  * in rgb buffer at the given index */
 void
-lqr_pixel_set_norm(gdouble val, void *rgb, gint rgb_ind, LqrColDepth col_depth)
+lqr_pixel_set_norm(gdouble val, void *rgb, gsize rgb_ind, LqrColDepth col_depth)
 {
     switch (col_depth) {
         case LQR_COLDEPTH_8I:
@@ -91,7 +94,7 @@ lqr_pixel_set_norm(gdouble val, void *rgb, gint rgb_ind, LqrColDepth col_depth)
 }
 
 gdouble
-lqr_pixel_get_rgbcol(void *rgb, gint rgb_ind, LqrColDepth col_depth, LqrImageType image_type, gint channel)
+lqr_pixel_get_rgbcol(void *rgb, gsize rgb_ind, LqrColDepth col_depth, LqrImageType image_type, gint channel)
 {
     gdouble black_fact = 0;
 
@@ -116,19 +119,17 @@ lqr_pixel_get_rgbcol(void *rgb, gint rgb_ind, LqrColDepth col_depth, LqrImageTyp
 }
 
 gdouble
-lqr_carver_read_brightness_grey(LqrCarver *r, gint x, gint y)
+lqr_carver_read_brightness_grey(LqrCarver *r, gint now)
 {
-    gint now = r->raw[y][x];
-    gint rgb_ind = now * r->channels;
+    gsize rgb_ind = (gsize) now * r->channels;
     return lqr_pixel_get_norm(r->rgb, rgb_ind, r->col_depth);
 }
 
 gdouble
-lqr_carver_read_brightness_std(LqrCarver *r, gint x, gint y)
+lqr_carver_read_brightness_std(LqrCarver *r, gint now)
 {
     gdouble red, green, blue;
-    gint now = r->raw[y][x];
-    gint rgb_ind = now * r->channels;
+    gsize rgb_ind = (gsize) now * r->channels;
 
     red = lqr_pixel_get_rgbcol(r->rgb, rgb_ind, r->col_depth, r->image_type, 0);
     green = lqr_pixel_get_rgbcol(r->rgb, rgb_ind, r->col_depth, r->image_type, 1);
@@ -137,7 +138,7 @@ lqr_carver_read_brightness_std(LqrCarver *r, gint x, gint y)
 }
 
 gdouble
-lqr_carver_read_brightness_custom(LqrCarver *r, gint x, gint y)
+lqr_carver_read_brightness_custom(LqrCarver *r, gint now)
 {
     gdouble sum = 0;
     gint k;
@@ -147,15 +148,13 @@ lqr_carver_read_brightness_custom(LqrCarver *r, gint x, gint y)
 
     gdouble black_fact = 0;
 
-    gint now = r->raw[y][x];
-
     if (has_black) {
-        black_fact = lqr_pixel_get_norm(r->rgb, now * r->channels + r->black_channel, r->col_depth);
+        black_fact = lqr_pixel_get_norm(r->rgb, (gsize) now * r->channels + r->black_channel, r->col_depth);
     }
 
     for (k = 0; k < r->channels; k++) {
         if ((k != r->alpha_channel) && (k != r->black_channel)) {
-            gdouble col = lqr_pixel_get_norm(r->rgb, now * r->channels + k, r->col_depth);
+            gdouble col = lqr_pixel_get_norm(r->rgb, (gsize) now * r->channels + k, r->col_depth);
             sum += 1. - (1. - col) * (1. - black_fact);
         }
     }
@@ -169,48 +168,53 @@ lqr_carver_read_brightness_custom(LqrCarver *r, gint x, gint y)
     return sum;
 }
 
-/* read average pixel value at x, y
+/* read average pixel value at point now
  * for energy computation */
 gdouble
-lqr_carver_read_brightness(LqrCarver *r, gint x, gint y)
+lqr_carver_read_brightness_at(LqrCarver *r, gint now)
 {
     gint has_alpha = (r->alpha_channel >= 0 ? 1 : 0);
     gdouble alpha_fact = 1;
 
-    gint now = r->raw[y][x];
-
     gdouble bright = 0;
 
     switch (r->image_type) {
         case LQR_GREY_IMAGE:
         case LQR_GREYA_IMAGE:
-            bright = lqr_carver_read_brightness_grey(r, x, y);
+            bright = lqr_carver_read_brightness_grey(r, now);
             break;
         case LQR_RGB_IMAGE:
         case LQR_RGBA_IMAGE:
         case LQR_CMY_IMAGE:
         case LQR_CMYK_IMAGE:
         case LQR_CMYKA_IMAGE:
-            bright = lqr_carver_read_brightness_std(r, x, y);
+            bright = lqr_carver_read_brightness_std(r, now);
             break;
         case LQR_CUSTOM_IMAGE:
-            bright = lqr_carver_read_brightness_custom(r, x, y);
+            bright = lqr_carver_read_brightness_custom(r, now);
             break;
     }
 
     if (has_alpha) {
-        alpha_fact = lqr_pixel_get_norm(r->rgb, now * r->channels + r->alpha_channel, r->col_depth);
+        alpha_fact = lqr_pixel_get_norm(r->rgb, (gsize) now * r->channels + r->alpha_channel, r->col_depth);
     }
 
     return bright * alpha_fact;
 }
 
+/* read average pixel value at x, y
+ * for energy computation */
 gdouble
-lqr_carver_read_luma_std(LqrCarver *r, gint x, gint y)
+lqr_carver_read_brightness(LqrCarver *r, gint x, gint y)
+{
+    return lqr_carver_read_brightness_at(r, r->raw[y][x]);
+}
+
+gdouble
+lqr_carver_read_luma_std(LqrCarver *r, gint now)
 {
     gdouble red, green, blue;
-    gint now = r->raw[y][x];
-    gint rgb_ind = now * r->channels;
+    gsize rgb_ind = (gsize) now * r->channels;
 
     red = lqr_pixel_get_rgbcol(r->rgb, rgb_ind, r->col_depth, r->image_type, 0);
     green = lqr_pixel_get_rgbcol(r->rgb, rgb_ind, r->col_depth, r->image_type, 1);
@@ -219,45 +223,47 @@ lqr_carver_read_luma_std(LqrCarver *r, gint x, gint y)
 }
 
 gdouble
-lqr_carver_read_luma(LqrCarver *r, gint x, gint y)
+lqr_carver_read_luma_at(LqrCarver *r, gint now)
 {
     gint has_alpha = (r->alpha_channel >= 0 ? 1 : 0);
     gdouble alpha_fact = 1;
 
-    gint now = r->raw[y][x];
-
     gdouble bright = 0;
 
     switch (r->image_type) {
         case LQR_GREY_IMAGE:
         case LQR_GREYA_IMAGE:
-            bright = lqr_carver_read_brightness_grey(r, x, y);
+            bright = lqr_carver_read_brightness_grey(r, now);
             break;
         case LQR_RGB_IMAGE:
         case LQR_RGBA_IMAGE:
         case LQR_CMY_IMAGE:
         case LQR_CMYK_IMAGE:
         case LQR_CMYKA_IMAGE:
-            bright = lqr_carver_read_luma_std(r, x, y);
+            bright = lqr_carver_read_luma_std(r, now);
             break;
         case LQR_CUSTOM_IMAGE:
-            bright = lqr_carver_read_brightness_custom(r, x, y);
+            bright = lqr_carver_read_brightness_custom(r, now);
             break;
     }
 
     if (has_alpha) {
-        alpha_fact = lqr_pixel_get_norm(r->rgb, now * r->channels + r->alpha_channel, r->col_depth);
+        alpha_fact = lqr_pixel_get_norm(r->rgb, (gsize) now * r->channels + r->alpha_channel, r->col_depth);
     }
 
     return bright * alpha_fact;
 }
 
 gdouble
-lqr_carver_read_rgba(LqrCarver *r, gint x, gint y, gint channel)
+lqr_carver_read_luma(LqrCarver *r, gint x, gint y)
 {
-    gint has_alpha = (r->alpha_channel >= 0 ? 1 : 0);
+    return lqr_carver_read_luma_at(r, r->raw[y][x]);
+}
 
-    gint now = r->raw[y][x];
+gdouble
+lqr_carver_read_rgba_at(LqrCarver *r, gint now, gint channel)
+{
+    gint has_alpha = (r->alpha_channel >= 0 ? 1 : 0);
 
 #ifdef __LQR_DEBUG__
     assert(channel >= 0 && channel < 4);
@@ -267,13 +273,13 @@ lqr_carver_read_rgba(LqrCarver *r, gint x, gint y, gint channel)
         switch (r->image_type) {
             case LQR_GREY_IMAGE:
             case LQR_GREYA_IMAGE:
-                return lqr_carver_read_brightness_grey(r, x, y);
+                return lqr_carver_read_brightness_grey(r, now);
             case LQR_RGB_IMAGE:
             case LQR_RGBA_IMAGE:
             case LQR_CMY_IMAGE:
             case LQR_CMYK_IMAGE:
             case LQR_CMYKA_IMAGE:
-                return lqr_pixel_get_rgbcol(r->rgb, now * r->channels, r->col_depth, r->image_type, channel);
+                return lqr_pixel_get_rgbcol(r->rgb, (gsize) now * r->channels, r->col_depth, r->image_type, channel);
             case LQR_CUSTOM_IMAGE:
                 return 0;
             default:
@@ -283,18 +289,28 @@ lqr_carver_read_rgba(LqrCarver *r, gint x, gint y, gint channel)
                 return 0;
         }
     } else if (has_alpha) {
-        return lqr_pixel_get_norm(r->rgb, now * r->channels + r->alpha_channel, r->col_depth);
+        return lqr_pixel_get_norm(r->rgb, (gsize) now * r->channels + r->alpha_channel, r->col_depth);
     } else {
         return 1;
     }
 }
 
 gdouble
-lqr_carver_read_custom(LqrCarver *r, gint x, gint y, gint channel)
+lqr_carver_read_rgba(LqrCarver *r, gint x, gint y, gint channel)
+{
+    return lqr_carver_read_rgba_at(r, r->raw[y][x], channel);
+}
+
+gdouble
+lqr_carver_read_custom_at(LqrCarver *r, gint now, gint channel)
 {
-    gint now = r->raw[y][x];
+    return lqr_pixel_get_norm(r->rgb, (gsize) now * r->channels + channel, r->col_depth);
+}
 
-    return lqr_pixel_get_norm(r->rgb, now * r->channels + channel, r->col_depth);
+gdouble
+lqr_carver_read_custom(LqrCarver *r, gint x, gint y, gint channel)
+{
+    return lqr_carver_read_custom_at(r, r->raw[y][x], channel);
 }
 
 gdouble
@@ -310,7 +326,7 @@ lqr_carver_read_cached_rgba(LqrCarver *r, gint x, gint y, gint channel)
 {
     gint z0 = r->raw[y][x];
 
-    return r->rcache[z0 * 4 + channel];
+    return r->rcache[(gsize) z0 * 4 + channel];
 }
 
 gdouble
@@ -318,7 +334,7 @@ lqr_carver_read_cached_custom(LqrCarver *r, gint x, gint y, gint channel)
 {
     gint z0 = r->raw[y][x];
 
-    return r->rcache[z0 * r->channels + channel];
+    return r->rcache[(gsize) z0 * r->channels + channel];
 }
 
 gfloat
@@ -433,9 +449,10 @@ lqr_carver_set_energy_function(LqrCarver *r, LqrEnergyFunc en_func, gint radius,
     r->nrg_read_t = reader_type;
     r->nrg_extra_data = extra_data;
 
-    g_free(r->rcache);
+    lqr_carver_scratch_free(r, r->rcache);
     r->rcache = NULL;
     r->nrg_uptodate = FALSE;
+    lqr_carver_base_maps_free(r);
 
     lqr_rwindow_destroy(r->rwindow);
 
@@ -448,6 +465,65 @@ lqr_carver_set_energy_function(LqrCarver *r, LqrEnergyFunc en_func, gint radius,
     return LQR_OK;
 }
 
+/* use a precomputed energy map (e.g. a saliency map), given in image
+ * order at the current size of the image; the energy of each point is
+ * buffer + function_weight * (energy function); with a zero weight the
+ * energy function is not evaluated at all and the energy map does not
+ * need to be updated after each seam */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_energy_buffer(LqrCarver *r, gfloat *buffer, gfloat function_weight)
+{
+    gint x, y;
+    gint xt, yt;
+    gint wt, ht;
+
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_F(buffer != NULL);
+    LQR_CATCH_CANC(r);
+
+    if (r->nrg_active == FALSE) {
+        LQR_CATCH(lqr_carver_init_energy_related(r));
+    }
+
+    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
+        LQR_CATCH(lqr_carver_flatten(r));
+    }
+
+    if (r->nrg_buffer == NULL) {
+        LQR_CATCH_MEM(r->nrg_buffer = LQR_SCRATCH_TRY_NEW(r, gfloat, (gsize) r->w0 * r->h0));
+    }
+
+    wt = r->transposed ? r->h : r->w;
+    ht = r->transposed ? r->w : r->h;
+
+    for (y = 0; y < ht; y++) {
+        for (x = 0; x < wt; x++) {
+            xt = r->transposed ? y : x;
+            yt = r->transposed ? x : y;
+
+            r->nrg_buffer[yt * r->w0 + xt] = buffer[y * wt + x];
+        }
+    }
+
+    r->nrg_func_weight = function_weight;
+    r->nrg_uptodate = FALSE;
+    lqr_carver_base_maps_free(r);
+
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+void
+lqr_carver_clear_energy_buffer(LqrCarver *r)
+{
+    lqr_carver_scratch_free(r, r->nrg_buffer);
+    r->nrg_buffer = NULL;
+    r->nrg_func_weight = 1;
+    r->nrg_uptodate = FALSE;
+    lqr_carver_base_maps_free(r);
+}
+
 gdouble *
 lqr_carver_generate_rcache_bright(LqrCarver *r)
 {
@@ -455,9 +531,13 @@ lqr_carver_generate_rcache_bright(LqrCarver *r)
     gint x, y;
     gint z0;
 
-    LQR_TRY_N_N(buffer = g_try_new(gdouble, r->w0 * r->h0));
+    LQR_TRY_N_N(buffer = LQR_SCRATCH_TRY_NEW(r, gdouble, (gsize) r->w0 * r->h0));
 
     for (y = 0; y < r->h; y++) {
+        if (LQR_CANC_ROW(r, y)) {
+            lqr_carver_scratch_free(r, buffer);
+            return NULL;
+        }
         for (x = 0; x < r->w; x++) {
             z0 = r->raw[y][x];
             buffer[z0] = lqr_carver_read_brightness(r, x, y);
@@ -474,9 +554,13 @@ lqr_carver_generate_rcache_luma(LqrCarver *r)
     gint x, y;
     gint z0;
 
-    LQR_TRY_N_N(buffer = g_try_new(gdouble, r->w0 * r->h0));
+    LQR_TRY_N_N(buffer = LQR_SCRATCH_TRY_NEW(r, gdouble, (gsize) r->w0 * r->h0));
 
     for (y = 0; y < r->h; y++) {
+        if (LQR_CANC_ROW(r, y)) {
+            lqr_carver_scratch_free(r, buffer);
+            return NULL;
+        }
         for (x = 0; x < r->w; x++) {
             z0 = r->raw[y][x];
             buffer[z0] = lqr_carver_read_luma(r, x, y);
@@ -493,13 +577,17 @@ lqr_carver_generate_rcache_rgba(LqrCarver *r)
     gint x, y, k;
     gint z0;
 
-    LQR_TRY_N_N(buffer = g_try_new(gdouble, r->w0 * r->h0 * 4));
+    LQR_TRY_N_N(buffer = LQR_SCRATCH_TRY_NEW(r, gdouble, (gsize) r->w0 * r->h0 * 4));
 
     for (y = 0; y < r->h; y++) {
+        if (LQR_CANC_ROW(r, y)) {
+            lqr_carver_scratch_free(r, buffer);
+            return NULL;
+        }
         for (x = 0; x < r->w; x++) {
             z0 = r->raw[y][x];
             for (k = 0; k < 4; k++) {
-                buffer[z0 * 4 + k] = lqr_carver_read_rgba(r, x, y, k);
+                buffer[(gsize) z0 * 4 + k] = lqr_carver_read_rgba(r, x, y, k);
             }
         }
     }
@@ -514,13 +602,17 @@ lqr_carver_generate_rcache_custom(LqrCarver *r)
     gint x, y, k;
     gint z0;
 
-    LQR_TRY_N_N(buffer = g_try_new(gdouble, r->w0 * r->h0 * r->channels));
+    LQR_TRY_N_N(buffer = LQR_SCRATCH_TRY_NEW(r, gdouble, (gsize) r->w0 * r->h0 * r->channels));
 
     for (y = 0; y < r->h; y++) {
+        if (LQR_CANC_ROW(r, y)) {
+            lqr_carver_scratch_free(r, buffer);
+            return NULL;
+        }
         for (x = 0; x < r->w; x++) {
             z0 = r->raw[y][x];
             for (k = 0; k < r->channels; k++) {
-                buffer[z0 * r->channels + k] = lqr_carver_read_custom(r, x, y, k);
+                buffer[(gsize) z0 * r->channels + k] = lqr_carver_read_custom(r, x, y, k);
             }
         }
     }
@@ -528,6 +620,8 @@ lqr_carver_generate_rcache_custom(LqrCarver *r)
     return buffer;
 }
 
+/* generate the readout cache; NULL is returned
+ * on failure and when the carver is cancelled */
 gdouble *
 lqr_carver_generate_rcache(LqrCarver *r)
 {
@@ -552,55 +646,221 @@ lqr_carver_generate_rcache(LqrCarver *r)
     }
 }
 
-/* LQR_PUBLIC */
+/* read the energy-reader values of point now into values
+ * (as many as the reading window channels) */
+void
+lqr_carver_read_values_at(LqrCarver *r, gint now, gdouble *values)
+{
+    gint k;
+
+    switch (r->nrg_read_t) {
+        case LQR_ER_BRIGHTNESS:
+            values[0] = lqr_carver_read_brightness_at(r, now);
+            break;
+        case LQR_ER_LUMA:
+            values[0] = lqr_carver_read_luma_at(r, now);
+            break;
+        case LQR_ER_RGBA:
+            for (k = 0; k < 4; k++) {
+                values[k] = lqr_carver_read_rgba_at(r, now, k);
+            }
+            break;
+        case LQR_ER_CUSTOM:
+            for (k = 0; k < r->channels; k++) {
+                values[k] = lqr_carver_read_custom_at(r, now, k);
+            }
+            break;
+        default:
+#ifdef __LQR_DEBUG__
+            assert(0);
+#endif /* __LQR_DEBUG__ */
+            break;
+    }
+}
+
+/* compute the energy of the currently visible image, as seen for
+ * carving in the given orientation, into buffer (in image order).
+ * The carver is left untouched: the visibility map is walked directly
+ * (the cursor and the raw map are not used) and the energy function
+ * is fed through a private reading window */
 LqrRetVal
-lqr_carver_get_energy(LqrCarver *r, gfloat *buffer, gint orientation)
+lqr_carver_compute_energy_view(LqrCarver *r, gfloat *buffer, gint orientation, gboolean saturate)
+{
+    LqrReadingWindow *rwindow;
+    gint *view;
+    gdouble *values;
+    gint w, h, w1, h1;
+    gint x, y, x1, y1;
+    gint z0, z1;
+    gint now;
+    gint channels;
+    gfloat nrg;
+    gfloat nrg_max, quant_max, quant_scale;
+    LqrRetVal ret_val = LQR_OK;
+
+    /* size of the image in the requested orientation */
+    w = lqr_carver_get_width(r);
+    h = lqr_carver_get_height(r);
+    w1 = orientation == 0 ? w : h;
+    h1 = orientation == 0 ? h : w;
+
+    if (r->nrg_read_t == LQR_ER_CUSTOM) {
+        LQR_CATCH_MEM(rwindow = lqr_rwindow_new_custom(r->nrg_radius, FALSE, r->channels));
+    } else {
+        LQR_CATCH_MEM(rwindow = lqr_rwindow_new(r->nrg_radius, r->nrg_read_t, FALSE));
+    }
+    channels = lqr_rwindow_get_channels(rwindow);
+
+    view = g_try_new(gint, w1 * h1);
+    values = view != NULL ? g_try_new(gdouble, (gsize) w1 * h1 * channels) : NULL;
+    if (values == NULL) {
+        g_free(view);
+        lqr_rwindow_destroy(rwindow);
+        return LQR_NOMEM;
+    }
+
+    /* span the visible points (as the cursor does) and
+     * read them in the requested orientation */
+    now = 0;
+    for (y = 0; y < r->h; y++) {
+        for (x = 0; x < r->w; x++) {
+            while ((VS_GET(r, now) != 0) && (VS_GET(r, now) < r->level)) {
+                now++;
+            }
+            if ((r->transposed ? 1 : 0) == orientation) {
+                z1 = y * w1 + x;
+            } else {
+                z1 = x * w1 + y;
+            }
+            view[z1] = now;
+            lqr_carver_read_values_at(r, now, values + (gsize) z1 * channels);
+            now++;
+        }
+    }
+
+    for (y1 = 0; y1 < h1 && ret_val == LQR_OK; y1++) {
+        if (LQR_CANC_ROW(r, y1)) {
+            ret_val = LQR_USRCANCEL;
+            break;
+        }
+        for (x1 = 0; x1 < w1; x1++) {
+            z1 = y1 * w1 + x1;
+            ret_val = lqr_rwindow_fill_from_buffer(rwindow, r, values, w1, h1, x1, y1);
+            if (ret_val != LQR_OK) {
+                break;
+            }
+            if (r->nrg_buffer != NULL) {
+                nrg = r->nrg_buffer[view[z1]];
+                if (r->nrg_func_weight != 0) {
+                    nrg += r->nrg_func_weight * r->nrg(x1, y1, w1, h1, rwindow, r->nrg_extra_data);
+                }
+            } else {
+                nrg = r->nrg(x1, y1, w1, h1, rwindow, r->nrg_extra_data);
+            }
+            if (r->bias != NULL) {
+                nrg += r->bias[view[z1]] / w1;
+            }
+            /* the buffer is always in image order */
+            z0 = orientation == 0 ? z1 : x1 * w + y1;
+            buffer[z0] = nrg;
+        }
+    }
+
+    if (ret_val == LQR_OK) {
+        /* same levels as lqr_carver_quantize_emap() would choose
+         * for this view, undone as in the flat readout */
+        if (r->nrg_quant) {
+            nrg_max = 0;
+            for (z0 = 0; z0 < w1 * h1; z0++) {
+                nrg_max = MAX(nrg_max, fabsf(buffer[z0]));
+            }
+            if (nrg_max == 0) {
+                nrg_max = 1;
+            }
+            quant_max = (gfloat) MIN(LQR_QUANT_LEVELS, LQR_QUANT_M_MAX / h1);
+            quant_scale = quant_max / nrg_max;
+            for (z0 = 0; z0 < w1 * h1; z0++) {
+                nrg = rintf(buffer[z0] * quant_scale);
+                buffer[z0] = CLAMP(nrg, -quant_max, quant_max) / quant_scale;
+            }
+        }
+        if (saturate) {
+            for (z0 = 0; z0 < w1 * h1; z0++) {
+                buffer[z0] = LQR_SATURATE(buffer[z0]);
+            }
+        }
+    }
+
+    g_free(values);
+    g_free(view);
+    lqr_rwindow_destroy(rwindow);
+
+    return ret_val;
+}
+
+/* fill buffer with the (possibly saturated) energy of the visible
+ * image for the given orientation; the carver state is only touched
+ * when it is already flat and in that orientation, in which case the
+ * energy map is just brought up to date and read out */
+LqrRetVal
+lqr_carver_export_energy(LqrCarver *r, gfloat *buffer, gint orientation, gboolean saturate)
 {
     gint x, y;
     gint z0 = 0;
     gint w, h;
-    gint buf_size;
     gint data;
-    gfloat nrg;
-    gfloat nrg_min = G_MAXFLOAT;
-    gfloat nrg_max = 0;
-
-    LQR_CATCH_F(orientation == 0 || orientation == 1);
-    LQR_CATCH_CANC(r);
-    LQR_CATCH_F(buffer != NULL);
+    gfloat nrg, scale;
 
     if (r->nrg_active == FALSE) {
         LQR_CATCH(lqr_carver_init_energy_related(r));
     }
 
-    if (r->w != r->w_start - r->max_level + 1) {
-#ifdef __LQR_DEBUG__
-        assert(r->active);
-#endif /* __LQR_DEBUG__ */
-        LQR_CATCH(lqr_carver_flatten(r));
+    if (r->w != r->w_start - r->max_level + 1 || orientation != lqr_carver_get_orientation(r)) {
+        return lqr_carver_compute_energy_view(r, buffer, orientation, saturate);
     }
 
-    buf_size = r->w * r->h;
-
-    if (orientation != lqr_carver_get_orientation(r)) {
-        LQR_CATCH(lqr_carver_transpose(r));
-    }
     LQR_CATCH(lqr_carver_build_emap(r));
 
     w = lqr_carver_get_width(r);
     h = lqr_carver_get_height(r);
 
+    /* undo the quantization scale */
+    scale = r->nrg_quant_scale > 0 ? 1 / r->nrg_quant_scale : 1;
+
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
             data = orientation == 0 ? r->raw[y][x] : r->raw[x][y];
-            /* nrg = tanhf(r->en[data]); */
-            nrg = LQR_SATURATE(r->en[data]);
-            nrg_max = MAX(nrg_max, nrg);
-            nrg_min = MIN(nrg_min, nrg);
-            buffer[z0++] = nrg;
+            nrg = r->en[data] * scale;
+            /* nrg = tanhf(nrg); */
+            buffer[z0++] = saturate ? LQR_SATURATE(nrg) : nrg;
         }
     }
 
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_get_energy(LqrCarver *r, gfloat *buffer, gint orientation)
+{
+    gint z0;
+    gint buf_size;
+    gfloat nrg_min = G_MAXFLOAT;
+    gfloat nrg_max = 0;
+
+    LQR_CATCH_F(orientation == 0 || orientation == 1);
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(buffer != NULL);
+
+    LQR_CATCH(lqr_carver_export_energy(r, buffer, orientation, TRUE));
+
+    buf_size = r->w * r->h;
+
+    for (z0 = 0; z0 < buf_size; z0++) {
+        nrg_max = MAX(nrg_max, buffer[z0]);
+        nrg_min = MIN(nrg_min, buffer[z0]);
+    }
+
     if (nrg_max > nrg_min) {
         for (z0 = 0; z0 < buf_size; z0++) {
             buffer[z0] = (buffer[z0] - nrg_min) / (nrg_max - nrg_min);
@@ -614,63 +874,73 @@ lqr_carver_get_energy(LqrCarver *r, gfloat *buffer, gint orientation)
 LqrRetVal
 lqr_carver_get_true_energy(LqrCarver *r, gfloat *buffer, gint orientation)
 {
-    gint x, y;
-    gint z0 = 0;
-    gint w, h;
-    gint data;
-
     LQR_CATCH_F(orientation == 0 || orientation == 1);
     LQR_CATCH_CANC(r);
     LQR_CATCH_F(buffer != NULL);
 
-    if (r->nrg_active == FALSE) {
-        LQR_CATCH(lqr_carver_init_energy_related(r));
-    }
+    LQR_CATCH(lqr_carver_export_energy(r, buffer, orientation, FALSE));
 
-    if (r->w != r->w_start - r->max_level + 1) {
-#ifdef __LQR_DEBUG__
-        assert(r->active);
-#endif /* __LQR_DEBUG__ */
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
+    return LQR_OK;
+}
 
-    if (orientation != lqr_carver_get_orientation(r)) {
-        LQR_CATCH(lqr_carver_transpose(r));
-    }
-    LQR_CATCH(lqr_carver_build_emap(r));
+/* write normalised energy values into an image buffer; each channel
+ * is an affine function (offset + factor * nrg) of the energy, so that
+ * the colour depth and colour model dispatch is done once per channel
+ * rather than once per sample */
+#define LQR_ENERGY_IMAGE_FILL(type, conv, scale) G_STMT_START { \
+    type *out = (type *) buffer; \
+    for (k = 0; k < channels; k++) { \
+        for (z0 = 0; z0 < size; z0++) { \
+            out[(gsize) z0 * channels + k] = conv((gdouble) (offset[k] + factor[k] * nrg[z0]) * (scale)); \
+        } \
+    } \
+} G_STMT_END
 
-    w = lqr_carver_get_width(r);
-    h = lqr_carver_get_height(r);
+void
+lqr_energy_image_fill(void *buffer, const gfloat *nrg, gint size, gint channels, const gfloat *offset,
+                      const gfloat *factor, LqrColDepth col_depth)
+{
+    gint z0, k;
 
-    for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) {
-            data = orientation == 0 ? r->raw[y][x] : r->raw[x][y];
-            /* nrg = tanhf(r->en[data]); */
-            buffer[z0++] = r->en[data];
-        }
+    switch (col_depth) {
+        case LQR_COLDEPTH_8I:
+            LQR_ENERGY_IMAGE_FILL(lqr_t_8i, AS0_8I, 0xFF);
+            break;
+        case LQR_COLDEPTH_16I:
+            LQR_ENERGY_IMAGE_FILL(lqr_t_16i, AS0_16I, 0xFFFF);
+            break;
+        case LQR_COLDEPTH_32F:
+            LQR_ENERGY_IMAGE_FILL(lqr_t_32f, AS0_32F, 1);
+            break;
+        case LQR_COLDEPTH_64F:
+            LQR_ENERGY_IMAGE_FILL(lqr_t_64f, AS0_64F, 1);
+            break;
+        default:
+#ifdef __LQR_DEBUG__
+            assert(0);
+#endif /* __LQR_DEBUG__ */
+            break;
     }
-
-    return LQR_OK;
 }
 
+#undef LQR_ENERGY_IMAGE_FILL
+
 /* LQR_PUBLIC */
 LqrRetVal
 lqr_carver_get_energy_image(LqrCarver *r, void *buffer, gint orientation, LqrColDepth col_depth,
                             LqrImageType image_type)
 {
-    gint x, y;
-    gint z0 = 0;
-    gint w, h;
+    gint z0;
     gint buf_size;
-    gint data;
-    gfloat nrg;
     gfloat nrg_min = G_MAXFLOAT;
     gfloat nrg_max = 0;
     gfloat *aux_buffer;
     gint k;
     gint channels;
     gint alpha_channel, black_channel;
-    gboolean has_alpha, has_black, col_model_is_additive;
+    gboolean has_black, col_model_is_additive;
+    gfloat offset[5], factor[5];
+    LqrRetVal ret_val;
 
     LQR_CATCH_F(orientation == 0 || orientation == 1);
     LQR_CATCH_CANC(r);
@@ -724,77 +994,54 @@ lqr_carver_get_energy_image(LqrCarver *r, void *buffer, gint orientation, LqrCol
             return LQR_ERROR;
     }
 
-    has_alpha = (alpha_channel >= 0 ? TRUE : FALSE);
     has_black = (black_channel >= 0 ? TRUE : FALSE);
 
-    if (r->nrg_active == FALSE) {
-        LQR_CATCH(lqr_carver_init_energy_related(r));
-    }
-
-    if (r->w != r->w_start - r->max_level + 1) {
-#ifdef __LQR_DEBUG__
-        assert(r->active);
-#endif /* __LQR_DEBUG__ */
-        LQR_CATCH(lqr_carver_flatten(r));
+    /* additive models show the energy in all colour channels,
+     * subtractive ones show 1 - energy either in the black channel
+     * only or in all colour channels; alpha is always opaque */
+    for (k = 0; k < channels; k++) {
+        if (k == alpha_channel) {
+            offset[k] = 1;
+            factor[k] = 0;
+        } else if (col_model_is_additive) {
+            offset[k] = 0;
+            factor[k] = 1;
+        } else if (has_black && k != black_channel) {
+            offset[k] = 0;
+            factor[k] = 0;
+        } else {
+            offset[k] = 1;
+            factor[k] = -1;
+        }
     }
 
-    buf_size = r->w * r->h;
+    buf_size = lqr_carver_get_width(r) * lqr_carver_get_height(r);
 
     LQR_CATCH_MEM(aux_buffer = g_try_new(gfloat, buf_size));
 
-    if (orientation != lqr_carver_get_orientation(r)) {
-        LQR_CATCH(lqr_carver_transpose(r));
+    ret_val = lqr_carver_export_energy(r, aux_buffer, orientation, TRUE);
+    if (ret_val != LQR_OK) {
+        g_free(aux_buffer);
+        return ret_val;
     }
-    LQR_CATCH(lqr_carver_build_emap(r));
-
-    w = lqr_carver_get_width(r);
-    h = lqr_carver_get_height(r);
 
-    for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) {
-            data = orientation == 0 ? r->raw[y][x] : r->raw[x][y];
-            /* nrg = tanhf(r->en[data]); */
-            nrg = LQR_SATURATE(r->en[data]);
-            nrg_max = MAX(nrg_max, nrg);
-            nrg_min = MIN(nrg_min, nrg);
-            aux_buffer[z0++] = nrg;
-        }
+    for (z0 = 0; z0 < buf_size; z0++) {
+        nrg_max = MAX(nrg_max, aux_buffer[z0]);
+        nrg_min = MIN(nrg_min, aux_buffer[z0]);
     }
 
-    for (z0 = 0; z0 < buf_size; z0++) {
-        if (nrg_max > nrg_min) {
-            nrg = (aux_buffer[z0] - nrg_min) / (nrg_max - nrg_min);
-        } else {
-            nrg = 0;
-        }
-        if (col_model_is_additive) {
-            for (k = 0; k < channels; k++) {
-                if (k != alpha_channel) {
-                    lqr_pixel_set_norm(nrg, buffer, z0 * channels + k, col_depth);
-                }
-            }
-        } else {
-            nrg = 1 - nrg;
-            if (has_black) {
-                lqr_pixel_set_norm(nrg, buffer, z0 * channels + black_channel, col_depth);
-                for (k = 0; k < channels; k++) {
-                    if ((k != alpha_channel) && (k != black_channel)) {
-                        lqr_pixel_set_norm(0.0, buffer, z0 * channels + k, col_depth);
-                    }
-                }
-            } else {
-                for (k = 0; k < channels; k++) {
-                    if ((k != alpha_channel) && (k != black_channel)) {
-                        lqr_pixel_set_norm(nrg, buffer, z0 * channels + k, col_depth);
-                    }
-                }
-            }
+    if (nrg_max > nrg_min) {
+        for (z0 = 0; z0 < buf_size; z0++) {
+            aux_buffer[z0] = (aux_buffer[z0] - nrg_min) / (nrg_max - nrg_min);
         }
-        if (has_alpha) {
-            lqr_pixel_set_norm(1.0, buffer, z0 * channels + alpha_channel, col_depth);
+    } else {
+        for (z0 = 0; z0 < buf_size; z0++) {
+            aux_buffer[z0] = 0;
         }
     }
 
+    lqr_energy_image_fill(buffer, aux_buffer, buf_size, channels, offset, factor, col_depth);
+
     g_free(aux_buffer);
 
     return LQR_OK;
@@ -38,17 +38,21 @@
 #define LQR_SATURATE_(x) (1 / (1 + (1 / (x))))
 #define LQR_SATURATE(x) ((x) >= 0 ? LQR_SATURATE_(x) : -LQR_SATURATE_(-x))
 
-gdouble lqr_pixel_get_norm(void *src, gint src_ind, LqrColDepth col_depth);
-void lqr_pixel_set_norm(gdouble val, void *rgb, gint rgb_ind, LqrColDepth col_depth);
-gdouble lqr_pixel_get_rgbcol(void *rgb, gint rgb_ind, LqrColDepth col_depth, LqrImageType image_type,
+gdouble lqr_pixel_get_norm(void *src, gsize src_ind, LqrColDepth col_depth);
+void lqr_pixel_set_norm(gdouble val, void *rgb, gsize rgb_ind, LqrColDepth col_depth);
+gdouble lqr_pixel_get_rgbcol(void *rgb, gsize rgb_ind, LqrColDepth col_depth, LqrImageType image_type,
                              gint channel);
-gdouble lqr_carver_read_brightness_grey(LqrCarver *r, gint x, gint y);
-gdouble lqr_carver_read_brightness_std(LqrCarver *r, gint x, gint y);
-gdouble lqr_carver_read_brightness_custom(LqrCarver *r, gint x, gint y);
+gdouble lqr_carver_read_brightness_grey(LqrCarver *r, gint now);
+gdouble lqr_carver_read_brightness_std(LqrCarver *r, gint now);
+gdouble lqr_carver_read_brightness_custom(LqrCarver *r, gint now);
+gdouble lqr_carver_read_brightness_at(LqrCarver *r, gint now);
 gdouble lqr_carver_read_brightness(LqrCarver *r, gint x, gint y);
-gdouble lqr_carver_read_luma_std(LqrCarver *r, gint x, gint y);
+gdouble lqr_carver_read_luma_std(LqrCarver *r, gint now);
+gdouble lqr_carver_read_luma_at(LqrCarver *r, gint now);
 gdouble lqr_carver_read_luma(LqrCarver *r, gint x, gint y);
+gdouble lqr_carver_read_rgba_at(LqrCarver *r, gint now, gint channel);
 gdouble lqr_carver_read_rgba(LqrCarver *r, gint x, gint y, gint channel);
+gdouble lqr_carver_read_custom_at(LqrCarver *r, gint now, gint channel);
 gdouble lqr_carver_read_custom(LqrCarver *r, gint x, gint y, gint channel);
 
 gdouble lqr_carver_read_cached_std(LqrCarver *r, gint x, gint y);
@@ -62,6 +66,13 @@ gdouble *lqr_carver_generate_rcache_rgba(LqrCarver *r);
 gdouble *lqr_carver_generate_rcache_custom(LqrCarver *r);
 gdouble *lqr_carver_generate_rcache(LqrCarver *r);
 
+/* energy export (does not alter the carver) */
+void lqr_carver_read_values_at(LqrCarver *r, gint now, gdouble *values);
+LqrRetVal lqr_carver_compute_energy_view(LqrCarver *r, gfloat *buffer, gint orientation, gboolean saturate);
+LqrRetVal lqr_carver_export_energy(LqrCarver *r, gfloat *buffer, gint orientation, gboolean saturate);
+void lqr_energy_image_fill(void *buffer, const gfloat *nrg, gint size, gint channels, const gfloat *offset,
+                           const gfloat *factor, LqrColDepth col_depth);
+
 gfloat lqr_energy_builtin_grad_all(gint x, gint y, gint img_width, gint img_height, LqrReadingWindow *rwindow,
                                    LqrGradFunc gf);
 gfloat lqr_energy_builtin_grad_norm(gint x, gint y, gint img_width, gint img_height, LqrReadingWindow *rwindow,
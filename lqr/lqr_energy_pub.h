@@ -49,6 +49,8 @@ typedef gfloat (*LqrEnergyFunc) (gint x, gint y, gint img_width, gint img_height
 LQR_PUBLIC LqrRetVal lqr_carver_set_energy_function_builtin(LqrCarver *r, LqrEnergyFuncBuiltinType ef_ind);
 LQR_PUBLIC LqrRetVal lqr_carver_set_energy_function(LqrCarver *r, LqrEnergyFunc en_func, gint radius,
                                                     LqrEnergyReaderType reader_type, gpointer extra_data);
+LQR_PUBLIC LqrRetVal lqr_carver_set_energy_buffer(LqrCarver *r, gfloat *buffer, gfloat function_weight);
+LQR_PUBLIC void lqr_carver_clear_energy_buffer(LqrCarver *r);
 
 LQR_PUBLIC LqrRetVal lqr_carver_get_energy(LqrCarver *r, gfloat *buffer, gint orientation);
 LQR_PUBLIC LqrRetVal lqr_carver_get_true_energy(LqrCarver *r, gfloat *buffer, gint orientation);
@@ -0,0 +1,385 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <glib.h>
+
+#include <lqr/lqr_all.h>
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_LAYER CLASS FUNCTIONS ****/
+
+/*** constructor & destructor ***/
+
+/* constructor */
+/* LQR_PUBLIC */
+LqrLayer *
+lqr_layer_new(void *buffer, gint width, gint height, gint channels, LqrColDepth colour_depth)
+{
+    LqrLayer *layer;
+
+    LQR_TRY_N_N(buffer);
+    if ((width < 1) || (height < 1) || (channels < 1)) {
+        return NULL;
+    }
+    LQR_TRY_N_N(layer = g_try_new(LqrLayer, 1));
+
+    layer->w = width;
+    layer->h = height;
+    layer->channels = channels;
+    layer->col_depth = colour_depth;
+    layer->rgb = buffer;
+    layer->preserve_in_buffer = FALSE;
+    layer->carver = NULL;
+    layer->next = NULL;
+
+    return layer;
+}
+
+/* destructor (attached layers are destroyed
+ * along with their carver, and are ignored here) */
+/* LQR_PUBLIC */
+void
+lqr_layer_destroy(LqrLayer *layer)
+{
+    if (layer->carver != NULL) {
+        return;
+    }
+    if (!layer->preserve_in_buffer) {
+        g_free(layer->rgb);
+    }
+    g_free(layer);
+}
+
+void
+lqr_layer_list_destroy(LqrLayer *layer)
+{
+    LqrLayer *next;
+
+    while (layer != NULL) {
+        next = layer->next;
+        if (!layer->preserve_in_buffer) {
+            lqr_carver_scratch_free(layer->carver, layer->rgb);
+        }
+        g_free(layer);
+        layer = next;
+    }
+}
+
+/*** set attributes ***/
+
+/* flag the input buffer to avoid destruction */
+/* LQR_PUBLIC */
+void
+lqr_layer_set_preserve_input_image(LqrLayer *layer)
+{
+    layer->preserve_in_buffer = TRUE;
+}
+
+/* attach a passive layer to a carver: from now on the layer
+ * follows the carver's visibility map, and is destroyed
+ * together with the carver */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_attach_layer(LqrCarver *r, LqrLayer *layer)
+{
+    LqrLayer **last;
+
+    LQR_CATCH_F(layer->carver == NULL);
+    LQR_CATCH_F(!r->transposed);
+    LQR_CATCH_F(r->w0 == layer->w);
+    LQR_CATCH_F(r->h0 == layer->h);
+    LQR_CATCH_F(g_atomic_int_get(&r->state) == LQR_CARVER_STATE_STD);
+
+    for (last = &r->layers; *last != NULL; last = &(*last)->next) {
+    }
+    *last = layer;
+    layer->carver = r;
+
+    return LQR_OK;
+}
+
+/*** maps manipulations (driven by the carver) ***/
+
+/* substitute the buffer of the layer */
+void
+lqr_layer_replace_rgb(LqrLayer *layer, void *new_rgb)
+{
+    if (!layer->preserve_in_buffer) {
+        lqr_carver_scratch_free(layer->carver, layer->rgb);
+    }
+    layer->rgb = new_rgb;
+    layer->preserve_in_buffer = FALSE;
+}
+
+/* insert the points found by the carver's inflate():
+ * ins holds the (w1 - w0) insertion points of each row */
+LqrRetVal
+lqr_layer_inflate(LqrLayer *layer, gint w1, gint *ins)
+{
+    LqrCarver *r = layer->carver;
+    void *new_rgb = NULL;
+    gint y;
+
+    BUF_SCRATCH_TRY_NEW0_RET_LQR(r, new_rgb, (gsize) w1 * r->h0 * layer->channels, layer->col_depth);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(lqr_carver_n_threads(r)) \
+    if (w1 * r->h0 >= LQR_INFLATE_PARALLEL_MIN_SIZE)
+#endif /* _OPENMP */
+    for (y = 0; y < r->h0; y++) {
+        lqr_layer_inflate_row(layer, new_rgb, y, w1, ins + (gsize) y * (w1 - r->w0));
+    }
+
+    lqr_layer_replace_rgb(layer, new_rgb);
+
+    return LQR_OK;
+}
+
+/* block-copy the runs between insertion points of row y,
+ * averaging the neighbors at insertion points */
+void
+lqr_layer_inflate_row(LqrLayer *layer, void *new_rgb, gint y, gint w1, gint *ins)
+{
+    LqrCarver *r = layer->carver;
+    gint n = w1 - r->w0;
+    gint i, x1, x1_next, run;
+    gint z0, z1, c_left;
+    gsize pxl_size;
+
+    pxl_size = LQR_SAMPLE_SIZE(layer->col_depth) * layer->channels;
+    z0 = y * w1;
+    z1 = y * r->w0;
+    x1 = 0;
+    for (i = 0; i <= n; i++) {
+        x1_next = (i < n) ? ins[i] : r->w0;
+        run = x1_next - x1;
+        if (run > 0) {
+            memcpy((guchar *) new_rgb + z0 * pxl_size, (guchar *) layer->rgb + (z1 + x1) * pxl_size, run * pxl_size);
+            z0 += run;
+            x1 = x1_next;
+        }
+        if (i == n) {
+            break;
+        }
+        c_left = (x1 > 0) ? z1 + x1 - 1 : z1 + x1;
+        lqr_carver_inflate_average(layer->rgb, new_rgb, layer->channels, layer->col_depth, z0, c_left, z1 + x1);
+        z0++;
+    }
+}
+
+/* copy the points of row y which are visible at the
+ * carver's current level into dest, one every stride points */
+void
+lqr_layer_gather_row(LqrLayer *layer, void *dest, gint y, gint stride)
+{
+    LqrCarver *r = layer->carver;
+    gint x0, x1, z1, vs, k;
+    gsize pxl_size;
+
+    pxl_size = LQR_SAMPLE_SIZE(layer->col_depth) * layer->channels;
+    z1 = y * r->w0;
+    k = 0;
+    x0 = 0;
+    while (x0 < r->w0) {
+        /* skip invisible points */
+        vs = VS_GET(r, z1 + x0);
+        if ((vs != 0) && (vs < r->level)) {
+            x0++;
+            continue;
+        }
+        /* find the end of the run of visible points */
+        for (x1 = x0 + 1; x1 < r->w0; x1++) {
+            vs = VS_GET(r, z1 + x1);
+            if ((vs != 0) && (vs < r->level)) {
+                break;
+            }
+        }
+        if (stride == 1) {
+            memcpy((guchar *) dest + k * pxl_size, (guchar *) layer->rgb + (z1 + x0) * pxl_size,
+                   (x1 - x0) * pxl_size);
+            k += x1 - x0;
+        } else {
+            for (; x0 < x1; x0++, k++) {
+                memcpy((guchar *) dest + k * stride * pxl_size, (guchar *) layer->rgb + (z1 + x0) * pxl_size,
+                       pxl_size);
+            }
+        }
+        x0 = x1;
+    }
+
+#ifdef __LQR_DEBUG__
+    assert(k == r->w);
+#endif /* __LQR_DEBUG__ */
+}
+
+/* keep only the points visible at the carver's current
+ * size (called before the carver flattens its own maps) */
+LqrRetVal
+lqr_layer_flatten(LqrLayer *layer)
+{
+    LqrCarver *r = layer->carver;
+    void *new_rgb = NULL;
+    gint y;
+    gsize pxl_size;
+
+    BUF_SCRATCH_TRY_NEW0_RET_LQR(r, new_rgb, (gsize) r->w * r->h * layer->channels, layer->col_depth);
+
+    pxl_size = LQR_SAMPLE_SIZE(layer->col_depth) * layer->channels;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(lqr_carver_n_threads(r)) \
+    if (r->w0 * r->h0 >= LQR_INFLATE_PARALLEL_MIN_SIZE)
+#endif /* _OPENMP */
+    for (y = 0; y < r->h; y++) {
+        lqr_layer_gather_row(layer, (guchar *) new_rgb + y * r->w * pxl_size, y, 1);
+    }
+
+    lqr_layer_replace_rgb(layer, new_rgb);
+
+    return LQR_OK;
+}
+
+/* transpose the layer (the carver is flat at this point) */
+LqrRetVal
+lqr_layer_transpose(LqrLayer *layer)
+{
+    LqrCarver *r = layer->carver;
+    void *new_rgb = NULL;
+    gint x, y;
+    gsize pxl_size;
+
+#ifdef __LQR_DEBUG__
+    assert(r->w == r->w0);
+#endif /* __LQR_DEBUG__ */
+
+    BUF_SCRATCH_TRY_NEW0_RET_LQR(r, new_rgb, (gsize) r->w0 * r->h0 * layer->channels, layer->col_depth);
+
+    pxl_size = LQR_SAMPLE_SIZE(layer->col_depth) * layer->channels;
+    for (y = 0; y < r->h0; y++) {
+        for (x = 0; x < r->w0; x++) {
+            memcpy((guchar *) new_rgb + (x * r->h0 + y) * pxl_size,
+                   (guchar *) layer->rgb + (y * r->w0 + x) * pxl_size, pxl_size);
+        }
+    }
+
+    lqr_layer_replace_rgb(layer, new_rgb);
+
+    return LQR_OK;
+}
+
+LqrRetVal
+lqr_layer_list_inflate(LqrLayer *layer, gint w1, gint *ins)
+{
+    for (; layer != NULL; layer = layer->next) {
+        LQR_CATCH(lqr_layer_inflate(layer, w1, ins));
+    }
+    return LQR_OK;
+}
+
+LqrRetVal
+lqr_layer_list_flatten(LqrLayer *layer)
+{
+    for (; layer != NULL; layer = layer->next) {
+        LQR_CATCH(lqr_layer_flatten(layer));
+    }
+    return LQR_OK;
+}
+
+LqrRetVal
+lqr_layer_list_transpose(LqrLayer *layer)
+{
+    for (; layer != NULL; layer = layer->next) {
+        LQR_CATCH(lqr_layer_transpose(layer));
+    }
+    return LQR_OK;
+}
+
+/*** readout ***/
+
+/* copy the layer at the carver's current size into
+ * buffer, which must hold width * height * channels
+ * samples of the layer's colour depth */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_layer_read_buffer(LqrLayer *layer, void *buffer)
+{
+    LqrCarver *r = layer->carver;
+    gint y;
+    gsize pxl_size;
+
+    LQR_CATCH_F(buffer != NULL);
+
+    pxl_size = LQR_SAMPLE_SIZE(layer->col_depth) * layer->channels;
+
+    if (r == NULL) {
+        memcpy(buffer, layer->rgb, layer->w * layer->h * pxl_size);
+        return LQR_OK;
+    }
+
+    LQR_CATCH_CANC(r);
+
+    for (y = 0; y < r->h; y++) {
+        if (r->transposed) {
+            lqr_layer_gather_row(layer, (guchar *) buffer + y * pxl_size, y, r->h);
+        } else {
+            lqr_layer_gather_row(layer, (guchar *) buffer + y * r->w * pxl_size, y, 1);
+        }
+    }
+
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+gint
+lqr_layer_get_width(LqrLayer *layer)
+{
+    return (layer->carver != NULL) ? lqr_carver_get_width(layer->carver) : layer->w;
+}
+
+/* LQR_PUBLIC */
+gint
+lqr_layer_get_height(LqrLayer *layer)
+{
+    return (layer->carver != NULL) ? lqr_carver_get_height(layer->carver) : layer->h;
+}
+
+/* LQR_PUBLIC */
+gint
+lqr_layer_get_channels(LqrLayer *layer)
+{
+    return layer->channels;
+}
+
+/* LQR_PUBLIC */
+LqrColDepth
+lqr_layer_get_col_depth(LqrLayer *layer)
+{
+    return layer->col_depth;
+}
@@ -0,0 +1,62 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_LAYER_PRIV_H__
+#define __LQR_LAYER_PRIV_H__
+
+#ifndef __LQR_CARVER_H__
+#error "lqr_carver.h must be included prior to lqr_layer_priv.h"
+#endif /* __LQR_CARVER_H__ */
+
+/*** LQR_LAYER CLASS DEFINITION ***/
+
+/* A passive layer is just a buffer which follows the
+ * visibility map of the carver it is attached to: it has no
+ * cursor, energy or state of its own, and its maps are rebuilt
+ * by the carver whenever the carver rebuilds its own */
+struct _LqrLayer {
+    gint w, h;                          /* size at creation (then the layer follows the carver's w0 & h0) */
+    gint channels;                      /* number of colour channels */
+    LqrColDepth col_depth;              /* colour depth */
+
+    void *rgb;                          /* array of points, same layout as the carver's */
+    gboolean preserve_in_buffer;        /* whether the input buffer belongs to the user */
+
+    LqrCarver *carver;                  /* carver the layer is attached to (NULL if none) */
+    LqrLayer *next;                     /* next layer attached to the same carver */
+};
+
+/* LQR_LAYER CLASS PRIVATE FUNCTIONS */
+
+void lqr_layer_list_destroy(LqrLayer *layer);
+LqrRetVal lqr_layer_list_inflate(LqrLayer *layer, gint w1, gint *ins);
+LqrRetVal lqr_layer_list_flatten(LqrLayer *layer);
+LqrRetVal lqr_layer_list_transpose(LqrLayer *layer);
+
+void lqr_layer_replace_rgb(LqrLayer *layer, void *new_rgb);
+LqrRetVal lqr_layer_inflate(LqrLayer *layer, gint w1, gint *ins);
+void lqr_layer_inflate_row(LqrLayer *layer, void *new_rgb, gint y, gint w1, gint *ins);
+void lqr_layer_gather_row(LqrLayer *layer, void *dest, gint y, gint stride);
+LqrRetVal lqr_layer_flatten(LqrLayer *layer);
+LqrRetVal lqr_layer_transpose(LqrLayer *layer);
+
+#endif /* __LQR_LAYER_PRIV_H__ */
@@ -0,0 +1,49 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_LAYER_PUB_H__
+#define __LQR_LAYER_PUB_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_layer_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/* LQR_LAYER CLASS PUBLIC FUNCTIONS */
+
+/* constructor & destructor */
+LQR_PUBLIC LqrLayer *lqr_layer_new(void *buffer, gint width, gint height, gint channels, LqrColDepth colour_depth);
+LQR_PUBLIC void lqr_layer_destroy(LqrLayer *layer);
+
+/* set attributes */
+LQR_PUBLIC void lqr_layer_set_preserve_input_image(LqrLayer *layer);
+
+/* attach to a carver (which then owns the layer) */
+LQR_PUBLIC LqrRetVal lqr_carver_attach_layer(LqrCarver *r, LqrLayer *layer);
+
+/* readout */
+LQR_PUBLIC LqrRetVal lqr_layer_read_buffer(LqrLayer *layer, void *buffer);
+LQR_PUBLIC gint lqr_layer_get_width(LqrLayer *layer);
+LQR_PUBLIC gint lqr_layer_get_height(LqrLayer *layer);
+LQR_PUBLIC gint lqr_layer_get_channels(LqrLayer *layer);
+LQR_PUBLIC LqrColDepth lqr_layer_get_col_depth(LqrLayer *layer);
+
+#endif /* __LQR_LAYER_PUB_H__ */
@@ -46,9 +46,12 @@ lqr_progress_new(void)
 }
 
 LqrRetVal
-lqr_progress_init(LqrProgress * p, const gchar *message)
+lqr_progress_init(LqrProgress * p, LqrCarver *r, const gchar *message)
 {
     LQR_CATCH_F(p != NULL);
+    if (p->init_full) {
+        LQR_CATCH(p->init_full(r, message, p->init_data));
+    }
     if (p->init) {
         return p->init(message);
     } else {
@@ -57,9 +60,12 @@ lqr_progress_init(LqrProgress * p, const gchar *message)
 }
 
 LqrRetVal
-lqr_progress_update(LqrProgress * p, gdouble percentage)
+lqr_progress_update(LqrProgress * p, LqrCarver *r, gdouble percentage, gdouble eta)
 {
     LQR_CATCH_F(p != NULL);
+    if (p->update_full) {
+        LQR_CATCH(p->update_full(r, percentage, eta, p->update_data));
+    }
     if (p->update) {
         return p->update(percentage);
     } else {
@@ -68,9 +74,12 @@ lqr_progress_update(LqrProgress * p, gdouble percentage)
 }
 
 LqrRetVal
-lqr_progress_end(LqrProgress * p, const gchar *message)
+lqr_progress_end(LqrProgress * p, LqrCarver *r, const gchar *message)
 {
     LQR_CATCH_F(p != NULL);
+    if (p->end_full) {
+        LQR_CATCH(p->end_full(r, message, p->end_data));
+    }
     if (p->end) {
         return p->end(message);
     } else {
@@ -78,6 +87,14 @@ lqr_progress_end(LqrProgress * p, const gchar *message)
     }
 }
 
+/* whether the updates need timing (for the
+ * time-based throttle or for the ETA) */
+gboolean
+lqr_progress_needs_timer(LqrProgress * p)
+{
+    return (p->update_interval > 0) || (p->update_full != NULL);
+}
+
 /* LQR_PUBLIC */
 LqrRetVal
 lqr_progress_set_init(LqrProgress * p, LqrProgressFuncInit init_func)
@@ -102,6 +119,33 @@ lqr_progress_set_end(LqrProgress * p, LqrProgressFuncEnd end_func)
     return LQR_OK;
 }
 
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_progress_set_init_full(LqrProgress * p, LqrProgressFuncInitFull init_func, gpointer data)
+{
+    p->init_full = init_func;
+    p->init_data = data;
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_progress_set_update_full(LqrProgress * p, LqrProgressFuncUpdateFull update_func, gpointer data)
+{
+    p->update_full = update_func;
+    p->update_data = data;
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_progress_set_end_full(LqrProgress * p, LqrProgressFuncEndFull end_func, gpointer data)
+{
+    p->end_full = end_func;
+    p->end_data = data;
+    return LQR_OK;
+}
+
 /* LQR_PUBLIC */
 LqrRetVal
 lqr_progress_set_update_step(LqrProgress * p, gfloat update_step)
@@ -110,6 +154,16 @@ lqr_progress_set_update_step(LqrProgress * p, gfloat update_step)
     return LQR_OK;
 }
 
+/* minimum time between updates, in seconds
+ * (if positive, this replaces the update step) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_progress_set_update_interval(LqrProgress * p, gdouble interval)
+{
+    p->update_interval = interval;
+    return LQR_OK;
+}
+
 /* LQR_PUBLIC */
 LqrRetVal
 lqr_progress_set_init_width_message(LqrProgress * p, const gchar *message)
@@ -27,9 +27,16 @@
 
 struct _LqrProgress {
     gfloat update_step;
+    gdouble update_interval;
     LqrProgressFuncInit init;
     LqrProgressFuncUpdate update;
     LqrProgressFuncEnd end;
+    LqrProgressFuncInitFull init_full;
+    LqrProgressFuncUpdateFull update_full;
+    LqrProgressFuncEndFull end_full;
+    gpointer init_data;
+    gpointer update_data;
+    gpointer end_data;
     gchar init_width_message[LQR_PROGRESS_MAX_MESSAGE_LENGTH];
     gchar end_width_message[LQR_PROGRESS_MAX_MESSAGE_LENGTH];
     gchar init_height_message[LQR_PROGRESS_MAX_MESSAGE_LENGTH];
@@ -38,8 +45,9 @@ struct _LqrProgress {
 
 /* LQR_PROGRESS CLASS PRIVATE FUNCTIONS */
 
-LqrRetVal lqr_progress_init(LqrProgress * p, const gchar *message);
-LqrRetVal lqr_progress_update(LqrProgress * p, gdouble percentage);
-LqrRetVal lqr_progress_end(LqrProgress * p, const gchar *message);
+LqrRetVal lqr_progress_init(LqrProgress * p, LqrCarver *r, const gchar *message);
+LqrRetVal lqr_progress_update(LqrProgress * p, LqrCarver *r, gdouble percentage, gdouble eta);
+LqrRetVal lqr_progress_end(LqrProgress * p, LqrCarver *r, const gchar *message);
+gboolean lqr_progress_needs_timer(LqrProgress * p);
 
 #endif /* __LQR_PROGRESS_PRIV_H__ */
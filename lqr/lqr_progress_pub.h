@@ -35,16 +35,28 @@ typedef LqrRetVal (*LqrProgressFuncInit) (const gchar *);
 typedef LqrRetVal (*LqrProgressFuncUpdate) (gdouble);
 typedef LqrRetVal (*LqrProgressFuncEnd) (const gchar *);
 
+/* these also get the carver, a user data pointer and (for updates)
+ * an estimate of the remaining time in seconds (negative if unknown) */
+typedef LqrRetVal (*LqrProgressFuncInitFull) (LqrCarver *carver, const gchar *message, gpointer data);
+typedef LqrRetVal (*LqrProgressFuncUpdateFull) (LqrCarver *carver, gdouble percentage, gdouble eta, gpointer data);
+typedef LqrRetVal (*LqrProgressFuncEndFull) (LqrCarver *carver, const gchar *message, gpointer data);
+
 /* LQR_PROGRESS CLASS PUBLIC FUNCTIONS */
 
 LQR_PUBLIC LqrProgress *lqr_progress_new(void);
 
 LQR_PUBLIC LqrRetVal lqr_progress_set_update_step(LqrProgress * p, gfloat update_step);
+LQR_PUBLIC LqrRetVal lqr_progress_set_update_interval(LqrProgress * p, gdouble interval);
 
 LQR_PUBLIC LqrRetVal lqr_progress_set_init(LqrProgress * p, LqrProgressFuncInit init_func);
 LQR_PUBLIC LqrRetVal lqr_progress_set_update(LqrProgress * p, LqrProgressFuncUpdate update_func);
 LQR_PUBLIC LqrRetVal lqr_progress_set_end(LqrProgress * p, LqrProgressFuncEnd end_func);
 
+LQR_PUBLIC LqrRetVal lqr_progress_set_init_full(LqrProgress * p, LqrProgressFuncInitFull init_func, gpointer data);
+LQR_PUBLIC LqrRetVal lqr_progress_set_update_full(LqrProgress * p, LqrProgressFuncUpdateFull update_func,
+                                                  gpointer data);
+LQR_PUBLIC LqrRetVal lqr_progress_set_end_full(LqrProgress * p, LqrProgressFuncEndFull end_func, gpointer data);
+
 LQR_PUBLIC LqrRetVal lqr_progress_set_init_width_message(LqrProgress * p, const gchar *message);
 LQR_PUBLIC LqrRetVal lqr_progress_set_init_height_message(LqrProgress * p, const gchar *message);
 LQR_PUBLIC LqrRetVal lqr_progress_set_end_width_message(LqrProgress * p, const gchar *message);
@@ -126,11 +126,14 @@ lqr_rwindow_fill_custom(LqrReadingWindow *rwindow, LqrCarver *r, gint x, gint y)
 LqrRetVal
 lqr_rwindow_fill(LqrReadingWindow *rwindow, LqrCarver *r, gint x, gint y)
 {
-    LQR_CATCH_CANC(r);
+    /* no CANC check here: this is called for each point,
+     * the callers check once per row */
 
     rwindow->carver = r;
     rwindow->x = x;
     rwindow->y = y;
+    rwindow->width = r->w;
+    rwindow->height = r->h;
 
     if (rwindow->use_rcache) {
         return LQR_OK;
@@ -153,6 +156,45 @@ lqr_rwindow_fill(LqrReadingWindow *rwindow, LqrCarver *r, gint x, gint y)
     return LQR_OK;
 }
 
+/* fill the window from a dense width x height array of already read
+ * values (channels per point, as in the rcache); used to evaluate the
+ * energy on a view of the carver which is not the current one */
+LqrRetVal
+lqr_rwindow_fill_from_buffer(LqrReadingWindow *rwindow, LqrCarver *r, const gdouble *values,
+                             gint width, gint height, gint x, gint y)
+{
+    gdouble **buffer;
+    gint i, j, k;
+    gint channels;
+
+    LQR_CATCH_F(rwindow->use_rcache == FALSE);
+
+    rwindow->carver = r;
+    rwindow->x = x;
+    rwindow->y = y;
+    rwindow->width = width;
+    rwindow->height = height;
+
+    buffer = rwindow->buffer;
+    channels = rwindow->channels;
+
+    for (i = -rwindow->radius; i <= rwindow->radius; i++) {
+        for (j = -rwindow->radius; j <= rwindow->radius; j++) {
+            if (x + i < 0 || x + i >= width || y + j < 0 || y + j >= height) {
+                for (k = 0; k < channels; k++) {
+                    buffer[i][channels * j + k] = 0;
+                }
+            } else {
+                for (k = 0; k < channels; k++) {
+                    buffer[i][channels * j + k] = values[((gsize) (y + j) * width + x + i) * channels + k];
+                }
+            }
+        }
+    }
+
+    return LQR_OK;
+}
+
 LqrReadingWindow *
 lqr_rwindow_new_std(gint radius, LqrEnergyReaderType read_func_type, gboolean use_rcache)
 {
@@ -184,6 +226,8 @@ lqr_rwindow_new_std(gint radius, LqrEnergyReaderType read_func_type, gboolean us
     out_rwindow->carver = NULL;
     out_rwindow->x = 0;
     out_rwindow->y = 0;
+    out_rwindow->width = 0;
+    out_rwindow->height = 0;
 
     return out_rwindow;
 }
@@ -219,6 +263,8 @@ lqr_rwindow_new_rgba(gint radius, gboolean use_rcache)
     out_rwindow->carver = NULL;
     out_rwindow->x = 0;
     out_rwindow->y = 0;
+    out_rwindow->width = 0;
+    out_rwindow->height = 0;
 
     return out_rwindow;
 }
@@ -246,7 +292,7 @@ lqr_rwindow_new_custom(gint radius, gboolean use_rcache, gint channels)
     }
     out_buffer += radius;
 
-    out_rwindow->buffer = NULL;
+    out_rwindow->buffer = out_buffer;
     out_rwindow->radius = radius;
     out_rwindow->read_t = LQR_ER_CUSTOM;
     out_rwindow->channels = channels;
@@ -254,6 +300,8 @@ lqr_rwindow_new_custom(gint radius, gboolean use_rcache, gint channels)
     out_rwindow->carver = NULL;
     out_rwindow->x = 0;
     out_rwindow->y = 0;
+    out_rwindow->width = 0;
+    out_rwindow->height = 0;
 
     return out_rwindow;
 }
@@ -352,7 +400,7 @@ lqr_rwindow_read(LqrReadingWindow *rwindow, gint x, gint y, gint channel)
 
     if (x < -rwindow->radius || x > rwindow->radius ||
         y < -rwindow->radius || y > rwindow->radius ||
-        x1 < 0 || x1 >= rwindow->carver->w || y1 < 0 || y1 >= rwindow->carver->h) {
+        x1 < 0 || x1 >= rwindow->width || y1 < 0 || y1 >= rwindow->height) {
         return 0;
     }
 
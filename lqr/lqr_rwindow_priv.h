@@ -36,6 +36,8 @@ struct _LqrReadingWindow {
     LqrCarver *carver;
     gint x;
     gint y;
+    gint width;
+    gint height;
 };
 
 typedef gdouble (*LqrReadFunc) (LqrCarver *, gint, gint);
@@ -46,6 +48,8 @@ LqrRetVal lqr_rwindow_fill_std(LqrReadingWindow *rwindow, LqrCarver *r, gint x,
 LqrRetVal lqr_rwindow_fill_rgba(LqrReadingWindow *rwindow, LqrCarver *r, gint x, gint y);
 LqrRetVal lqr_rwindow_fill_custom(LqrReadingWindow *rwindow, LqrCarver *r, gint x, gint y);
 LqrRetVal lqr_rwindow_fill(LqrReadingWindow *rwindow, LqrCarver *r, gint x, gint y);
+LqrRetVal lqr_rwindow_fill_from_buffer(LqrReadingWindow *rwindow, LqrCarver *r, const gdouble *values,
+                                       gint width, gint height, gint x, gint y);
 
 gdouble lqr_rwindow_read_bright(LqrReadingWindow *rwindow, gint x, gint y);
 gdouble lqr_rwindow_read_luma(LqrReadingWindow *rwindow, gint x, gint y);
@@ -0,0 +1,372 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+
+#include <lqr/lqr_all.h>
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_STRIP_CARVER CLASS FUNCTIONS ****/
+
+/*** constructor & destructor ***/
+
+/* constructor */
+/* LQR_PUBLIC */
+LqrStripCarver *
+lqr_strip_carver_new(gint width, gint height, gint channels, LqrColDepth colour_depth)
+{
+    LqrStripCarver *s;
+
+    LQR_TRY_N_N(s = g_try_new0(LqrStripCarver, 1));
+
+    s->w = width;
+    s->h = height;
+    s->channels = channels;
+    s->col_depth = colour_depth;
+
+    s->band_height = LQR_STRIP_DEFAULT_BAND_HEIGHT;
+
+    s->active = FALSE;
+    s->delta_x = 1;
+    s->rigidity = 0;
+
+    s->read_func = NULL;
+    s->write_func = NULL;
+    s->setup_func = NULL;
+
+    s->n_pins = 0;
+
+    if ((s->shared_row = g_try_malloc(lqr_strip_carver_row_size(s))) == NULL) {
+        g_free(s);
+        return NULL;
+    }
+    if ((s->pins = g_try_new(gint, width)) == NULL) {
+        g_free(s->shared_row);
+        g_free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+/* destructor */
+/* LQR_PUBLIC */
+void
+lqr_strip_carver_destroy(LqrStripCarver *s)
+{
+    g_free(s->shared_row);
+    g_free(s->pins);
+    g_free(s);
+}
+
+/*** initialization ***/
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_strip_carver_init(LqrStripCarver *s, gint delta_x, gfloat rigidity)
+{
+    LQR_CATCH_F(s->active == FALSE);
+    LQR_CATCH_F(delta_x >= 0);
+
+    s->delta_x = delta_x;
+    s->rigidity = rigidity;
+    s->active = TRUE;
+
+    return LQR_OK;
+}
+
+/*** set I/O and hooks ***/
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_strip_carver_set_reader(LqrStripCarver *s, LqrStripReadFunc read_func, gpointer data)
+{
+    s->read_func = read_func;
+    s->read_data = data;
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_strip_carver_set_writer(LqrStripCarver *s, LqrStripWriteFunc write_func, gpointer data)
+{
+    s->write_func = write_func;
+    s->write_data = data;
+    return LQR_OK;
+}
+
+/* the setup function is called on each band carver
+ * before initializing it, e.g. to set the energy function
+ * or the image type; y_offset is the image row of the band top */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_strip_carver_set_band_setup(LqrStripCarver *s, LqrStripBandSetupFunc setup_func, gpointer data)
+{
+    s->setup_func = setup_func;
+    s->setup_data = data;
+    return LQR_OK;
+}
+
+/*** set user parameters ***/
+
+/* taller bands use more memory but leave the seams
+ * more freedom between the pinned rows */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_strip_carver_set_band_height(LqrStripCarver *s, gint band_height)
+{
+    LQR_CATCH_F(band_height >= 2);
+    s->band_height = band_height;
+    return LQR_OK;
+}
+
+/*** image manipulations ***/
+
+/* size in bytes of an image row */
+gsize
+lqr_strip_carver_row_size(LqrStripCarver *s)
+{
+    return LQR_SAMPLE_SIZE(s->col_depth) * s->channels * s->w;
+}
+
+/* read the band starting at row y0 and build its carver
+ * (the first row comes from the previous band, if any) */
+LqrRetVal
+lqr_strip_carver_read_band(LqrStripCarver *s, LqrCarver **band, gint y0, gint rows)
+{
+    LqrRetVal ret_val;
+    gsize row_size;
+    guchar *buffer;
+    gint y;
+
+    row_size = lqr_strip_carver_row_size(s);
+
+    LQR_CATCH_MEM(buffer = g_try_malloc(row_size * rows));
+
+    y = 0;
+    if (y0 > 0) {
+        memcpy(buffer, s->shared_row, row_size);
+        y++;
+    }
+    for (; y < rows; y++) {
+        ret_val = s->read_func(y0 + y, buffer + y * row_size, s->read_data);
+        if (ret_val != LQR_OK) {
+            g_free(buffer);
+            return ret_val;
+        }
+    }
+
+    /* keep the last row for the next band */
+    memcpy(s->shared_row, buffer + (rows - 1) * row_size, row_size);
+
+    if ((*band = lqr_carver_new_ext(buffer, s->w, rows, s->channels, s->col_depth)) == NULL) {
+        g_free(buffer);
+        return LQR_NOMEM;
+    }
+
+    return LQR_OK;
+}
+
+/* force the seams of the band through the points carved from
+ * its first row by the previous band: the other points of that
+ * row are given an infinite energy, so that no finite path goes
+ * through them. There are exactly as many pinned points as seams
+ * to carve, each seam takes one of them, and a pinned point is
+ * always reachable (at least straight from above), hence all of
+ * them are carved. The parallel slices and the deadline are
+ * disabled, since they could carve seams regardless of the energy */
+LqrRetVal
+lqr_strip_carver_pin_band(LqrStripCarver *s, LqrCarver *band)
+{
+    LqrRetVal ret_val;
+    gdouble *buffer;
+    gint i, x;
+
+    if (s->n_pins == 0) {
+        return LQR_OK;
+    }
+
+    LQR_CATCH(lqr_carver_set_parallel_slices(band, 0));
+    LQR_CATCH(lqr_carver_set_deadline(band, 0));
+
+    LQR_CATCH_MEM(buffer = g_try_new(gdouble, s->w));
+    for (x = 0, i = 0; x < s->w; x++) {
+        if ((i < s->n_pins) && (s->pins[i] == x)) {
+            buffer[x] = 0;
+            i++;
+        } else {
+            buffer[x] = HUGE_VAL;
+        }
+    }
+    ret_val = lqr_carver_bias_add_area(band, buffer, 1, s->w, 1, 0, 0);
+    g_free(buffer);
+
+    return ret_val;
+}
+
+/* check that the seams of the band went through the pinned points
+ * of its first row, i.e. that they join those of the previous band
+ * (the points left by an enlargement are skipped, see below) */
+LqrRetVal
+lqr_strip_carver_check_pins(LqrStripCarver *s, LqrCarver *band)
+{
+    gint x, z0, vs, i;
+
+    i = 0;
+    x = 0;
+    for (z0 = 0; z0 < band->w0; z0++) {
+        vs = VS_GET(band, z0);
+        if ((vs != 0) && (vs < band->max_level)) {
+            continue;
+        }
+        if ((vs != 0) && (vs < band->level)) {
+            LQR_CATCH_F((i < s->n_pins) && (s->pins[i] == x));
+            i++;
+        }
+        x++;
+    }
+    LQR_CATCH_F(i == s->n_pins);
+
+    return LQR_OK;
+}
+
+/* store the columns carved from row y of the band
+ * (the band is only shrunk, so there are no points with
+ * a nonzero level below max_level, which would have been
+ * left by an enlargement; they are skipped nonetheless) */
+LqrRetVal
+lqr_strip_carver_collect_pins(LqrStripCarver *s, LqrCarver *band, gint y)
+{
+    gint x, z0, vs;
+
+    LQR_CATCH_F(!band->transposed);
+    LQR_CATCH_F(band->w_start == s->w);
+
+    s->n_pins = 0;
+    x = 0;
+    for (z0 = y * band->w0; z0 < (y + 1) * band->w0; z0++) {
+        vs = VS_GET(band, z0);
+        if ((vs != 0) && (vs < band->max_level)) {
+            continue;
+        }
+        if ((vs != 0) && (vs < band->level)) {
+            s->pins[s->n_pins++] = x;
+        }
+        x++;
+    }
+
+#ifdef __LQR_DEBUG__
+    assert(x == s->w);
+    assert(s->n_pins == s->w - band->w);
+#endif /* __LQR_DEBUG__ */
+
+    return LQR_OK;
+}
+
+/* write the first rows of the carved band */
+LqrRetVal
+lqr_strip_carver_write_band(LqrStripCarver *s, LqrCarver *band, gint y0, gint rows)
+{
+    gint n;
+    void *rgb;
+
+    lqr_carver_scan_reset(band);
+    while (lqr_carver_scan_line_ext(band, &n, &rgb)) {
+        if (n < rows) {
+            LQR_CATCH(s->write_func(y0 + n, rgb, lqr_carver_get_width(band), s->write_data));
+        }
+    }
+
+    return LQR_OK;
+}
+
+/* carve the image to the given width, band by band */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_strip_carver_resize(LqrStripCarver *s, gint new_width)
+{
+    LqrRetVal ret_val;
+    LqrCarver *band;
+    gint y0, rows;
+    gboolean last;
+
+    LQR_CATCH_F(s->active);
+    LQR_CATCH_F(s->read_func != NULL);
+    LQR_CATCH_F(s->write_func != NULL);
+    /* only width reductions are supported */
+    LQR_CATCH_F((new_width >= 1) && (new_width <= s->w));
+
+    s->n_pins = 0;
+
+    for (y0 = 0; y0 < s->h; y0 += rows - 1) {
+        rows = MIN(s->band_height, s->h - y0);
+        last = (y0 + rows == s->h);
+
+        LQR_CATCH(lqr_strip_carver_read_band(s, &band, y0, rows));
+
+        ret_val = LQR_OK;
+        if (s->setup_func) {
+            ret_val = s->setup_func(band, y0, s->setup_data);
+        }
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_init(band, s->delta_x, s->rigidity);
+        }
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_strip_carver_pin_band(s, band);
+        }
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_resize(band, new_width, rows);
+        }
+        if ((ret_val == LQR_OK) && (s->n_pins > 0)) {
+            ret_val = lqr_strip_carver_check_pins(s, band);
+        }
+        if ((ret_val == LQR_OK) && !last) {
+            ret_val = lqr_strip_carver_collect_pins(s, band, rows - 1);
+        }
+        if (ret_val == LQR_OK) {
+            /* the shared row is written by the next band */
+            ret_val = lqr_strip_carver_write_band(s, band, y0, last ? rows : rows - 1);
+        }
+
+        lqr_carver_destroy(band);
+        if (ret_val != LQR_OK) {
+            return ret_val;
+        }
+
+        if (last) {
+            break;
+        }
+    }
+
+    return LQR_OK;
+}
+
+/**** END OF LQR_STRIP_CARVER CLASS FUNCTIONS ****/
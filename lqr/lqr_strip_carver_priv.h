@@ -0,0 +1,72 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_STRIP_CARVER_PRIV_H__
+#define __LQR_STRIP_CARVER_PRIV_H__
+
+#ifndef __LQR_CARVER_H__
+#error "lqr_carver.h must be included prior to lqr_strip_carver_priv.h"
+#endif /* __LQR_CARVER_H__ */
+
+/* default height of the bands */
+#define LQR_STRIP_DEFAULT_BAND_HEIGHT (256)
+
+/*** LQR_STRIP_CARVER CLASS DEFINITION ***/
+
+/* This carver never holds the whole image in memory:
+ * the image is read, carved and written back in horizontal
+ * bands; two consecutive bands share one row, and the seams
+ * of each band are forced through the points carved from the
+ * shared row by the previous band (see lqr_strip_carver_pub.h) */
+struct _LqrStripCarver {
+    gint w, h;                          /* image width & height */
+    gint channels;                      /* number of colour channels of the image */
+    LqrColDepth col_depth;              /* image colour depth */
+
+    gint band_height;                   /* height of the bands (including the shared row) */
+
+    gboolean active;                    /* flag set when the seam parameters are set */
+    gint delta_x;                       /* max displacement of seams */
+    gfloat rigidity;                    /* rigidity value */
+
+    LqrStripReadFunc read_func;         /* row reader */
+    gpointer read_data;
+    LqrStripWriteFunc write_func;       /* row writer */
+    gpointer write_data;
+    LqrStripBandSetupFunc setup_func;   /* hook to customise each band carver */
+    gpointer setup_data;
+
+    void *shared_row;                   /* copy of the row shared with the next band */
+    gint *pins;                         /* columns carved from the shared row */
+    gint n_pins;                        /* number of pinned columns (0 = none) */
+};
+
+/* LQR_STRIP_CARVER CLASS PRIVATE FUNCTIONS */
+
+gsize lqr_strip_carver_row_size(LqrStripCarver *s);
+LqrRetVal lqr_strip_carver_read_band(LqrStripCarver *s, LqrCarver **band, gint y0, gint rows);
+LqrRetVal lqr_strip_carver_pin_band(LqrStripCarver *s, LqrCarver *band);
+LqrRetVal lqr_strip_carver_check_pins(LqrStripCarver *s, LqrCarver *band);
+LqrRetVal lqr_strip_carver_collect_pins(LqrStripCarver *s, LqrCarver *band, gint y);
+LqrRetVal lqr_strip_carver_write_band(LqrStripCarver *s, LqrCarver *band, gint y0, gint rows);
+
+#endif /* __LQR_STRIP_CARVER_PRIV_H__ */
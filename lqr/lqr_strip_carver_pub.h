@@ -0,0 +1,67 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_STRIP_CARVER_PUB_H__
+#define __LQR_STRIP_CARVER_PUB_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_strip_carver_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/* LQR_STRIP_CARVER CLASS DECLARATION */
+/* The image is carved in horizontal bands sharing one row, and only
+ * width reductions are supported. The seams of each band are forced
+ * through the points carved from the shared row by the previous band
+ * (the other points of that row get an infinite energy), so that the
+ * seams of consecutive bands always join; the parallel slices and the
+ * deadline are therefore not used by the bands but the first one */
+struct _LqrStripCarver;
+
+typedef struct _LqrStripCarver LqrStripCarver;
+
+/* LQR_STRIP_CARVER HOOKS DECLARATIONS */
+typedef LqrRetVal (*LqrStripReadFunc) (gint y, void *row, gpointer data);
+typedef LqrRetVal (*LqrStripWriteFunc) (gint y, void *row, gint width, gpointer data);
+typedef LqrRetVal (*LqrStripBandSetupFunc) (LqrCarver *band, gint y_offset, gpointer data);
+
+/* LQR_STRIP_CARVER CLASS PUBLIC FUNCTIONS */
+
+/* constructor & destructor */
+LQR_PUBLIC LqrStripCarver *lqr_strip_carver_new(gint width, gint height, gint channels, LqrColDepth colour_depth);
+LQR_PUBLIC void lqr_strip_carver_destroy(LqrStripCarver *s);
+
+/* initialize */
+LQR_PUBLIC LqrRetVal lqr_strip_carver_init(LqrStripCarver *s, gint delta_x, gfloat rigidity);
+
+/* set I/O and per-band hooks */
+LQR_PUBLIC LqrRetVal lqr_strip_carver_set_reader(LqrStripCarver *s, LqrStripReadFunc read_func, gpointer data);
+LQR_PUBLIC LqrRetVal lqr_strip_carver_set_writer(LqrStripCarver *s, LqrStripWriteFunc write_func, gpointer data);
+LQR_PUBLIC LqrRetVal lqr_strip_carver_set_band_setup(LqrStripCarver *s, LqrStripBandSetupFunc setup_func,
+                                                     gpointer data);
+
+/* set user parameters */
+LQR_PUBLIC LqrRetVal lqr_strip_carver_set_band_height(LqrStripCarver *s, gint band_height);
+
+/* image manipulations */
+LQR_PUBLIC LqrRetVal lqr_strip_carver_resize(LqrStripCarver *s, gint new_width);
+
+#endif /* __LQR_STRIP_CARVER_PUB_H__ */
@@ -0,0 +1,268 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <glib.h>
+
+#include <lqr/lqr_all.h>
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/* thread ids for the events: each thread which emits an event
+ * gets the next number, kept in its own thread-local slot
+ * (stored as id + 1, so that an empty slot reads 0) */
+#if (GLIB_MAJOR_VERSION == 2) && (GLIB_MINOR_VERSION < 32)
+static GStaticPrivate lqr_trace_thread_key = G_STATIC_PRIVATE_INIT;
+#define LQR_TRACE_THREAD_GET() g_static_private_get(&lqr_trace_thread_key)
+#define LQR_TRACE_THREAD_SET(id) g_static_private_set(&lqr_trace_thread_key, (id), NULL)
+#else
+static GPrivate lqr_trace_thread_key = G_PRIVATE_INIT(NULL);
+#define LQR_TRACE_THREAD_GET() g_private_get(&lqr_trace_thread_key)
+#define LQR_TRACE_THREAD_SET(id) g_private_set(&lqr_trace_thread_key, (id))
+#endif /* GLIB_VERSION < 2.32 */
+
+static volatile gint lqr_trace_n_threads = 0;
+
+/**** LQR_TRACE CLASS FUNCTIONS ****/
+
+/*** constructor & destructor ***/
+
+/* constructor */
+/* LQR_PUBLIC */
+LqrTrace *
+lqr_trace_new(gint capacity)
+{
+    LqrTrace *trace;
+
+    if (capacity <= 0) {
+        return NULL;
+    }
+
+    LQR_TRY_N_N(trace = g_try_new(LqrTrace, 1));
+    trace->events = g_try_new(LqrTraceEvent, capacity);
+    if (trace->events == NULL) {
+        g_free(trace);
+        return NULL;
+    }
+    trace->capacity = capacity;
+    g_atomic_int_set((volatile gint *) &trace->n_written, 0);
+    trace->start_time = lqr_trace_get_time();
+
+    return trace;
+}
+
+/* destructor */
+/* LQR_PUBLIC */
+void
+lqr_trace_destroy(LqrTrace *trace)
+{
+    if (trace == NULL) {
+        return;
+    }
+    g_free(trace->events);
+    g_free(trace);
+}
+
+/*** time & threads ***/
+
+/* monotonic time, in microseconds */
+gint64
+lqr_trace_get_time(void)
+{
+#if (GLIB_MAJOR_VERSION == 2) && (GLIB_MINOR_VERSION < 28)
+    GTimeVal now;
+
+    g_get_current_time(&now);
+    return (gint64) now.tv_sec * G_USEC_PER_SEC + now.tv_usec;
+#else
+    return g_get_monotonic_time();
+#endif /* GLIB_VERSION < 2.28 */
+}
+
+/* id of the calling thread, unique over the whole process
+ * (OpenMP thread numbers are only unique within a team, and
+ * are all 0 outside of parallel regions) */
+gint
+lqr_trace_get_thread_id(void)
+{
+    gint id;
+
+    id = GPOINTER_TO_INT(LQR_TRACE_THREAD_GET());
+    if (id == 0) {
+        id = g_atomic_int_exchange_and_add(&lqr_trace_n_threads, 1) + 1;
+        LQR_TRACE_THREAD_SET(GINT_TO_POINTER(id));
+    }
+    return id - 1;
+}
+
+/*** events ***/
+
+/* LQR_PUBLIC */
+void
+lqr_trace_clear(LqrTrace *trace)
+{
+    g_atomic_int_set((volatile gint *) &trace->n_written, 0);
+}
+
+/* LQR_PUBLIC */
+gint
+lqr_trace_get_n_events(LqrTrace *trace)
+{
+    guint n_written = (guint) g_atomic_int_get((volatile gint *) &trace->n_written);
+
+    return (gint) MIN(n_written, (guint) trace->capacity);
+}
+
+/* record an event; this can be called by different threads at
+ * the same time, since each call reserves its own slot in the ring */
+void
+lqr_trace_add_event(LqrTrace *trace, const gchar *name, gchar type, gint arg, gpointer carver)
+{
+    LqrTraceEvent *event;
+    guint slot;
+
+    slot = (guint) g_atomic_int_exchange_and_add((volatile gint *) &trace->n_written, 1) % (guint) trace->capacity;
+    event = trace->events + slot;
+
+    event->name = name;
+    event->type = type;
+    event->thread = lqr_trace_get_thread_id();
+    event->time = lqr_trace_get_time() - trace->start_time;
+    event->arg = arg;
+    event->carver = carver;
+}
+
+/* write the events in the Chrome trace event format
+ * (it must not be called while the trace is in use) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_trace_save_to_file(LqrTrace *trace, const gchar *filename)
+{
+    FILE *f;
+    LqrTraceEvent *event;
+    guint n_written, i, i0;
+    gboolean ok;
+
+    LQR_CATCH_F(trace != NULL);
+
+    f = fopen(filename, "w");
+    LQR_CATCH_F(f != NULL);
+
+    /* when the ring is full, start from the oldest event */
+    n_written = (guint) g_atomic_int_get((volatile gint *) &trace->n_written);
+    i0 = (n_written > (guint) trace->capacity) ? n_written - (guint) trace->capacity : 0;
+
+    fprintf(f, "{\"traceEvents\": [");
+    for (i = i0; i < n_written; i++) {
+        event = trace->events + (i % (guint) trace->capacity);
+        fprintf(f, "%s\n  {\"name\": \"%s\", \"cat\": \"lqr\", \"ph\": \"%c\", \"ts\": %" G_GINT64_FORMAT
+                ", \"pid\": 0, \"tid\": %i, \"args\": {\"carver\": \"%p\", \"arg\": %i}}",
+                (i == i0) ? "" : ",", event->name, event->type, event->time, event->thread, event->carver, event->arg);
+    }
+    fprintf(f, "\n], \"displayTimeUnit\": \"ms\"}\n");
+
+    ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+
+    return ok ? LQR_OK : LQR_ERROR;
+}
+
+/*** carver tracing ***/
+
+/* attached carvers use the trace of their root carver;
+ * the same trace can be shared by several carvers, even
+ * if they are resized at the same time */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_trace(LqrCarver *r, LqrTrace *trace)
+{
+    LQR_CATCH_F(r->root == NULL);
+    r->trace = trace;
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+LqrTrace *
+lqr_carver_get_trace(LqrCarver *r)
+{
+    while (r->root != NULL) {
+        r = r->root;
+    }
+    return r->trace;
+}
+
+/* the events opened on each carver are kept on a stack,
+ * so that they can be closed on the error paths */
+void
+lqr_carver_trace_begin(LqrCarver *r, const gchar *name, gint arg)
+{
+    LqrTrace *trace = lqr_carver_get_trace(r);
+
+    if (trace != NULL) {
+        lqr_trace_add_event(trace, name, LQR_TRACE_BEGIN, arg, r);
+        if (r->trace_depth < LQR_TRACE_MAX_DEPTH) {
+            r->trace_open[r->trace_depth].name = name;
+            r->trace_open[r->trace_depth].arg = arg;
+        }
+        r->trace_depth++;
+    }
+}
+
+void
+lqr_carver_trace_end(LqrCarver *r, const gchar *name, gint arg)
+{
+    LqrTrace *trace = lqr_carver_get_trace(r);
+
+    if (trace != NULL) {
+        lqr_trace_add_event(trace, name, LQR_TRACE_END, arg, r);
+        if (r->trace_depth > 0) {
+            r->trace_depth--;
+        }
+    }
+}
+
+/* close all the events still open on the carver, innermost
+ * first; this is called when an error leaves a traced region:
+ * errors are passed all the way up, so none of the enclosing
+ * regions of the carver will be closed the normal way either */
+void
+lqr_carver_trace_unwind(LqrCarver *r)
+{
+    LqrTrace *trace = lqr_carver_get_trace(r);
+
+    if (trace != NULL) {
+        while (r->trace_depth > 0) {
+            r->trace_depth--;
+            if (r->trace_depth < LQR_TRACE_MAX_DEPTH) {
+                lqr_trace_add_event(trace, r->trace_open[r->trace_depth].name, LQR_TRACE_END,
+                                    r->trace_open[r->trace_depth].arg, r);
+            }
+        }
+    }
+    r->trace_depth = 0;
+}
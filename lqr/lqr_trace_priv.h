@@ -0,0 +1,113 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_TRACE_PRIV_H__
+#define __LQR_TRACE_PRIV_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_trace_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+/* event types (as in the Chrome trace format) */
+#define LQR_TRACE_BEGIN 'B'
+#define LQR_TRACE_END 'E'
+
+/* maximum nesting of the events kept track of on each carver */
+#define LQR_TRACE_MAX_DEPTH 32
+
+/* as the LQR_CATCH macros, but for use inside the traced regions:
+ * the events still open on the carver are closed before giving up */
+#define LQR_TRACE_CATCH(carver, expr) G_STMT_START { \
+  LqrRetVal ret_val; \
+  if ((ret_val = (expr)) != LQR_OK) \
+    { \
+      lqr_carver_trace_unwind(carver); \
+      return ret_val; \
+    } \
+} G_STMT_END
+
+#define LQR_TRACE_CATCH_MEM(carver, expr) G_STMT_START { \
+  if ((expr) == NULL) \
+    { \
+      lqr_carver_trace_unwind(carver); \
+      return LQR_NOMEM; \
+    } \
+} G_STMT_END
+
+#define LQR_TRACE_CATCH_CANC(carver) G_STMT_START { \
+  if (g_atomic_int_get((carver)->state_p) == LQR_CARVER_STATE_CANCELLED) \
+    { \
+      lqr_carver_trace_unwind(carver); \
+      return LQR_USRCANCEL; \
+    } \
+} G_STMT_END
+
+#define LQR_TRACE_CATCH_CANC_ROW(carver, y) G_STMT_START { \
+  if (LQR_CANC_ROW((carver), (y))) \
+    { \
+      lqr_carver_trace_unwind(carver); \
+      return LQR_USRCANCEL; \
+    } \
+} G_STMT_END
+
+/*** LQR_TRACE_EVENT CLASS DEFINITION ***/
+
+struct _LqrTraceEvent {
+    const gchar *name;                  /* event name (a static string) */
+    gchar type;                         /* LQR_TRACE_BEGIN or LQR_TRACE_END */
+    gint thread;                        /* thread which emitted the event */
+    gint64 time;                        /* time since the trace creation, in microseconds */
+    gint arg;                           /* event argument (size, seam number...) */
+    gpointer carver;                    /* carver which emitted the event */
+};
+
+typedef struct _LqrTraceEvent LqrTraceEvent;
+
+/* an event opened on a carver and not yet closed */
+struct _LqrTraceFrame {
+    const gchar *name;                  /* event name */
+    gint arg;                           /* event argument */
+};
+
+typedef struct _LqrTraceFrame LqrTraceFrame;
+
+/*** LQR_TRACE CLASS DEFINITION ***/
+/* the events are kept in a ring buffer: when it is
+ * full, the oldest events are overwritten */
+
+struct _LqrTrace {
+    LqrTraceEvent *events;              /* ring buffer of events */
+    gint capacity;                      /* size of the ring buffer */
+    volatile guint n_written;           /* number of events written so far */
+    gint64 start_time;                  /* monotonic time of the trace creation, in microseconds */
+};
+
+/* LQR_TRACE CLASS PRIVATE FUNCTIONS */
+
+gint64 lqr_trace_get_time(void);
+gint lqr_trace_get_thread_id(void);
+void lqr_trace_add_event(LqrTrace *trace, const gchar *name, gchar type, gint arg, gpointer carver);
+void lqr_carver_trace_begin(LqrCarver *r, const gchar *name, gint arg);
+void lqr_carver_trace_end(LqrCarver *r, const gchar *name, gint arg);
+void lqr_carver_trace_unwind(LqrCarver *r);
+
+#endif /* __LQR_TRACE_PRIV_H__ */
@@ -0,0 +1,50 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_TRACE_PUB_H__
+#define __LQR_TRACE_PUB_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_trace_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/* LQR_TRACE CLASS DECLARATION */
+struct _LqrTrace;
+
+typedef struct _LqrTrace LqrTrace;
+
+/* LQR_TRACE CLASS PUBLIC FUNCTIONS */
+
+/* constructor & destructor */
+LQR_PUBLIC LqrTrace *lqr_trace_new(gint capacity);
+LQR_PUBLIC void lqr_trace_destroy(LqrTrace *trace);
+
+/* events access */
+LQR_PUBLIC void lqr_trace_clear(LqrTrace *trace);
+LQR_PUBLIC gint lqr_trace_get_n_events(LqrTrace *trace);
+LQR_PUBLIC LqrRetVal lqr_trace_save_to_file(LqrTrace *trace, const gchar *filename);
+
+/* carver tracing */
+LQR_PUBLIC LqrRetVal lqr_carver_set_trace(LqrCarver *r, LqrTrace *trace);
+LQR_PUBLIC LqrTrace *lqr_carver_get_trace(LqrCarver *r);
+
+#endif /* __LQR_TRACE_PUB_H__ */
@@ -24,6 +24,8 @@
 #  include <config.h>
 #endif
 
+#include <string.h>
+
 #include <lqr/lqr_all.h>
 
 #ifdef __LQR_DEBUG__
@@ -44,6 +46,9 @@ lqr_vmap_new(gint *buffer, gint width, gint height, gint depth, gint orientation
     vmap->height = height;
     vmap->orientation = orientation;
     vmap->depth = depth;
+    vmap->delta_x = -1;
+    vmap->rigidity = 0;
+    vmap->nrg_radius = -1;
     return vmap;
 }
 
@@ -90,6 +95,40 @@ lqr_vmap_get_orientation(LqrVMap *vmap)
     return vmap->orientation;
 }
 
+/* LQR_PUBLIC */
+gint
+lqr_vmap_get_delta_x(LqrVMap *vmap)
+{
+    return vmap->delta_x;
+}
+
+/* LQR_PUBLIC */
+gfloat
+lqr_vmap_get_rigidity(LqrVMap *vmap)
+{
+    return vmap->rigidity;
+}
+
+/* LQR_PUBLIC */
+gint
+lqr_vmap_get_energy_radius(LqrVMap *vmap)
+{
+    return vmap->nrg_radius;
+}
+
+/* record the settings of the carver which computed the map */
+void
+lqr_vmap_copy_settings(LqrVMap *vmap, LqrCarver *r)
+{
+    if (r->active) {
+        vmap->delta_x = r->delta_x;
+        vmap->rigidity = r->rigidity;
+    }
+    if (r->nrg_active) {
+        vmap->nrg_radius = r->nrg_radius;
+    }
+}
+
 /* dump the visibility level of the image */
 /* LQR_PUBLIC */
 LqrVMap *
@@ -115,7 +154,7 @@ lqr_vmap_dump(LqrCarver *r)
     lqr_cursor_reset(r->c);
     for (y = 0; y < r->h; y++) {
         for (x = 0; x < r->w; x++) {
-            vs = r->vs[r->c->now];
+            vs = VS_GET(r, r->c->now);
             if (!r->transposed) {
                 z0 = y * r->w + x;
             } else {
@@ -135,6 +174,7 @@ lqr_vmap_dump(LqrCarver *r)
     lqr_cursor_reset(r->c);
 
     LQR_TRY_N_N(vmap = lqr_vmap_new(buffer, w, h, depth, r->transposed));
+    lqr_vmap_copy_settings(vmap, r);
 
     return vmap;
 }
@@ -166,7 +206,7 @@ lqr_vmap_internal_dump(LqrCarver *r)
     lqr_cursor_reset(r->c);
     for (y = 0; y < r->h; y++) {
         for (x = 0; x < r->w; x++) {
-            vs = r->vs[r->c->now];
+            vs = VS_GET(r, r->c->now);
             if (!r->transposed) {
                 z0 = y * r->w + x;
             } else {
@@ -186,6 +226,7 @@ lqr_vmap_internal_dump(LqrCarver *r)
     lqr_cursor_reset(r->c);
 
     LQR_CATCH_MEM(vmap = lqr_vmap_new(buffer, w, h, depth, r->transposed));
+    lqr_vmap_copy_settings(vmap, r);
 
     LQR_CATCH_MEM(r->flushed_vs = lqr_vmap_list_append(r->flushed_vs, vmap));
 
@@ -211,22 +252,29 @@ lqr_vmap_load(LqrCarver *r, LqrVMap *vmap)
         LQR_CATCH_F((r->w_start == h) && (r->h_start == w));
     }
 
-    LQR_CATCH(lqr_carver_flatten(r));
+    /* a fresh carver needs no flattening */
+    if ((r->w != r->w0) || (r->w_start != r->w0) || (r->h != r->h0) || (r->h_start != r->h0)) {
+        LQR_CATCH(lqr_carver_flatten(r));
+    }
 
     if (vmap->orientation != r->transposed) {
         LQR_CATCH(lqr_carver_transpose(r));
     }
 
-    for (y = 0; y < r->h; y++) {
-        for (x = 0; x < r->w; x++) {
-            if (!r->transposed) {
-                z0 = y * r->w + x;
-            } else {
-                z0 = x * r->h + y;
+    if (!r->transposed) {
+        /* same layout, straight copy */
+        if (r->vs_compact) {
+            for (z0 = 0; z0 < w * h; z0++) {
+                VS_SET_AS(r->vs, TRUE, z0, vmap->buffer[z0]);
+            }
+        } else {
+            memcpy(r->vs, vmap->buffer, w * h * sizeof(gint));
+        }
+    } else {
+        for (y = 0; y < r->h; y++) {
+            for (x = 0, z0 = y, z1 = y * r->w; x < r->w; x++, z0 += r->h, z1++) {
+                VS_SET(r, z1, vmap->buffer[z0]);
             }
-            z1 = y * r->w + x;
-
-            r->vs[z1] = vmap->buffer[z0];
         }
     }
 
@@ -238,3 +286,324 @@ lqr_vmap_load(LqrCarver *r, LqrVMap *vmap)
 
     return LQR_OK;
 }
+
+/*** file format (see lqr_vmap_priv.h) ***/
+
+guchar *
+lqr_vmap_put_uint32(guchar *p, guint32 v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+    return p + 4;
+}
+
+guchar *
+lqr_vmap_put_uint64(guchar *p, guint64 v)
+{
+    p = lqr_vmap_put_uint32(p, (guint32) (v & 0xffffffff));
+    return lqr_vmap_put_uint32(p, (guint32) (v >> 32));
+}
+
+guint32
+lqr_vmap_get_uint32(const guchar *p)
+{
+    return (guint32) p[0] | ((guint32) p[1] << 8) | ((guint32) p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+guint64
+lqr_vmap_get_uint64(const guchar *p)
+{
+    return (guint64) lqr_vmap_get_uint32(p) | ((guint64) lqr_vmap_get_uint32(p + 4) << 32);
+}
+
+guchar *
+lqr_vmap_put_varint(guchar *p, guint32 v)
+{
+    while (v >= 0x80) {
+        *p++ = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+/* returns NULL if the data is truncated or corrupted */
+const guchar *
+lqr_vmap_get_varint(const guchar *p, const guchar *end, guint32 *v)
+{
+    guint32 ret = 0;
+    gint shift;
+
+    for (shift = 0; (p < end) && (shift < 32); shift += 7) {
+        ret |= (guint32) (*p & 0x7f) << shift;
+        if ((*p++ & 0x80) == 0) {
+            *v = ret;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+gint
+lqr_vmap_varint_size(guint32 v)
+{
+    gint n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/* encode the map in the file format, returns NULL on failure */
+guchar *
+lqr_vmap_encode(LqrVMap *vmap, gsize *size)
+{
+    guchar *data, *p;
+    gsize offsets_start, max_size;
+    gint n_lines, line_len;
+    gint i, j, d;
+    gint plain_size, delta_size;
+    union {
+        gfloat f;
+        guint32 i;
+    } rig;
+
+    n_lines = vmap->orientation ? vmap->width : vmap->height;
+    line_len = vmap->orientation ? vmap->height : vmap->width;
+
+    offsets_start = LQR_VMAP_FILE_HEADER_SIZE;
+    max_size = offsets_start + 8 * ((gsize) n_lines + 1) + (gsize) n_lines * (1 + 5 * (gsize) line_len);
+
+    LQR_TRY_N_N(data = g_try_malloc(max_size));
+
+    /* header */
+    memcpy(data, LQR_VMAP_FILE_MAGIC, 4);
+    p = lqr_vmap_put_uint32(data + 4, LQR_VMAP_FILE_VERSION);
+    p = lqr_vmap_put_uint32(p, vmap->width);
+    p = lqr_vmap_put_uint32(p, vmap->height);
+    p = lqr_vmap_put_uint32(p, vmap->depth);
+    p = lqr_vmap_put_uint32(p, vmap->orientation);
+    p = lqr_vmap_put_uint32(p, (guint32) vmap->delta_x);
+    rig.f = vmap->rigidity;
+    p = lqr_vmap_put_uint32(p, rig.i);
+    p = lqr_vmap_put_uint32(p, (guint32) vmap->nrg_radius);
+    p = lqr_vmap_put_uint32(p, 0);
+
+    /* lines */
+    p = data + offsets_start + 8 * ((gsize) n_lines + 1);
+    for (i = 0; i < n_lines; i++) {
+        lqr_vmap_put_uint64(data + offsets_start + 8 * i, p - data);
+
+        plain_size = 0;
+        delta_size = 0;
+        for (j = 0; j < line_len; j++) {
+            plain_size += lqr_vmap_varint_size(vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i, j)]);
+            if (i > 0) {
+                d = vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i, j)] - vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i - 1, j)];
+                delta_size += lqr_vmap_varint_size(LQR_VMAP_ZIGZAG(d));
+            }
+        }
+
+        if ((i > 0) && (delta_size < plain_size)) {
+            *p++ = LQR_VMAP_LINE_DELTA;
+            for (j = 0; j < line_len; j++) {
+                d = vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i, j)] - vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i - 1, j)];
+                p = lqr_vmap_put_varint(p, LQR_VMAP_ZIGZAG(d));
+            }
+        } else {
+            *p++ = LQR_VMAP_LINE_PLAIN;
+            for (j = 0; j < line_len; j++) {
+                p = lqr_vmap_put_varint(p, vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i, j)]);
+            }
+        }
+    }
+    lqr_vmap_put_uint64(data + offsets_start + 8 * n_lines, p - data);
+
+    *size = p - data;
+    return data;
+}
+
+/* decode the lines of a map in the file format
+ * (the map must have the right size and orientation);
+ * the data is not trusted, so the levels are checked
+ * as they are read (see lqr_vmap_priv.h) */
+LqrRetVal
+lqr_vmap_decode_lines(LqrVMap *vmap, const guchar *data, gsize size)
+{
+    const guchar *p, *end;
+    gsize offsets_start;
+    guint64 start, stop;
+    gint n_lines, line_len;
+    gint i, j;
+    gint *seen;
+    gint n_levels, line_levels, line_max;
+    gint64 level;
+    guint32 u;
+    guchar mode;
+    LqrRetVal ret_val = LQR_OK;
+
+    n_lines = vmap->orientation ? vmap->width : vmap->height;
+    line_len = vmap->orientation ? vmap->height : vmap->width;
+
+    offsets_start = LQR_VMAP_FILE_HEADER_SIZE;
+    LQR_CATCH_F(size >= offsets_start + 8 * ((gsize) n_lines + 1));
+
+    /* line in which each level was last seen (plus 1) */
+    LQR_CATCH_MEM(seen = g_try_new0(gint, line_len + 1));
+
+    n_levels = -1;
+    for (i = 0; i < n_lines && ret_val == LQR_OK; i++) {
+        start = lqr_vmap_get_uint64(data + offsets_start + 8 * i);
+        stop = lqr_vmap_get_uint64(data + offsets_start + 8 * (i + 1));
+        if ((start >= stop) || (stop > size)) {
+            ret_val = LQR_ERROR;
+            break;
+        }
+
+        p = data + start;
+        end = data + stop;
+        mode = *p++;
+        if ((mode != LQR_VMAP_LINE_PLAIN) && ((mode != LQR_VMAP_LINE_DELTA) || (i == 0))) {
+            ret_val = LQR_ERROR;
+            break;
+        }
+
+        line_levels = 0;
+        line_max = 0;
+        for (j = 0; j < line_len; j++) {
+            if ((p = lqr_vmap_get_varint(p, end, &u)) == NULL) {
+                ret_val = LQR_ERROR;
+                break;
+            }
+            if (mode == LQR_VMAP_LINE_PLAIN) {
+                level = u;
+            } else {
+                level = vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i - 1, j)] + LQR_VMAP_UNZIGZAG(u);
+            }
+            if ((level < 0) || (level > line_len) || ((level > 0) && (seen[level] == i + 1))) {
+                ret_val = LQR_ERROR;
+                break;
+            }
+            if (level > 0) {
+                seen[level] = i + 1;
+                line_levels++;
+                line_max = MAX(line_max, (gint) level);
+            }
+            vmap->buffer[LQR_VMAP_LINE_INDEX(vmap, i, j)] = (gint) level;
+        }
+
+        /* the levels are distinct, hence they are 1 ... line_max
+         * if there are line_max of them */
+        if (ret_val == LQR_OK) {
+            if (n_levels < 0) {
+                n_levels = line_levels;
+            }
+            if ((line_levels != line_max) || (line_levels != n_levels)) {
+                ret_val = LQR_ERROR;
+            }
+        }
+    }
+
+    if ((ret_val == LQR_OK) && (vmap->depth > n_levels)) {
+        ret_val = LQR_ERROR;
+    }
+
+    g_free(seen);
+
+    return ret_val;
+}
+
+/* save the map to a file */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_vmap_save_to_file(LqrVMap *vmap, const gchar *filename)
+{
+    guchar *data;
+    gsize size;
+    gint z0;
+    gboolean ok;
+
+    /* only visibility levels can be stored */
+    for (z0 = 0; z0 < vmap->width * vmap->height; z0++) {
+        LQR_CATCH_F(vmap->buffer[z0] >= 0);
+    }
+
+    LQR_CATCH_MEM(data = lqr_vmap_encode(vmap, &size));
+
+    ok = g_file_set_contents(filename, (const gchar *) data, size, NULL);
+    g_free(data);
+    LQR_CATCH_F(ok);
+
+    return LQR_OK;
+}
+
+/* read a map from a memory buffer in the file format
+ * (e.g. a memory-mapped file) */
+/* LQR_PUBLIC */
+LqrVMap *
+lqr_vmap_new_from_data(const guchar *data, gsize size)
+{
+    LqrVMap *vmap;
+    gint *buffer;
+    gint width, height;
+    union {
+        gfloat f;
+        guint32 i;
+    } rig;
+
+    if ((size < LQR_VMAP_FILE_HEADER_SIZE) || (memcmp(data, LQR_VMAP_FILE_MAGIC, 4) != 0)
+        || (lqr_vmap_get_uint32(data + 4) != LQR_VMAP_FILE_VERSION)) {
+        return NULL;
+    }
+
+    width = (gint) lqr_vmap_get_uint32(data + 8);
+    height = (gint) lqr_vmap_get_uint32(data + 12);
+    if ((width <= 0) || (height <= 0) || (width > G_MAXINT / height)) {
+        return NULL;
+    }
+
+    LQR_TRY_N_N(buffer = g_try_new(gint, width * height));
+    if ((vmap = lqr_vmap_new(buffer, width, height, (gint) lqr_vmap_get_uint32(data + 16),
+                             (gint) lqr_vmap_get_uint32(data + 20))) == NULL) {
+        g_free(buffer);
+        return NULL;
+    }
+    if ((vmap->orientation != 0 && vmap->orientation != 1) || (vmap->depth < 0) ||
+        (vmap->depth >= (vmap->orientation ? height : width))) {
+        lqr_vmap_destroy(vmap);
+        return NULL;
+    }
+    vmap->delta_x = (gint) lqr_vmap_get_uint32(data + 24);
+    rig.i = lqr_vmap_get_uint32(data + 28);
+    vmap->rigidity = rig.f;
+    vmap->nrg_radius = (gint) lqr_vmap_get_uint32(data + 32);
+
+    if (lqr_vmap_decode_lines(vmap, data, size) != LQR_OK) {
+        lqr_vmap_destroy(vmap);
+        return NULL;
+    }
+
+    return vmap;
+}
+
+/* read a map from a file */
+/* LQR_PUBLIC */
+LqrVMap *
+lqr_vmap_new_from_file(const gchar *filename)
+{
+    LqrVMap *vmap;
+    gchar *contents;
+    gsize length;
+
+    if (!g_file_get_contents(filename, &contents, &length, NULL)) {
+        return NULL;
+    }
+
+    vmap = lqr_vmap_new_from_data((const guchar *) contents, length);
+    g_free(contents);
+
+    return vmap;
+}
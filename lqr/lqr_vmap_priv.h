@@ -35,10 +35,60 @@ struct _LqrVMap {
     gint height;
     gint depth;
     gint orientation;
+    gint delta_x;               /* carver settings used to compute the map (-1 if unknown) */
+    gfloat rigidity;
+    gint nrg_radius;
 };
 
+/* VMAP FILE FORMAT
+ *
+ * all numbers are little-endian:
+ *
+ *   header    "LQRV", version, width, height, depth, orientation,
+ *             delta_x, rigidity, energy radius, reserved (32 bit each)
+ *   offsets   (n_lines + 1) 64 bit offsets of the lines from the
+ *             beginning of the file (the last one is the file size)
+ *   lines     one mode byte followed by one varint per point
+ *
+ * lines follow the seams: they are the image rows for orientation 0
+ * (vertical seams) and the image columns for orientation 1.
+ * In mode LQR_VMAP_LINE_PLAIN the varints are the visibility levels,
+ * in mode LQR_VMAP_LINE_DELTA they are the zigzag-coded differences
+ * with the previous line (whichever is shorter is used).
+ *
+ * when reading, the map must be consistent: each seam crosses each
+ * line once, hence the nonzero levels of every line must be exactly
+ * 1, 2, ... up to the same maximum (0 marks the points which were
+ * not reached by the computation); the depth cannot be larger than
+ * that maximum, nor than the line length minus 1, and the orientation
+ * must be 0 or 1 */
+
+#define LQR_VMAP_FILE_MAGIC "LQRV"
+#define LQR_VMAP_FILE_VERSION (1)
+#define LQR_VMAP_FILE_HEADER_SIZE (40)
+
+#define LQR_VMAP_LINE_PLAIN (0)
+#define LQR_VMAP_LINE_DELTA (1)
+
+#define LQR_VMAP_LINE_INDEX(vmap, i, j) \
+  ((vmap)->orientation ? (j) * (vmap)->width + (i) : (i) * (vmap)->width + (j))
+
+#define LQR_VMAP_ZIGZAG(d) ((d) >= 0 ? ((guint32) (d)) << 1 : (((guint32) -(d)) << 1) - 1)
+#define LQR_VMAP_UNZIGZAG(u) (((u) & 1) ? -(gint64) (((guint64) (u) + 1) >> 1) : (gint64) ((u) >> 1))
+
 /* LQR_VMAP CLASS PRIVATE FUNCTIONS */
 
-/* no private functions currently */
+void lqr_vmap_copy_settings(LqrVMap *vmap, LqrCarver *r);
+
+guchar *lqr_vmap_encode(LqrVMap *vmap, gsize *size);
+LqrRetVal lqr_vmap_decode_lines(LqrVMap *vmap, const guchar *data, gsize size);
+
+guchar *lqr_vmap_put_uint32(guchar *p, guint32 v);
+guchar *lqr_vmap_put_uint64(guchar *p, guint64 v);
+guint32 lqr_vmap_get_uint32(const guchar *p);
+guint64 lqr_vmap_get_uint64(const guchar *p);
+guchar *lqr_vmap_put_varint(guchar *p, guint32 v);
+const guchar *lqr_vmap_get_varint(const guchar *p, const guchar *end, guint32 *v);
+gint lqr_vmap_varint_size(guint32 v);
 
 #endif /* __LQR_VMAP_PRIV_H__ */
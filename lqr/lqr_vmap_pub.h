@@ -45,9 +45,16 @@ LQR_PUBLIC gint lqr_vmap_get_width(LqrVMap *vmap);
 LQR_PUBLIC gint lqr_vmap_get_height(LqrVMap *vmap);
 LQR_PUBLIC gint lqr_vmap_get_depth(LqrVMap *vmap);
 LQR_PUBLIC gint lqr_vmap_get_orientation(LqrVMap *vmap);
+LQR_PUBLIC gint lqr_vmap_get_delta_x(LqrVMap *vmap);
+LQR_PUBLIC gfloat lqr_vmap_get_rigidity(LqrVMap *vmap);
+LQR_PUBLIC gint lqr_vmap_get_energy_radius(LqrVMap *vmap);
 
 LQR_PUBLIC LqrRetVal lqr_vmap_internal_dump(LqrCarver *r);
 LQR_PUBLIC LqrVMap *lqr_vmap_dump(LqrCarver *r);
 LQR_PUBLIC LqrRetVal lqr_vmap_load(LqrCarver *r, LqrVMap *vmap);
 
+LQR_PUBLIC LqrRetVal lqr_vmap_save_to_file(LqrVMap *vmap, const gchar *filename);
+LQR_PUBLIC LqrVMap *lqr_vmap_new_from_file(const gchar *filename);
+LQR_PUBLIC LqrVMap *lqr_vmap_new_from_data(const guchar *data, gsize size);
+
 #endif /* __LQR_VMAP_PUB_H__ */